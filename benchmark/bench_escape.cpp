@@ -0,0 +1,95 @@
+/*
+ * bench_escape.cpp
+ *
+ *  Created on:  2026-10-17
+ *      Author: Michael Reichert <michael.reichert@geofabrik.de>
+ */
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <postgres_table.hpp>
+
+/**
+ * Byte by byte implementation of PostgresTable::escape4hstore as reference.
+ */
+void escape4hstore_bytewise(const char* source, std::string& destination) {
+    destination.push_back('"');
+    for (const char* c = source; *c; ++c) {
+        switch (*c) {
+            case '\\':
+                destination.append("\\\\\\\\");
+                break;
+            case '"':
+                destination.append("\\\\\"");
+                break;
+            case '\t':
+                destination.append("\\\t");
+                break;
+            case '\r':
+                destination.append("\\\r");
+                break;
+            case '\n':
+                destination.append("\\\n");
+                break;
+            default:
+                destination.push_back(*c);
+                break;
+        }
+    }
+    destination.push_back('"');
+}
+
+/**
+ * Create values similar to OSM tags: mostly short ones, some long ones (e.g. note=*),
+ * very few special characters.
+ */
+std::vector<std::string> create_values(const size_t count) {
+    std::mt19937 generator{42};
+    std::uniform_int_distribution<int> letter('a', 'z');
+    std::uniform_int_distribution<int> percent(0, 99);
+    std::vector<std::string> values;
+    values.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        const size_t length = percent(generator) < 90 ? 3 + percent(generator) / 10 : 40 + percent(generator) * 2;
+        std::string value;
+        for (size_t j = 0; j < length; ++j) {
+            if (percent(generator) == 0) {
+                value.push_back('"');
+            } else {
+                value.push_back(static_cast<char>(letter(generator)));
+            }
+        }
+        values.push_back(std::move(value));
+    }
+    return values;
+}
+
+template <typename TFunc>
+void run(const char* name, const std::vector<std::string>& values, const int rounds, TFunc func) {
+    std::string destination;
+    size_t bytes = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; ++r) {
+        for (const auto& value : values) {
+            destination.clear();
+            func(value.c_str(), destination);
+            bytes += value.size();
+        }
+    }
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << name << ": " << seconds << " s, " << (bytes / seconds / 1024 / 1024) << " MiB/s\n";
+}
+
+int main(int argc, char* argv[]) {
+    const int rounds = argc > 1 ? atoi(argv[1]) : 20;
+    const std::vector<std::string> values = create_values(1000000);
+    run("escape4hstore (byte by byte)", values, rounds, escape4hstore_bytewise);
+    run("escape4hstore", values, rounds, PostgresTable::escape4hstore);
+    run("escape4array", values, rounds, PostgresTable::escape4array);
+    run("escape", values, rounds, PostgresTable::escape);
+}
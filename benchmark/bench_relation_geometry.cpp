@@ -0,0 +1,175 @@
+/*
+ * bench_relation_geometry.cpp
+ *
+ *  Created on:  2026-10-17
+ *      Author: Michael Reichert <michael.reichert@geofabrik.de>
+ */
+
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <geos/geom/CoordinateArraySequenceFactory.h>
+#include <geos/geom/GeometryFactory.h>
+#include <geos/geom/LineString.h>
+#include <geos/geom/MultiLineString.h>
+#include <geos/geom/MultiPoint.h>
+#include <geos/geom/Point.h>
+#include <geos/io/WKBWriter.h>
+
+#include <geos_compatibility_definitions.hpp>
+#include <relation_geometry_builder.hpp>
+
+/**
+ * Members of a relation: locations of member nodes and the locations of the nodes of member ways.
+ */
+struct TestRelation {
+    std::vector<osmium::Location> points;
+    std::vector<std::vector<osmium::Location>> ways;
+};
+
+/**
+ * Create relations similar to route relations: few member nodes (stops), some ways with
+ * up to a few hundred nodes each.
+ */
+std::vector<TestRelation> create_relations(const size_t count) {
+    std::mt19937 generator{42};
+    std::uniform_real_distribution<double> coordinate(-0.5, 0.5);
+    std::uniform_int_distribution<int> point_count(0, 10);
+    std::uniform_int_distribution<int> way_count(1, 40);
+    std::uniform_int_distribution<int> way_length(2, 200);
+    std::vector<TestRelation> relations;
+    relations.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        TestRelation relation;
+        const double lon = 8.0 + coordinate(generator);
+        const double lat = 49.0 + coordinate(generator);
+        for (int p = point_count(generator); p > 0; --p) {
+            relation.points.emplace_back(lon + coordinate(generator) / 10, lat + coordinate(generator) / 10);
+        }
+        for (int w = way_count(generator); w > 0; --w) {
+            relation.ways.emplace_back();
+            for (int n = way_length(generator); n > 0; --n) {
+                relation.ways.back().emplace_back(lon + coordinate(generator) / 10, lat + coordinate(generator) / 10);
+            }
+        }
+        relations.push_back(std::move(relation));
+    }
+    return relations;
+}
+
+/**
+ * Implementation used before RelationGeometryBuilder was introduced.
+ */
+class GEOSRelationGeometries {
+
+    geos_factory_type m_geom_factory;
+
+    geos::io::WKBWriter m_wkb_writer;
+
+public:
+    GEOSRelationGeometries() :
+#ifdef GEOS_36
+        m_geom_factory(geos::geom::GeometryFactory::create().release(), GEOSGeometryFactoryDeleter()),
+#else
+        m_geom_factory(new geos::geom::GeometryFactory{}),
+#endif
+        m_wkb_writer() {
+    }
+
+    void operator()(const TestRelation& relation, std::string& points_hex, std::string& lines_hex) {
+        std::vector<geos::geom::Geometry*>* points = new std::vector<geos::geom::Geometry*>();
+        std::vector<geos::geom::Geometry*>* linestrings = new std::vector<geos::geom::Geometry*>();
+        for (const osmium::Location& loc : relation.points) {
+            std::unique_ptr<geos::geom::Point> point (m_geom_factory->createPoint(geos::geom::Coordinate(loc.lon(), loc.lat())));
+            points->push_back(point.release());
+        }
+        for (const auto& way : relation.ways) {
+            std::unique_ptr<std::vector<geos::geom::Coordinate>> coordinates {new std::vector<geos::geom::Coordinate>()};
+            coordinates->reserve(way.size());
+            for (const osmium::Location& loc : way) {
+                coordinates->emplace_back(loc.lon(), loc.lat());
+            }
+            geos::geom::CoordinateArraySequenceFactory coord_sequence_factory;
+            std::unique_ptr<geos::geom::CoordinateSequence> coord_sequence {coord_sequence_factory.create(coordinates.release(), 2)};
+            std::unique_ptr<geos::geom::LineString> linestring {m_geom_factory->createLineString(coord_sequence.release())};
+            linestrings->push_back(linestring.release());
+        }
+        std::unique_ptr<geos::geom::MultiPoint> multipoints {m_geom_factory->createMultiPoint(points)};
+        std::unique_ptr<geos::geom::MultiLineString> multilinestrings {m_geom_factory->createMultiLineString(linestrings)};
+        std::stringstream multipoint_stream;
+        m_wkb_writer.writeHEX(*multipoints, multipoint_stream);
+        std::stringstream multilinestring_stream;
+        m_wkb_writer.writeHEX(*multilinestrings, multilinestring_stream);
+        points_hex = multipoint_stream.str();
+        lines_hex = multilinestring_stream.str();
+    }
+};
+
+/**
+ * Implementation using RelationGeometryBuilder
+ */
+class BuilderRelationGeometries {
+
+    RelationGeometryBuilder m_builder;
+
+public:
+    void operator()(const TestRelation& relation, std::string& points_hex, std::string& lines_hex) {
+        m_builder.clear();
+        for (const osmium::Location& loc : relation.points) {
+            m_builder.add_point(loc);
+        }
+        for (const auto& way : relation.ways) {
+            m_builder.linestring_start();
+            for (const osmium::Location& loc : way) {
+                m_builder.linestring_add_location(loc);
+            }
+            m_builder.linestring_finish();
+        }
+        points_hex.clear();
+        m_builder.append_multipoint(points_hex, false);
+        lines_hex.clear();
+        m_builder.append_multilinestring(lines_hex, false);
+    }
+};
+
+template <typename TFunc>
+void run(const char* name, const std::vector<TestRelation>& relations, const int rounds, TFunc& func) {
+    std::string points_hex;
+    std::string lines_hex;
+    size_t bytes = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; ++r) {
+        for (const auto& relation : relations) {
+            func(relation, points_hex, lines_hex);
+            bytes += points_hex.size() + lines_hex.size();
+        }
+    }
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << name << ": " << seconds << " s, " << (relations.size() * rounds / seconds) << " relations/s, "
+            << (bytes / seconds / 1024 / 1024) << " MiB/s\n";
+}
+
+int main(int argc, char* argv[]) {
+    const int rounds = argc > 1 ? atoi(argv[1]) : 5;
+    const std::vector<TestRelation> relations = create_relations(20000);
+    GEOSRelationGeometries geos_impl;
+    BuilderRelationGeometries builder_impl;
+
+    // Both implementations have to produce the same output.
+    std::string geos_points, geos_lines, builder_points, builder_lines;
+    for (const auto& relation : relations) {
+        geos_impl(relation, geos_points, geos_lines);
+        builder_impl(relation, builder_points, builder_lines);
+        if (geos_points != builder_points || geos_lines != builder_lines) {
+            std::cerr << "ERROR: output of RelationGeometryBuilder differs from GEOS\n";
+            return 1;
+        }
+    }
+
+    run("GEOS and WKBWriter", relations, rounds, geos_impl);
+    run("RelationGeometryBuilder", relations, rounds, builder_impl);
+}
@@ -0,0 +1,284 @@
+/*
+ * binary_copy.hpp
+ *
+ *  Created on:  2026-10-17
+ *      Author: Michael Reichert <michael.reichert@geofabrik.de>
+ */
+
+#ifndef INCLUDE_POSTGRES_DRIVERS_BINARY_COPY_HPP_
+#define INCLUDE_POSTGRES_DRIVERS_BINARY_COPY_HPP_
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include "columns.hpp"
+
+namespace postgres_drivers {
+
+    /**
+     * Helper functions to encode rows for `COPY … FROM STDIN (FORMAT binary)`.
+     *
+     * See https://www.postgresql.org/docs/current/sql-copy.html for the
+     * specification of the format. All integers are written in network byte order.
+     * A row starts with the number of fields (int16), every field starts with its
+     * length in bytes (int32, -1 for NULL) followed by the output of the type's
+     * binary send function.
+     */
+    namespace binary {
+
+        /// OID of the bigint type, used as element type of arrays
+        constexpr uint32_t oid_int8 = 20;
+
+        inline void append_int16(std::string& out, const int16_t value) {
+            const uint16_t v = static_cast<uint16_t>(value);
+            out.push_back(static_cast<char>(v >> 8));
+            out.push_back(static_cast<char>(v));
+        }
+
+        inline void append_int32(std::string& out, const int32_t value) {
+            const uint32_t v = static_cast<uint32_t>(value);
+            out.push_back(static_cast<char>(v >> 24));
+            out.push_back(static_cast<char>(v >> 16));
+            out.push_back(static_cast<char>(v >> 8));
+            out.push_back(static_cast<char>(v));
+        }
+
+        inline void append_int64(std::string& out, const int64_t value) {
+            const uint64_t v = static_cast<uint64_t>(value);
+            append_int32(out, static_cast<int32_t>(v >> 32));
+            append_int32(out, static_cast<int32_t>(v));
+        }
+
+        /**
+         * Overwrite an int32 at a given position of the buffer.
+         */
+        inline void set_int32(std::string& out, const size_t offset, const int32_t value) {
+            const uint32_t v = static_cast<uint32_t>(value);
+            out[offset] = static_cast<char>(v >> 24);
+            out[offset + 1] = static_cast<char>(v >> 16);
+            out[offset + 2] = static_cast<char>(v >> 8);
+            out[offset + 3] = static_cast<char>(v);
+        }
+
+        /**
+         * Append the file header which has to be sent once after the COPY command.
+         */
+        inline void append_header(std::string& out) {
+            static const char signature[] = "PGCOPY\n\377\r\n";
+            // The signature is terminated by a null byte which is part of the format.
+            out.append(signature, sizeof(signature));
+            // flags field
+            append_int32(out, 0);
+            // length of header extension area
+            append_int32(out, 0);
+        }
+
+        /**
+         * Append the file trailer which has to be sent before `PQputCopyEnd`.
+         */
+        inline void append_trailer(std::string& out) {
+            append_int16(out, -1);
+        }
+
+        /**
+         * Start a new row.
+         *
+         * \param field_count number of columns of the row
+         */
+        inline void start_row(std::string& out, const size_t field_count) {
+            append_int16(out, static_cast<int16_t>(field_count));
+        }
+
+        inline void append_null(std::string& out) {
+            append_int32(out, -1);
+        }
+
+        /**
+         * Append a placeholder for the length of a field whose size is not known yet.
+         *
+         * \returns offset to be passed to finish_field
+         */
+        inline size_t start_field(std::string& out) {
+            const size_t offset = out.size();
+            append_int32(out, 0);
+            return offset;
+        }
+
+        /**
+         * Write the length of a field started with start_field.
+         */
+        inline void finish_field(std::string& out, const size_t offset) {
+            set_int32(out, offset, static_cast<int32_t>(out.size() - offset - 4));
+        }
+
+        inline void append_bytes_field(std::string& out, const char* data, const size_t length) {
+            append_int32(out, static_cast<int32_t>(length));
+            out.append(data, length);
+        }
+
+        inline void append_text_field(std::string& out, const char* text) {
+            if (!text) {
+                append_null(out);
+                return;
+            }
+            append_bytes_field(out, text, strlen(text));
+        }
+
+        inline void append_int16_field(std::string& out, const int16_t value) {
+            append_int32(out, 2);
+            append_int16(out, value);
+        }
+
+        inline void append_int32_field(std::string& out, const int32_t value) {
+            append_int32(out, 4);
+            append_int32(out, value);
+        }
+
+        inline void append_int64_field(std::string& out, const int64_t value) {
+            append_int32(out, 8);
+            append_int64(out, value);
+        }
+
+        inline void append_float4_field(std::string& out, const float value) {
+            uint32_t bits;
+            memcpy(&bits, &value, sizeof(bits));
+            append_int32(out, 4);
+            append_int32(out, static_cast<int32_t>(bits));
+        }
+
+        /**
+         * Append an integer field using the width of the given column type.
+         */
+        inline void append_integer_field(std::string& out, const ColumnType type, const int64_t value) {
+            switch (type) {
+            case ColumnType::SMALLINT:
+                append_int16_field(out, static_cast<int16_t>(value));
+                break;
+            case ColumnType::INT:
+                append_int32_field(out, static_cast<int32_t>(value));
+                break;
+            default:
+                append_int64_field(out, value);
+                break;
+            }
+        }
+
+        /**
+         * Append the value of an OSM tag as a field of the given column type.
+         *
+         * The text format lets PostgreSQL parse numeric columns. In binary mode we have to do it
+         * ourselves. Values which cannot be parsed are written as NULL.
+         */
+        inline void append_typed_text_field(std::string& out, const ColumnType type, const char* value) {
+            if (!value) {
+                append_null(out);
+                return;
+            }
+            char* end;
+            errno = 0;
+            switch (type) {
+            case ColumnType::SMALLINT:
+            case ColumnType::INT:
+            case ColumnType::BIGINT: {
+                    const long long number = strtoll(value, &end, 10);
+                    if (end == value || *end != '\0' || errno != 0) {
+                        append_null(out);
+                    } else {
+                        append_integer_field(out, type, number);
+                    }
+                }
+                break;
+            case ColumnType::REAL: {
+                    const float number = strtof(value, &end);
+                    if (end == value || *end != '\0' || errno != 0) {
+                        append_null(out);
+                    } else {
+                        append_float4_field(out, number);
+                    }
+                }
+                break;
+            default:
+                append_text_field(out, value);
+                break;
+            }
+        }
+
+        /**
+         * Build an empty geometry of the given type as little-endian EWKB with SRID.
+         *
+         * \param geometry_type OGC geometry type code (e.g. 4 for MultiPoint)
+         * \param srid spatial reference system
+         */
+        inline std::string empty_ewkb(const uint32_t geometry_type, const uint32_t srid) {
+            std::string wkb;
+            wkb.push_back(0x01);
+            const uint32_t words[3] = {geometry_type | 0x20000000, srid, 0};
+            for (const uint32_t w : words) {
+                wkb.push_back(static_cast<char>(w));
+                wkb.push_back(static_cast<char>(w >> 8));
+                wkb.push_back(static_cast<char>(w >> 16));
+                wkb.push_back(static_cast<char>(w >> 24));
+            }
+            return wkb;
+        }
+
+        /**
+         * Start a one-dimensional array field.
+         *
+         * Call finish_array after all elements have been added.
+         *
+         * \param element_oid OID of the element type
+         * \returns offset to be passed to finish_array
+         */
+        inline size_t start_array(std::string& out, const uint32_t element_oid) {
+            const size_t offset = start_field(out);
+            // number of dimensions
+            append_int32(out, 1);
+            // has NULL elements
+            append_int32(out, 0);
+            append_int32(out, static_cast<int32_t>(element_oid));
+            // size of the dimension, set by finish_array
+            append_int32(out, 0);
+            // lower bound
+            append_int32(out, 1);
+            return offset;
+        }
+
+        /**
+         * Write the length of an array field and its number of elements.
+         */
+        inline void finish_array(std::string& out, const size_t offset, const size_t element_count) {
+            set_int32(out, offset + 16, static_cast<int32_t>(element_count));
+            finish_field(out, offset);
+        }
+
+        /**
+         * Start a hstore field.
+         *
+         * \returns offset to be passed to finish_hstore
+         */
+        inline size_t start_hstore(std::string& out) {
+            const size_t offset = start_field(out);
+            // number of pairs, set by finish_hstore
+            append_int32(out, 0);
+            return offset;
+        }
+
+        inline void append_hstore_pair(std::string& out, const char* key, const char* value) {
+            append_text_field(out, key);
+            append_text_field(out, value);
+        }
+
+        inline void finish_hstore(std::string& out, const size_t offset, const size_t pair_count) {
+            set_int32(out, offset + 4, static_cast<int32_t>(pair_count));
+            finish_field(out, offset);
+        }
+
+    } // namespace binary
+
+} // namespace postgres_drivers
+
+#endif /* INCLUDE_POSTGRES_DRIVERS_BINARY_COPY_HPP_ */
@@ -41,6 +41,33 @@ namespace postgres_drivers {
          * Create table of nodes without tags.
          */
         bool untagged_nodes = false;
+
+        /**
+         * Use the binary format of COPY instead of the text format.
+         */
+        bool binary_copy = false;
+
+        /**
+         * Maximum number of chunks waiting to be sent by the writer thread of a table in COPY mode.
+         * If set to 0, data is sent synchronously by the thread calling Table::send_line.
+         */
+        size_t copy_queue_size = 64;
+
+        /**
+         * Distribute rows among the COPY shards of a table by the OSM ID instead of round robin.
+         */
+        bool shard_by_id = false;
+
+        /**
+         * Write the data of COPY and all SQL commands into files in this directory instead of
+         * sending them to the database. No database connection is opened if this is set.
+         */
+        std::string output_dir;
+
+        /**
+         * Compress the COPY files written into #output_dir with gzip.
+         */
+        bool compress_output = false;
     };
 }
 
@@ -0,0 +1,143 @@
+/*
+ * copy_file.hpp
+ *
+ *  Created on:  2026-10-17
+ *      Author: Michael Reichert <michael.reichert@geofabrik.de>
+ */
+
+#ifndef INCLUDE_POSTGRES_DRIVERS_COPY_FILE_HPP_
+#define INCLUDE_POSTGRES_DRIVERS_COPY_FILE_HPP_
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include <zlib.h>
+#include <boost/format.hpp>
+
+namespace postgres_drivers {
+
+    /**
+     * \brief File which receives the data of a COPY stream or SQL commands instead of the database.
+     *
+     * The file can be compressed with gzip. The data is written as it is, i.e. the file can be
+     * loaded using `\copy ... FROM 'file'` (or `FROM PROGRAM 'gzip -dc file'`) later.
+     */
+    class CopyFile {
+
+        std::string m_filename;
+
+        FILE* m_file = nullptr;
+
+        gzFile m_gz_file = nullptr;
+
+        /// error message of the last failed write, empty if no error occured
+        std::string m_error;
+
+    public:
+        CopyFile() = delete;
+
+        CopyFile(const CopyFile&) = delete;
+
+        CopyFile& operator=(const CopyFile&) = delete;
+
+        /**
+         * Create or truncate the file.
+         *
+         * \param filename path of the file
+         * \param compress compress the file with gzip
+         *
+         * \throws std::runtime_error if the file cannot be opened
+         */
+        CopyFile(const std::string& filename, const bool compress) :
+            m_filename(filename) {
+            if (compress) {
+                // Compression level 1 is fast enough to keep up with the import.
+                m_gz_file = gzopen(filename.c_str(), "wb1");
+                if (m_gz_file) {
+                    gzbuffer(m_gz_file, 256 * 1024);
+                }
+            } else {
+                m_file = fopen(filename.c_str(), "wb");
+            }
+            if (!m_file && !m_gz_file) {
+                throw std::runtime_error((boost::format("Cannot open %1% for writing: %2%\n") % filename
+                        % strerror(errno)).str());
+            }
+        }
+
+        ~CopyFile() {
+            if (m_file) {
+                fclose(m_file);
+            }
+            if (m_gz_file) {
+                gzclose(m_gz_file);
+            }
+        }
+
+        const std::string& filename() const noexcept {
+            return m_filename;
+        }
+
+        /**
+         * Append data to the file.
+         *
+         * \returns false if writing failed, see error_message()
+         */
+        bool write(const char* data, const size_t length) {
+            if (length == 0) {
+                return true;
+            }
+            if (m_gz_file) {
+                if (gzwrite(m_gz_file, data, static_cast<unsigned int>(length)) == 0) {
+                    int error_number = 0;
+                    m_error = gzerror(m_gz_file, &error_number);
+                    return false;
+                }
+                return true;
+            }
+            if (fwrite(data, 1, length, m_file) != length) {
+                m_error = strerror(errno);
+                return false;
+            }
+            return true;
+        }
+
+        bool write(const std::string& data) {
+            return write(data.data(), data.size());
+        }
+
+        /**
+         * Message describing why the last call of write() failed.
+         */
+        const std::string& error_message() const noexcept {
+            return m_error;
+        }
+
+        /**
+         * Flush all data and close the file.
+         *
+         * \throws std::runtime_error if flushing fails
+         */
+        void close() {
+            int result = 0;
+            if (m_file) {
+                result = fclose(m_file);
+                m_file = nullptr;
+            }
+            if (m_gz_file) {
+                result = (gzclose(m_gz_file) == Z_OK) ? 0 : EOF;
+                m_gz_file = nullptr;
+            }
+            if (result != 0) {
+                throw std::runtime_error((boost::format("Writing %1% failed: %2%\n") % m_filename
+                        % strerror(errno)).str());
+            }
+        }
+    };
+
+} // namespace postgres_drivers
+
+#endif /* INCLUDE_POSTGRES_DRIVERS_COPY_FILE_HPP_ */
@@ -0,0 +1,234 @@
+/*
+ * copy_writer.hpp
+ *
+ *  Created on:  2026-10-17
+ *      Author: Michael Reichert <michael.reichert@geofabrik.de>
+ */
+
+#ifndef INCLUDE_POSTGRES_DRIVERS_COPY_WRITER_HPP_
+#define INCLUDE_POSTGRES_DRIVERS_COPY_WRITER_HPP_
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <libpq-fe.h>
+#include <boost/format.hpp>
+
+#include "copy_file.hpp"
+
+namespace postgres_drivers {
+
+    /**
+     * \brief Background thread sending data to a database connection in COPY mode.
+     *
+     * The thread producing the data pushes chunks into a bounded queue. A writer thread
+     * takes them from the queue and calls `PQputCopyData` (or writes them into a file if the table
+     * writes its data into files). If the queue is full, the producer
+     * has to wait. These stalls are counted to find out which table slows down the import.
+     *
+     * While the writer is running, nobody else may use the database connection.
+     */
+    class CopyWriter {
+
+        PGconn* m_database_connection;
+
+        /// file to write to instead of the database connection, nullptr if the data goes to the database
+        CopyFile* m_file = nullptr;
+
+        /// name of the table, used for error messages
+        std::string m_name;
+
+        /// maximum number of chunks in the queue
+        size_t m_max_queue_size;
+
+        std::deque<std::string> m_queue;
+
+        /// buffers which have been sent already and can be reused by the producer
+        std::vector<std::string> m_free_buffers;
+
+        std::mutex m_mutex;
+
+        /// signalled if a chunk was added or the writer should stop
+        std::condition_variable m_data_available;
+
+        /// signalled if a chunk was removed from the queue
+        std::condition_variable m_space_available;
+
+        /// set to true if no more data will be added
+        bool m_done = false;
+
+        /// error message of the writer thread, empty if no error occured
+        std::string m_error;
+
+        /// number of calls of push() which had to wait for the writer
+        size_t m_stalls = 0;
+
+        /// total time push() had to wait for the writer
+        std::chrono::steady_clock::duration m_stall_duration {0};
+
+        std::thread m_thread;
+
+        void run() {
+            while (true) {
+                std::string chunk;
+                {
+                    std::unique_lock<std::mutex> lock{m_mutex};
+                    m_data_available.wait(lock, [this] { return m_done || !m_queue.empty(); });
+                    if (m_queue.empty()) {
+                        return;
+                    }
+                    chunk = std::move(m_queue.front());
+                    m_queue.pop_front();
+                }
+                m_space_available.notify_one();
+                const bool sent = m_file ? m_file->write(chunk)
+                        : PQputCopyData(m_database_connection, chunk.data(), chunk.size()) == 1;
+                {
+                    std::lock_guard<std::mutex> lock{m_mutex};
+                    if (m_free_buffers.size() < m_max_queue_size) {
+                        chunk.clear();
+                        m_free_buffers.push_back(std::move(chunk));
+                    }
+                }
+                if (!sent) {
+                    std::lock_guard<std::mutex> lock{m_mutex};
+                    m_error = (boost::format("Insertion via COPY into %1% failed: %2%\n") % m_name
+                            % (m_file ? m_file->error_message().c_str() : PQerrorMessage(m_database_connection))).str();
+                    // Drop all pending data, the producer will get the error with its next call.
+                    m_queue.clear();
+                    m_done = true;
+                    m_space_available.notify_all();
+                    return;
+                }
+            }
+        }
+
+        /**
+         * \throws std::runtime_error if the writer thread failed
+         *
+         * The caller has to hold the lock.
+         */
+        void check_error() {
+            if (!m_error.empty()) {
+                throw std::runtime_error(m_error);
+            }
+        }
+
+    public:
+        CopyWriter() = delete;
+
+        CopyWriter(const CopyWriter&) = delete;
+
+        CopyWriter& operator=(const CopyWriter&) = delete;
+
+        /**
+         * Start the writer thread.
+         *
+         * \param connection database connection, has to be in COPY mode already
+         * \param name name of the table
+         * \param max_queue_size maximum number of chunks waiting to be sent
+         */
+        CopyWriter(PGconn* connection, const std::string& name, const size_t max_queue_size) :
+            m_database_connection(connection),
+            m_name(name),
+            m_max_queue_size(max_queue_size),
+            m_thread(&CopyWriter::run, this) {
+        }
+
+        /**
+         * Start the writer thread writing into a file.
+         *
+         * \param file file to write to, has to outlive the writer
+         * \param name name of the table
+         * \param max_queue_size maximum number of chunks waiting to be written
+         */
+        CopyWriter(CopyFile& file, const std::string& name, const size_t max_queue_size) :
+            m_database_connection(nullptr),
+            m_file(&file),
+            m_name(name),
+            m_max_queue_size(max_queue_size),
+            m_thread(&CopyWriter::run, this) {
+        }
+
+        ~CopyWriter() {
+            if (m_thread.joinable()) {
+                {
+                    std::lock_guard<std::mutex> lock{m_mutex};
+                    m_done = true;
+                }
+                m_data_available.notify_one();
+                m_thread.join();
+            }
+        }
+
+        /**
+         * Add a chunk of data to the queue. Blocks if the queue is full.
+         *
+         * \param chunk data to be sent, will be replaced by an empty buffer which has been used
+         * for an earlier chunk if there is any. This avoids allocating new buffers all the time.
+         *
+         * \throws std::runtime_error if the writer thread failed to send data earlier
+         */
+        void push(std::string& chunk) {
+            {
+                std::unique_lock<std::mutex> lock{m_mutex};
+                check_error();
+                if (m_queue.size() >= m_max_queue_size) {
+                    ++m_stalls;
+                    const auto start = std::chrono::steady_clock::now();
+                    m_space_available.wait(lock, [this] { return m_done || m_queue.size() < m_max_queue_size; });
+                    m_stall_duration += std::chrono::steady_clock::now() - start;
+                    check_error();
+                }
+                m_queue.push_back(std::move(chunk));
+                if (m_free_buffers.empty()) {
+                    chunk = std::string{};
+                } else {
+                    chunk = std::move(m_free_buffers.back());
+                    m_free_buffers.pop_back();
+                }
+            }
+            m_data_available.notify_one();
+        }
+
+        /**
+         * Send all remaining chunks and stop the writer thread.
+         *
+         * The database connection can be used by the caller again after this method returned.
+         *
+         * \throws std::runtime_error if the writer thread failed to send data
+         */
+        void finish() {
+            {
+                std::lock_guard<std::mutex> lock{m_mutex};
+                m_done = true;
+            }
+            m_data_available.notify_one();
+            m_thread.join();
+            check_error();
+        }
+
+        /**
+         * Number of times the producer had to wait because the queue was full.
+         */
+        size_t stalls() const noexcept {
+            return m_stalls;
+        }
+
+        /**
+         * Total time the producer had to wait because the queue was full (in seconds).
+         */
+        double stall_seconds() const noexcept {
+            return std::chrono::duration<double>(m_stall_duration).count();
+        }
+    };
+
+} // namespace postgres_drivers
+
+#endif /* INCLUDE_POSTGRES_DRIVERS_COPY_WRITER_HPP_ */
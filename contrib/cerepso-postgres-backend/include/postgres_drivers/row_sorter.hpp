@@ -0,0 +1,369 @@
+/*
+ * row_sorter.hpp
+ *
+ *  Created on:  2026-10-17
+ *      Author: Michael Reichert <michael.reichert@geofabrik.de>
+ */
+
+#ifndef INCLUDE_POSTGRES_DRIVERS_ROW_SORTER_HPP_
+#define INCLUDE_POSTGRES_DRIVERS_ROW_SORTER_HPP_
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <queue>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+#include <boost/format.hpp>
+
+namespace postgres_drivers {
+
+    /**
+     * Functions to frame rows for a RowSorter.
+     *
+     * A framed row consists of its sort key (uint64_t), the length of the row (uint32_t), both in
+     * machine byte order, and the row itself (a line of the text format or a tuple of the binary
+     * format of COPY).
+     */
+    namespace sorted_row {
+
+        constexpr size_t header_size = sizeof(uint64_t) + sizeof(uint32_t);
+
+        inline void append_header(std::string& out, const uint64_t key, const uint32_t length) {
+            out.append(reinterpret_cast<const char*>(&key), sizeof(key));
+            out.append(reinterpret_cast<const char*>(&length), sizeof(length));
+        }
+
+        /**
+         * Append the header of a framed row. Append the row afterwards and call finish().
+         *
+         * \returns offset to be passed to finish()
+         */
+        inline size_t start(std::string& out, const uint64_t key) {
+            append_header(out, key, 0);
+            return out.size() - sizeof(uint32_t);
+        }
+
+        /**
+         * Write the length of a row started with start().
+         */
+        inline void finish(std::string& out, const size_t offset) {
+            const uint32_t length = static_cast<uint32_t>(out.size() - offset - sizeof(uint32_t));
+            memcpy(&out[offset], &length, sizeof(length));
+        }
+
+        inline uint64_t key(const char* header) {
+            uint64_t key;
+            memcpy(&key, header, sizeof(key));
+            return key;
+        }
+
+        inline uint32_t length(const char* header) {
+            uint32_t length;
+            memcpy(&length, header + sizeof(uint64_t), sizeof(length));
+            return length;
+        }
+    }
+
+    /**
+     * \brief External sort of the rows of a table by a key.
+     *
+     * Framed rows (see sorted_row) are appended to buffer(). If the buffer gets larger than the
+     * memory limit, its rows are sorted and written into a temporary file (a run). merge()
+     * sorts the remaining rows and merges them with all runs. Rows with equal keys keep the
+     * order they were added in.
+     *
+     * The temporary files are deleted as soon as they have been created, i.e. they vanish if
+     * the program terminates.
+     */
+    class RowSorter {
+
+        /// maximum number of runs merged at once, more runs are merged in multiple levels
+        static constexpr size_t max_merge_width = 64;
+
+        /// size of the stdio buffers of the temporary files
+        static constexpr size_t file_buffer_size = 1024 * 1024;
+
+        struct Entry {
+            uint64_t key;
+            size_t offset;
+        };
+
+        /**
+         * Temporary file containing framed rows sorted by their key.
+         */
+        class Run {
+
+            FILE* m_file;
+
+            std::unique_ptr<char[]> m_file_buffer;
+
+            /// row read by the last call of next()
+            std::string m_row;
+
+            uint64_t m_key = 0;
+
+        public:
+            Run(const Run&) = delete;
+
+            Run& operator=(const Run&) = delete;
+
+            /**
+             * \throws std::runtime_error if the file cannot be created
+             */
+            explicit Run(const std::string& directory) :
+                m_file(nullptr),
+                m_file_buffer(new char[file_buffer_size]),
+                m_row() {
+                std::string path = directory;
+                if (!path.empty() && path.back() != '/') {
+                    path.push_back('/');
+                }
+                path.append("cerepso-sort-XXXXXX");
+                const int fd = mkstemp(&path[0]);
+                if (fd == -1) {
+                    throw std::runtime_error((boost::format("Cannot create temporary file %1%: %2%\n") % path
+                            % strerror(errno)).str());
+                }
+                unlink(path.c_str());
+                m_file = fdopen(fd, "w+b");
+                if (!m_file) {
+                    close(fd);
+                    throw std::runtime_error((boost::format("Cannot open temporary file %1%: %2%\n") % path
+                            % strerror(errno)).str());
+                }
+                setvbuf(m_file, m_file_buffer.get(), _IOFBF, file_buffer_size);
+            }
+
+            ~Run() {
+                fclose(m_file);
+            }
+
+            /**
+             * \throws std::runtime_error
+             */
+            void write(const char* data, const size_t size) {
+                if (fwrite(data, 1, size, m_file) != size) {
+                    throw std::runtime_error((boost::format("Writing temporary file failed: %1%\n")
+                            % strerror(errno)).str());
+                }
+            }
+
+            /**
+             * Start reading the run from its beginning.
+             *
+             * \throws std::runtime_error
+             */
+            void rewind() {
+                if (fflush(m_file) != 0 || fseek(m_file, 0, SEEK_SET) != 0) {
+                    throw std::runtime_error((boost::format("Writing temporary file failed: %1%\n")
+                            % strerror(errno)).str());
+                }
+            }
+
+            /**
+             * Read the next row.
+             *
+             * \returns false if the end of the run has been reached
+             *
+             * \throws std::runtime_error
+             */
+            bool next() {
+                char header[sorted_row::header_size];
+                const size_t read = fread(header, 1, sizeof(header), m_file);
+                if (read == 0 && feof(m_file)) {
+                    return false;
+                }
+                m_key = sorted_row::key(header);
+                m_row.resize(sorted_row::length(header));
+                if (read != sizeof(header) || fread(&m_row[0], 1, m_row.size(), m_file) != m_row.size()) {
+                    throw std::runtime_error("Reading temporary file failed: file is truncated\n");
+                }
+                return true;
+            }
+
+            uint64_t key() const noexcept {
+                return m_key;
+            }
+
+            const std::string& row() const noexcept {
+                return m_row;
+            }
+        };
+
+        std::string m_directory;
+
+        size_t m_max_memory;
+
+        /// framed rows which have not been written into a run yet
+        std::string m_buffer;
+
+        /// index of #m_buffer, reused for every run
+        std::vector<Entry> m_entries;
+
+        std::vector<std::unique_ptr<Run>> m_runs;
+
+        /**
+         * Sort the rows in #m_buffer. #m_entries refers to the rows afterwards.
+         */
+        void sort_buffer() {
+            m_entries.clear();
+            for (size_t offset = 0; offset < m_buffer.size(); ) {
+                const char* header = m_buffer.data() + offset;
+                m_entries.push_back(Entry{sorted_row::key(header), offset});
+                offset += sorted_row::header_size + sorted_row::length(header);
+            }
+            std::stable_sort(m_entries.begin(), m_entries.end(), [](const Entry& a, const Entry& b) {
+                return a.key < b.key;
+            });
+        }
+
+        /**
+         * Sort #m_buffer and write it into a new run.
+         */
+        void spill() {
+            if (m_buffer.empty()) {
+                return;
+            }
+            sort_buffer();
+            std::unique_ptr<Run> run {new Run{m_directory}};
+            for (const Entry& entry : m_entries) {
+                const char* frame = m_buffer.data() + entry.offset;
+                run->write(frame, sorted_row::header_size + sorted_row::length(frame));
+            }
+            m_runs.push_back(std::move(run));
+            m_buffer.clear();
+            m_entries.clear();
+        }
+
+        /**
+         * Merge runs. Rows with equal keys are passed in the order of the runs.
+         *
+         * \param first first run
+         * \param last end of the runs
+         * \param callback called with the key and the row of every row
+         */
+        template <typename TFunc>
+        static void merge_runs(std::vector<std::unique_ptr<Run>>::iterator first,
+                std::vector<std::unique_ptr<Run>>::iterator last, TFunc&& callback) {
+            // (key, index of the run) of the next row of every run, smallest first
+            using head_type = std::pair<uint64_t, size_t>;
+            std::priority_queue<head_type, std::vector<head_type>, std::greater<head_type>> heads;
+            for (auto it = first; it != last; ++it) {
+                (*it)->rewind();
+                if ((*it)->next()) {
+                    heads.emplace((*it)->key(), static_cast<size_t>(it - first));
+                }
+            }
+            while (!heads.empty()) {
+                const size_t index = heads.top().second;
+                heads.pop();
+                Run& run = **(first + index);
+                callback(run.key(), run.row());
+                if (run.next()) {
+                    heads.emplace(run.key(), index);
+                }
+            }
+        }
+
+    public:
+        /**
+         * \param directory directory to create the temporary files in
+         * \param max_memory size of the rows kept in memory before they are written into a
+         * temporary file (in bytes)
+         */
+        RowSorter(const std::string& directory, const size_t max_memory) :
+            m_directory(directory),
+            m_max_memory(max_memory),
+            m_buffer(),
+            m_entries(),
+            m_runs() {
+        }
+
+        /**
+         * Buffer to append framed rows to. Call possibly_spill() afterwards.
+         */
+        std::string& buffer() noexcept {
+            return m_buffer;
+        }
+
+        /**
+         * Write the buffer into a temporary file if it has reached the memory limit.
+         *
+         * \throws std::runtime_error
+         */
+        void possibly_spill() {
+            if (m_buffer.size() >= m_max_memory) {
+                spill();
+            }
+        }
+
+        /**
+         * Number of temporary files written so far.
+         */
+        size_t run_count() const noexcept {
+            return m_runs.size();
+        }
+
+        /**
+         * Pass all rows added so far to the callback ordered by their key. The sorter is empty
+         * afterwards.
+         *
+         * \param callback function called with a pointer to and the length of every row
+         * (without its frame)
+         *
+         * \throws std::runtime_error
+         */
+        template <typename TFunc>
+        void merge(TFunc&& callback) {
+            if (m_runs.empty()) {
+                // Everything fits into memory.
+                sort_buffer();
+                for (const Entry& entry : m_entries) {
+                    const char* frame = m_buffer.data() + entry.offset;
+                    callback(frame + sorted_row::header_size, static_cast<size_t>(sorted_row::length(frame)));
+                }
+                m_buffer.clear();
+                m_entries.clear();
+                return;
+            }
+            spill();
+            std::string().swap(m_buffer);
+            std::vector<Entry>().swap(m_entries);
+            // Merge consecutive groups of runs until they can be merged at once. This keeps
+            // the order of rows with equal keys.
+            while (m_runs.size() > max_merge_width) {
+                std::vector<std::unique_ptr<Run>> merged;
+                for (size_t i = 0; i < m_runs.size(); i += max_merge_width) {
+                    const size_t end = std::min(i + max_merge_width, m_runs.size());
+                    std::unique_ptr<Run> run {new Run{m_directory}};
+                    std::string header;
+                    merge_runs(m_runs.begin() + i, m_runs.begin() + end, [&](const uint64_t key, const std::string& row) {
+                        header.clear();
+                        sorted_row::append_header(header, key, static_cast<uint32_t>(row.size()));
+                        run->write(header.data(), header.size());
+                        run->write(row.data(), row.size());
+                    });
+                    merged.push_back(std::move(run));
+                    for (size_t j = i; j < end; ++j) {
+                        m_runs[j].reset();
+                    }
+                }
+                m_runs = std::move(merged);
+            }
+            merge_runs(m_runs.begin(), m_runs.end(), [&](const uint64_t /*key*/, const std::string& row) {
+                callback(row.data(), row.size());
+            });
+            m_runs.clear();
+        }
+    };
+}
+
+#endif /* INCLUDE_POSTGRES_DRIVERS_ROW_SORTER_HPP_ */
@@ -10,7 +10,14 @@
 
 #include <libpq-fe.h>
 #include <boost/format.hpp>
+#include "binary_copy.hpp"
 #include "columns.hpp"
+#include "copy_file.hpp"
+#include "copy_writer.hpp"
+#include "row_sorter.hpp"
+#include <ctime>
+#include <iostream>
+#include <memory>
 #include <sstream>
 #include <osmium/osm/types.hpp>
 #include <string.h>
@@ -80,7 +87,129 @@ namespace postgres_drivers {
         /**
          * maximum size of copy buffer
          */
-        static const int BUFFER_SEND_SIZE = 10000;
+        static const int BUFFER_SEND_SIZE = 65536;
+
+        /**
+         * One COPY stream into this table.
+         */
+        struct CopyShard {
+            PGconn* connection;
+
+            /**
+             * file receiving the data instead of the database connection, empty if the table
+             * writes into the database
+             */
+            std::shared_ptr<CopyFile> file;
+
+            /**
+             * writer thread sending data during COPY mode, empty if data is sent synchronously
+             *
+             * This is a shared pointer because tables are returned by value by some factory functions.
+             */
+            std::shared_ptr<CopyWriter> writer;
+
+            /**
+             * data collected until it is large enough to be passed to the writer thread or the database
+             */
+            std::string buffer;
+
+            explicit CopyShard(PGconn* conn) :
+                connection(conn),
+                file(),
+                writer(),
+                buffer() {
+            }
+        };
+
+        /**
+         * additional connections used for COPY only, see open_copy_shards()
+         */
+        std::vector<PGconn*> m_shard_connections;
+
+        /**
+         * COPY streams while in COPY mode, the first one uses #m_database_connection
+         */
+        std::vector<CopyShard> m_copy_shards;
+
+        /// shard which gets the next line if rows are distributed round robin
+        size_t m_next_shard = 0;
+
+        /// shard whose buffer has been returned by the last call of get_copy_buffer()
+        size_t m_current_shard = 0;
+
+        /**
+         * SQL script receiving all commands if the table writes into files (see Config::output_dir),
+         * created on first use by script()
+         */
+        std::shared_ptr<CopyFile> m_script;
+
+        /// sort the rows before they are sent, see sort_rows()
+        bool m_sort_rows = false;
+
+        /// directory for the temporary files of #m_row_sorter
+        std::string m_sort_directory;
+
+        /// memory used by #m_row_sorter before it writes a temporary file (in bytes)
+        size_t m_sort_memory = 0;
+
+        /**
+         * rows collected during COPY mode if the rows are sorted
+         *
+         * This is a shared pointer because tables are returned by value by some factory functions.
+         */
+        std::shared_ptr<RowSorter> m_row_sorter;
+
+        /**
+         * Path of a file in the output directory.
+         */
+        std::string output_path(const std::string& filename) const {
+            std::string path = m_config.output_dir;
+            if (!path.empty() && path.back() != '/') {
+                path.push_back('/');
+            }
+            path.append(filename);
+            return path;
+        }
+
+        /**
+         * Get the SQL script of this table. It is created and added to the manifest of the output
+         * directory (`manifest.sql`) on first use.
+         *
+         * \throws std::runtime_error
+         */
+        CopyFile& script() {
+            if (!m_script) {
+                m_script = std::make_shared<CopyFile>(output_path(m_name + ".sql"), false);
+                const std::string manifest_path = output_path("manifest.sql");
+                FILE* manifest = fopen(manifest_path.c_str(), "ab");
+                if (!manifest) {
+                    throw std::runtime_error((boost::format("Cannot open %1% for writing: %2%\n") % manifest_path
+                            % strerror(errno)).str());
+                }
+                fprintf(manifest, "\\ir %s.sql\n", m_name.c_str());
+                fclose(manifest);
+            }
+            return *m_script;
+        }
+
+        /**
+         * Append a line to the SQL script.
+         *
+         * \param line command
+         * \param terminate add a semicolon if the command does not end with one
+         *
+         * \throws std::runtime_error
+         */
+        void write_to_script(std::string line, const bool terminate = true) {
+            if (terminate && (line.empty() || line.back() != ';')) {
+                line.push_back(';');
+            }
+            line.push_back('\n');
+            if (!script().write(line)) {
+                throw std::runtime_error((boost::format("Writing %1% failed: %2%\n") % script().filename()
+                        % script().error_message()).str());
+            }
+        }
 
         /**
          * create all necessary prepared statements for this table
@@ -89,12 +218,7 @@ namespace postgres_drivers {
          */
         //TODO move to pgimporter
         void create_prepared_statements() {
-            // create delete statement
             std::string query;
-            if (is_osm_object_table_type(m_columns.get_type())) {
-                query= (boost::format("DELETE FROM %1% WHERE osm_id = $1") % m_name).str();
-                create_prepared_statement("delete_statement", query, 1);
-            }
             if (m_columns.get_type() == TableType::POINT) {
                 query = (boost::format("SELECT ST_X(geom), ST_Y(geom) FROM %1% WHERE osm_id = $1") % m_name).str();
                 create_prepared_statement("get_location_from_point_table", query, 1);
@@ -109,19 +233,17 @@ namespace postgres_drivers {
             } else if (m_columns.get_type() == TableType::NODE_WAYS) {
                 query = (boost::format("SELECT way_id FROM %1% WHERE node_id = $1") % m_name).str();
                 create_prepared_statement("get_way_ids", query, 1);
+                query = (boost::format("SELECT DISTINCT way_id FROM %1% WHERE node_id = ANY($1::bigint[])") % m_name).str();
+                create_prepared_statement("get_way_ids_by_nodes", query, 1);
                 query = (boost::format("SELECT node_id, position FROM %1% WHERE way_id = $1") % m_name).str();
                 create_prepared_statement("get_nodes", query, 1);
-                query = (boost::format("DELETE FROM %1% WHERE way_id = $1") % m_name).str();
-                create_prepared_statement("delete_way_node_list", query, 1);
             } else if (m_columns.get_type() == TableType::RELATION_MEMBER_NODES
                     || m_columns.get_type() == TableType::RELATION_MEMBER_WAYS
                     || m_columns.get_type() == TableType::RELATION_MEMBER_RELATIONS) {
                 query = (boost::format("SELECT relation_id FROM %1% WHERE member_id = $1") % m_name).str();
                 create_prepared_statement("get_relation_ids_by_member", query, 1);
-                query = (boost::format("DELETE FROM %1% WHERE relation_id = $1") % m_name).str();
-                create_prepared_statement("delete_relation_members", query, 1);
-                query= (boost::format("DELETE FROM %1% WHERE member_id = $1") % m_name).str();
-                create_prepared_statement("delete_statement", query, 1);
+                query = (boost::format("SELECT DISTINCT relation_id FROM %1% WHERE member_id = ANY($1::bigint[])") % m_name).str();
+                create_prepared_statement("get_relation_ids_by_members", query, 1);
                 query = (boost::format("SELECT member_id, position FROM %1% WHERE relation_id = $1") % m_name).str();
                 create_prepared_statement("get_members_by_relation_id", query, 1);
             } else if (m_columns.get_type() == TableType::RELATION_OTHER) {
@@ -163,6 +285,114 @@ namespace postgres_drivers {
             PQclear(result);
         }
 
+        /**
+         * Send data to the database (or write it into the file of the shard) without any checks
+         * on its content.
+         *
+         * \throws std::runtime_error
+         */
+        void put_copy_data(CopyShard& shard, const std::string& data) {
+            if (shard.file) {
+                if (!shard.file->write(data)) {
+                    throw std::runtime_error((boost::format("Insertion via COPY into %1% failed: %2%\n") % m_name
+                            % shard.file->error_message()).str());
+                }
+                return;
+            }
+            if (PQputCopyData(shard.connection, data.c_str(), data.size()) != 1) {
+                throw std::runtime_error((boost::format("Insertion via COPY into %1% failed: %2%\n") % m_name % PQerrorMessage(shard.connection)).str());
+            }
+        }
+
+        /**
+         * Establish a new connection to the database.
+         *
+         * \throws std::runtime_error
+         */
+        PGconn* connect() {
+            std::string connection_params = "dbname=";
+            connection_params.append(m_config.m_database_name);
+            PGconn* connection = PQconnectdb(connection_params.c_str());
+            if (PQstatus(connection) != CONNECTION_OK) {
+                std::string message = PQerrorMessage(connection);
+                PQfinish(connection);
+                throw std::runtime_error((boost::format("Cannot establish connection to database: %1%\n")
+                    %  message).str());
+            }
+            return connection;
+        }
+
+        /**
+         * Send the buffer of a COPY stream, either directly or via its writer thread.
+         *
+         * \throws std::runtime_error
+         */
+        void flush_shard(CopyShard& shard) {
+            if (shard.buffer.empty()) {
+                return;
+            }
+            if (shard.writer) {
+                shard.writer->push(shard.buffer);
+                shard.buffer.reserve(2 * BUFFER_SEND_SIZE);
+                return;
+            }
+            put_copy_data(shard, shard.buffer);
+            shard.buffer.clear();
+        }
+
+        /**
+         * Pass all rows collected by the row sorter to the COPY streams in the order of their keys.
+         *
+         * Consecutive chunks of rows are distributed round robin among the shards.
+         *
+         * \throws std::runtime_error
+         */
+        void send_sorted_rows() {
+            const time_t ts = time(NULL);
+            std::cerr << (boost::format("Sending sorted rows into %1% (%2% temporary files) …\n") % m_name
+                    % m_row_sorter->run_count()).str();
+            size_t shard_index = 0;
+            m_row_sorter->merge([&](const char* row, const size_t length) {
+                CopyShard& shard = m_copy_shards[shard_index];
+                shard.buffer.append(row, length);
+                if (shard.buffer.size() >= static_cast<size_t>(BUFFER_SEND_SIZE)) {
+                    flush_shard(shard);
+                    shard_index = (shard_index + 1) % m_copy_shards.size();
+                }
+            });
+            m_row_sorter.reset();
+            std::cerr << (boost::format("Sending sorted rows into %1% took %2% seconds.\n") % m_name
+                    % static_cast<int>(time(NULL) - ts)).str();
+        }
+
+        /**
+         * Terminate the COPY stream of a shard.
+         *
+         * The writer thread of the shard has to be finished before.
+         *
+         * \throws std::runtime_error
+         */
+        void end_shard(CopyShard& shard) {
+            if (m_config.binary_copy) {
+                std::string trailer;
+                binary::append_trailer(trailer);
+                put_copy_data(shard, trailer);
+            }
+            if (shard.file) {
+                shard.file->close();
+                return;
+            }
+            if (PQputCopyEnd(shard.connection, nullptr) != 1) {
+                throw std::runtime_error(PQerrorMessage(shard.connection));
+            }
+            PGresult *result = PQgetResult(shard.connection);
+            if (PQresultStatus(result) != PGRES_COMMAND_OK) {
+                throw std::runtime_error((boost::format("COPY END command failed: %1%\n") %  PQerrorMessage(shard.connection)).str());
+                PQclear(result);
+            }
+            PQclear(result);
+        }
+
     public:
         Table() = delete;
 
@@ -174,13 +404,10 @@ namespace postgres_drivers {
                 m_name(table_name),
                 m_config(config),
                 m_copy_mode(false),
-                m_columns(columns) {
-            std::string connection_params = "dbname=";
-            connection_params.append(m_config.m_database_name);
-            m_database_connection = PQconnectdb(connection_params.c_str());
-            if (PQstatus(m_database_connection) != CONNECTION_OK) {
-                throw std::runtime_error((boost::format("Cannot establish connection to database: %1%\n")
-                    %  PQerrorMessage(m_database_connection)).str());
+                m_columns(columns),
+                m_database_connection(nullptr) {
+            if (!writes_to_files()) {
+                m_database_connection = connect();
             }
         }
 
@@ -201,10 +428,86 @@ namespace postgres_drivers {
                 if (m_begin) {
                     commit();
                 }
-                PQfinish(m_database_connection);
+                for (PGconn* connection : m_shard_connections) {
+                    if (connection) {
+                        PQfinish(connection);
+                    }
+                }
+                if (m_database_connection) {
+                    PQfinish(m_database_connection);
+                }
+            }
+        }
+
+        /**
+         * \brief Use multiple connections for COPY.
+         *
+         * Each connection has its own COPY stream (and writer thread). Lines passed to send_line()
+         * are distributed among them by the shard key or round robin, see Config::shard_by_id.
+         * The additional connections run in their own transactions, therefore this should only
+         * be used if the table is not written within a transaction, i.e. not in append mode.
+         *
+         * Call this method before start_copy().
+         *
+         * \param count total number of connections, including the main connection of this table
+         *
+         * \throws std::runtime_error
+         */
+        void open_copy_shards(const size_t count) {
+            if (m_copy_mode) {
+                throw std::runtime_error((boost::format("Cannot add COPY shards to %1%: You are in COPY mode.\n") % m_name).str());
+            }
+            while (m_shard_connections.size() + 1 < count) {
+                // Tables writing into files use one file per shard.
+                m_shard_connections.push_back(writes_to_files() ? nullptr : connect());
             }
         }
 
+        /**
+         * \brief Does this table write into files instead of the database (see Config::output_dir)?
+         */
+        bool writes_to_files() const {
+            return !m_config.output_dir.empty() && !m_name.empty();
+        }
+
+        /**
+         * \brief Number of connections used for COPY.
+         */
+        size_t copy_shard_count() const {
+            return m_shard_connections.size() + 1;
+        }
+
+        /**
+         * \brief Sort the rows by a key before they are sent.
+         *
+         * The rows are collected during COPY mode and sent in the order of their keys by
+         * end_copy(). All rows passed to send_line() or appended to get_copy_buffer() have to
+         * be framed using the functions in postgres_drivers::sorted_row. Rows exceeding the
+         * memory limit are sorted and written into temporary files which are merged at the end.
+         *
+         * Call this method before start_copy().
+         *
+         * \param directory directory for temporary files
+         * \param memory memory used for rows before they are written into a temporary file (in bytes)
+         *
+         * \throws std::runtime_error if in COPY mode
+         */
+        void sort_rows(const std::string& directory, const size_t memory) {
+            if (m_copy_mode) {
+                throw std::runtime_error((boost::format("Cannot sort rows of %1%: You are in COPY mode.\n") % m_name).str());
+            }
+            m_sort_rows = true;
+            m_sort_directory = directory;
+            m_sort_memory = memory;
+        }
+
+        /**
+         * \brief Are the rows of this table sorted before they are sent (see sort_rows())?
+         */
+        bool sorts_rows() const noexcept {
+            return m_sort_rows;
+        }
+
         /**
          * \brief create a prepared statement
          *
@@ -232,21 +535,87 @@ namespace postgres_drivers {
          * \brief Send a line to the database (it will get it from STDIN) during copy mode.
          *
          * This method asserts that the database connection is in COPY mode when this method is called.
+         * If a writer thread is used, the data is queued and sent later. Errors are reported by one
+         * of the following calls of this method or by end_copy().
          *
          * \param line line to send; you may send multiple lines at once as one string, separated by \\n.
+         * If binary COPY is enabled, this has to be one or many rows encoded in the binary format.
          *
          * \throws std::runtime_error
          */
         void send_line(const std::string& line) {
-            assert(m_database_connection);
+            send_line(line, 0);
+        }
+
+        /**
+         * \brief Send a line to the database during copy mode.
+         *
+         * If multiple COPY shards are used and Config::shard_by_id is set, the shard is chosen by
+         * the shard key. Otherwise lines are distributed round robin.
+         *
+         * \param line line to send; you may send multiple lines at once as one string, they will
+         * go to the same shard.
+         * \param shard_key OSM ID of the object
+         *
+         * \throws std::runtime_error
+         */
+        void send_line(const std::string& line, const osmium::object_id_type shard_key) {
+            assert(m_database_connection || writes_to_files());
             if (!m_copy_mode) {
                 throw std::runtime_error((boost::format("Insertion via COPY \"%1%\" failed: You are not in COPY mode!\n") % line).str());
             }
-            if (line[line.size()-1] != '\n') {
+            if (!m_config.binary_copy && line[line.size()-1] != '\n') {
                 throw std::runtime_error((boost::format("Insertion via COPY into %1% failed: Line does not end with \\n\n%2%") % m_name % line).str());
             }
-            if (PQputCopyData(m_database_connection, line.c_str(), line.size()) != 1) {
-                throw std::runtime_error((boost::format("Insertion via COPY \"%1%\" failed: %2%\n") % line % PQerrorMessage(m_database_connection)).str());
+            get_copy_buffer(shard_key).append(line);
+            release_copy_buffer();
+        }
+
+        /**
+         * \brief Get the buffer of a COPY stream to append rows to it directly.
+         *
+         * This avoids building each row in a temporary string. The caller has to append
+         * complete rows only and call release_copy_buffer() afterwards. The buffer must not be
+         * used after that call.
+         *
+         * \param shard_key OSM ID of the object, see send_line()
+         *
+         * \throws std::runtime_error if not in COPY mode
+         */
+        std::string& get_copy_buffer(const osmium::object_id_type shard_key = 0) {
+            if (!m_copy_mode) {
+                throw std::runtime_error((boost::format("Insertion via COPY into %1% failed: You are not in COPY mode!\n") % m_name).str());
+            }
+            if (m_row_sorter) {
+                return m_row_sorter->buffer();
+            }
+            m_current_shard = 0;
+            if (m_copy_shards.size() > 1 && m_config.shard_by_id) {
+                // Multiplicative hashing spreads consecutive IDs evenly.
+                const uint64_t hash = static_cast<uint64_t>(shard_key) * 0x9E3779B97F4A7C15ull;
+                m_current_shard = (hash >> 32) % m_copy_shards.size();
+            } else if (m_copy_shards.size() > 1) {
+                m_current_shard = m_next_shard;
+                m_next_shard = (m_next_shard + 1) % m_copy_shards.size();
+            }
+            return m_copy_shards[m_current_shard].buffer;
+        }
+
+        /**
+         * \brief Finish appending to the buffer returned by get_copy_buffer().
+         *
+         * The buffer is sent to the database if it is large enough.
+         *
+         * \throws std::runtime_error
+         */
+        void release_copy_buffer() {
+            if (m_row_sorter) {
+                m_row_sorter->possibly_spill();
+                return;
+            }
+            CopyShard& shard = m_copy_shards[m_current_shard];
+            if (shard.buffer.size() >= static_cast<size_t>(BUFFER_SEND_SIZE)) {
+                flush_shard(shard);
             }
         }
 
@@ -260,25 +629,73 @@ namespace postgres_drivers {
         /**
          * \brief start COPY mode
          *
-         * Additionally, this method sets #m_copy_mode to `true`.
+         * Additionally, this method sets #m_copy_mode to `true`. If binary COPY is enabled, the
+         * header of the binary format is sent. If Config::copy_queue_size is larger than 0, a
+         * writer thread is started which will own the connection until end_copy() is called.
          *
          * \throws std::runtime_error
          */
         void start_copy() {
-            assert(m_database_connection);
+            assert(m_database_connection || writes_to_files());
+            if (m_sort_rows) {
+                m_row_sorter = std::make_shared<RowSorter>(m_sort_directory, m_sort_memory);
+            }
+            m_copy_shards.emplace_back(m_database_connection);
+            for (PGconn* connection : m_shard_connections) {
+                m_copy_shards.emplace_back(connection);
+            }
+            m_next_shard = 0;
+            std::string columns = " (";
+            for (ColumnsIterator it = m_columns.begin(); it != m_columns.end(); it++) {
+                columns.push_back('"');
+                columns.append(it->name());
+                columns.append("\",");
+            }
+            columns.pop_back();
+            columns.push_back(')');
+            const char* format_option = m_config.binary_copy ? " (FORMAT binary)" : "";
             std::string copy_command = "COPY ";
             copy_command.append(m_name);
-            copy_command.append(" (");
-            for (ColumnsIterator it = m_columns.begin(); it != m_columns.end(); it++) {
-                copy_command.push_back('"');
-                copy_command.append(it->name());
-                copy_command.append("\",");
+            copy_command.append(columns);
+            copy_command.append(" FROM STDIN");
+            copy_command.append(format_option);
+            for (size_t i = 0; i < m_copy_shards.size(); ++i) {
+                CopyShard& shard = m_copy_shards[i];
+                if (writes_to_files()) {
+                    // The files are loaded by psql, paths are relative to the output directory.
+                    std::string filename = m_name;
+                    if (i > 0) {
+                        filename.append((boost::format(".%1%") % i).str());
+                    }
+                    filename.append(m_config.compress_output ? ".copy.gz" : ".copy");
+                    shard.file = std::make_shared<CopyFile>(output_path(filename), m_config.compress_output);
+                    const std::string source = m_config.compress_output
+                            ? (boost::format("PROGRAM 'gzip -dc %1%'") % filename).str()
+                            : (boost::format("'%1%'") % filename).str();
+                    // \copy commands must not end with a semicolon.
+                    write_to_script((boost::format("\\copy %1%%2% FROM %3%%4%") % m_name % columns
+                            % source % format_option).str(), false);
+                } else {
+                    PGresult *result = PQexec(shard.connection, copy_command.c_str());
+                    if (PQresultStatus(result) != PGRES_COPY_IN) {
+                        std::string message = PQerrorMessage(shard.connection);
+                        PQclear(result);
+                        throw std::runtime_error((boost::format("%1% failed: %2%\n") % copy_command % message).str());
+                    }
+                    PQclear(result);
+                }
+                m_copy_mode = true;
+                if (m_config.binary_copy) {
+                    std::string header;
+                    binary::append_header(header);
+                    put_copy_data(shard, header);
+                }
+                if (m_config.copy_queue_size > 0 && shard.file) {
+                    shard.writer = std::make_shared<CopyWriter>(*shard.file, m_name, m_config.copy_queue_size);
+                } else if (m_config.copy_queue_size > 0) {
+                    shard.writer = std::make_shared<CopyWriter>(shard.connection, m_name, m_config.copy_queue_size);
+                }
             }
-            copy_command.pop_back();
-            copy_command.append(") FROM STDIN");
-            PGresult *result = PQexec(m_database_connection, copy_command.c_str());
-            check_and_free_result(result, PGRES_COPY_IN, copy_command);
-            m_copy_mode = true;
         }
 
         /**
@@ -293,17 +710,37 @@ namespace postgres_drivers {
                 // This allows us to call this method even if we are not in copy mode as a measure of safety.
                 return;
             }
-            assert(m_database_connection);
-            if (PQputCopyEnd(m_database_connection, nullptr) != 1) {
-                throw std::runtime_error(PQerrorMessage(m_database_connection));
+            assert(m_database_connection || writes_to_files());
+            if (m_row_sorter) {
+                send_sorted_rows();
             }
-            PGresult *result = PQgetResult(m_database_connection);
-            if (PQresultStatus(result) != PGRES_COMMAND_OK) {
-                throw std::runtime_error((boost::format("COPY END command failed: %1%\n") %  PQerrorMessage(m_database_connection)).str());
-                PQclear(result);
+            // Let all writer threads send their remaining data before the first stream is terminated.
+            for (CopyShard& shard : m_copy_shards) {
+                flush_shard(shard);
             }
+            for (CopyShard& shard : m_copy_shards) {
+                if (!shard.writer) {
+                    continue;
+                }
+                std::shared_ptr<CopyWriter> writer = std::move(shard.writer);
+                writer->finish();
+                if (writer->stalls() > 0) {
+                    std::cerr << (boost::format("COPY into %1%: writer queue was full %2% times, waited %3$.1f s\n")
+                            % m_name % writer->stalls() % writer->stall_seconds()).str();
+                }
+            }
+            for (CopyShard& shard : m_copy_shards) {
+                end_shard(shard);
+            }
+            m_copy_shards.clear();
             m_copy_mode = false;
-            PQclear(result);
+        }
+
+        /**
+         * \brief Does this table use the binary format of COPY?
+         */
+        bool binary_copy() const {
+            return m_config.binary_copy;
         }
 
         /**
@@ -338,10 +775,15 @@ namespace postgres_drivers {
          * \brief Send any SQL query.
          *
          * This query will not return anything, i.e. it is useful for `INSERT` and `DELETE` operations.
+         * If the table writes into files, the query is appended to its SQL script.
          *
          * \param query the query
          */
         void send_query(const char* query) {
+            if (writes_to_files()) {
+                write_to_script(query);
+                return;
+            }
             if (!m_database_connection) {
                 return;
             }
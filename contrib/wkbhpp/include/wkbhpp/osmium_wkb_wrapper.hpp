@@ -27,8 +27,9 @@ namespace wkbhpp {
         using multipolygon_type = std::string;
         using ring_type         = std::string;
 
-        explicit WKBImplementation(int srid, wkb_type wtype = wkb_type::wkb, out_type otype = out_type::binary) :
-            WKBWriter(srid, wtype, otype) {
+        explicit WKBImplementation(int srid, wkb_type wtype = wkb_type::wkb, out_type otype = out_type::binary,
+                const output_buffer* output = nullptr) :
+            WKBWriter(srid, wtype, otype, output) {
         }
 
         point_type make_point(const osmium::geom::Coordinates& xy) const {
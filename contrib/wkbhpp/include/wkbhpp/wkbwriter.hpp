@@ -56,6 +56,7 @@ DEALINGS IN THE SOFTWARE.
 #include <algorithm>
 #include <cstddef>
 #include <cstdint>
+#include <cstring>
 #include <limits>
 #include <stdexcept>
 #include <string>
@@ -87,19 +88,98 @@ namespace wkbhpp {
         str.append(reinterpret_cast<const char*>(&data), sizeof(T));
     }
 
-    inline std::string convert_to_hex(const std::string& str) {
-        static const char* lookup_hex = "0123456789ABCDEF";
-        std::string out;
-        out.reserve(str.size() * 2);
+    namespace detail {
 
-        for (char c : str) {
-            out += lookup_hex[(static_cast<unsigned int>(c) >> 4u) & 0xfu];
-            out += lookup_hex[ static_cast<unsigned int>(c)        & 0xfu];
+        /**
+         * Table with the two hex digits of every possible byte.
+         */
+        struct hex_table {
+            char digits[512];
+
+            hex_table() {
+                static const char* lookup_hex = "0123456789ABCDEF";
+                for (unsigned int i = 0; i < 256; ++i) {
+                    digits[2 * i]     = lookup_hex[(i >> 4u) & 0xfu];
+                    digits[2 * i + 1] = lookup_hex[ i        & 0xfu];
+                }
+            }
+        }; // struct hex_table
+
+        inline const char* hex_digits() {
+            static const hex_table table;
+            return table.digits;
         }
 
+    } // namespace detail
+
+    /**
+     * Append the hex representation of binary data to a string.
+     */
+    inline void append_hex(std::string& out, const char* data, const std::size_t size) {
+        const char* digits = detail::hex_digits();
+        const std::size_t offset = out.size();
+        out.resize(offset + size * 2);
+        char* pos = &out[offset];
+        for (std::size_t i = 0; i < size; ++i) {
+            std::memcpy(pos, digits + 2 * static_cast<unsigned char>(data[i]), 2);
+            pos += 2;
+        }
+    }
+
+    inline std::string convert_to_hex(const std::string& str) {
+        std::string out;
+        append_hex(out, str.data(), str.size());
         return out;
     }
 
+    /**
+     * \brief Buffer a WKBWriter appends its output to instead of returning it.
+     *
+     * Pass a pointer to an instance to the constructor of WKBWriter. As long as a buffer is set,
+     * all methods returning a geometry append it to the buffer and return an empty string. A
+     * geometry is appended only once it is complete. If building it fails, the buffer is left
+     * untouched.
+     */
+    class output_buffer {
+
+        std::string* m_buffer = nullptr;
+
+    public:
+
+        std::string* get() const noexcept {
+            return m_buffer;
+        }
+
+        void set(std::string* buffer) noexcept {
+            m_buffer = buffer;
+        }
+
+    }; // class output_buffer
+
+    /**
+     * Set the buffer of an output_buffer for the lifetime of this object.
+     */
+    class output_scope {
+
+        output_buffer& m_output;
+
+    public:
+
+        output_scope(output_buffer& output, std::string& buffer) noexcept :
+            m_output(output) {
+            m_output.set(&buffer);
+        }
+
+        output_scope(const output_scope&) = delete;
+
+        output_scope& operator=(const output_scope&) = delete;
+
+        ~output_scope() noexcept {
+            m_output.set(nullptr);
+        }
+
+    }; // class output_scope
+
     class WKBWriter {
         /**
          * Type of WKB geometry.
@@ -134,6 +214,7 @@ namespace wkbhpp {
          int m_srid;
          wkb_type m_wkb_type;
          out_type m_out_type;
+         const output_buffer* m_output;
 
          std::size_t m_linestring_size_offset = 0;
          std::size_t m_polygons = 0;
@@ -169,6 +250,35 @@ namespace wkbhpp {
              std::copy_n(reinterpret_cast<const char*>(&s), sizeof(uint32_t), &m_data[offset]);
          }
 
+         /**
+          * Return the geometry or append it to the output buffer.
+          *
+          * If the geometry is appended to the output buffer, the memory of m_data is kept to be
+          * reused for the next geometry.
+          */
+         std::string finish(std::string& data) const {
+             std::string* buffer = m_output ? m_output->get() : nullptr;
+             if (buffer) {
+                 if (m_out_type == out_type::hex) {
+                     append_hex(*buffer, data.data(), data.size());
+                 } else {
+                     buffer->append(data);
+                 }
+                 data.clear();
+                 return std::string{};
+             }
+
+             std::string result;
+             using std::swap;
+             swap(result, data);
+
+             if (m_out_type == out_type::hex) {
+                 return convert_to_hex(result);
+             }
+
+             return result;
+         }
+
     public:
 
          using point_type        = std::string;
@@ -177,24 +287,36 @@ namespace wkbhpp {
          using multipolygon_type = std::string;
          using ring_type         = std::string;
 
-         explicit WKBWriter(int srid, wkb_type wtype = wkb_type::wkb, out_type otype = out_type::binary) :
+         /**
+          * \param srid SRID of the geometries (only written to EWKB)
+          * \param wtype WKB or EWKB
+          * \param otype binary or hex output
+          * \param output optional output buffer, see output_buffer
+          */
+         explicit WKBWriter(int srid, wkb_type wtype = wkb_type::wkb, out_type otype = out_type::binary,
+                 const output_buffer* output = nullptr) :
              m_srid(srid),
              m_wkb_type(wtype),
-             m_out_type(otype) {
+             m_out_type(otype),
+             m_output(output) {
          }
 
          /* Point */
          std::string make_point(const double x, const double y) const {
+             std::string* buffer = m_output ? m_output->get() : nullptr;
+             if (buffer && m_out_type == out_type::binary) {
+                 // A point cannot fail half-way, write it directly.
+                 header(*buffer, wkbPoint, false);
+                 str_push(*buffer, x);
+                 str_push(*buffer, y);
+                 return std::string{};
+             }
+
              std::string data;
              header(data, wkbPoint, false);
              str_push(data, x);
              str_push(data, y);
-
-             if (m_out_type == out_type::hex) {
-                 return convert_to_hex(data);
-             }
-
-             return data;
+             return finish(data);
          }
 
          /* LineString */
@@ -211,16 +333,7 @@ namespace wkbhpp {
 
          std::string linestring_finish(std::size_t num_points) {
              set_size(m_linestring_size_offset, num_points);
-             std::string data;
-
-             using std::swap;
-             swap(data, m_data);
-
-             if (m_out_type == out_type::hex) {
-                 return convert_to_hex(data);
-             }
-
-             return data;
+             return finish(m_data);
          }
 
          /* Polygon */
@@ -256,16 +369,7 @@ namespace wkbhpp {
 
          std::string polygon_finish() {
              set_size(m_polygon_size_offset, m_rings);
-             std::string data;
-
-             using std::swap;
-             swap(data, m_data);
-
-             if (m_out_type == out_type::hex) {
-                 return convert_to_hex(data);
-             }
-
-             return data;
+             return finish(m_data);
          }
 
          /* MultiPolygon */
@@ -316,16 +420,7 @@ namespace wkbhpp {
 
          std::string multipolygon_finish() {
              set_size(m_multipolygon_size_offset, m_polygons);
-             std::string data;
-
-             using std::swap;
-             swap(data, m_data);
-
-             if (m_out_type == out_type::hex) {
-                 return convert_to_hex(data);
-             }
-
-             return data;
+             return finish(m_data);
          }
 
     }; // class WKBWriter
@@ -9,6 +9,7 @@
 #include <osmium/geom/haversine.hpp>
 #include <osmium/geom/mercator_projection.hpp>
 #include <osmium/osm/node.hpp>
+#include <postgres_drivers/binary_copy.hpp>
 
 AddrInterpolationHandler::SecondPassHandler::SecondPassHandler(AddrInterpolationHandler& interpolation_handler) noexcept :
     m_interpolation_handler(interpolation_handler) {
@@ -140,6 +141,10 @@ void AddrInterpolationHandler::add_points_to_str(std::string& query, NodeConstIt
         } else {
             new_hn.increment_numeric(i);
         }
+        if (m_table.binary_copy()) {
+            add_point_binary(query, remote_loc, new_hn, tags1, way);
+            continue;
+        }
         for (auto it = m_table.get_columns().begin(); it != m_table.get_columns().end(); it++) {
             if (it != m_table.get_columns().begin()) {
                 PostgresTable::add_separator_to_stringstream(query);
@@ -187,6 +192,49 @@ void AddrInterpolationHandler::add_points_to_str(std::string& query, NodeConstIt
     }
 }
 
+void AddrInterpolationHandler::add_point_binary(std::string& query, const osmium::Location& location,
+        const HouseNumber& housenumber, const osmium::TagList* tags, const osmium::Way& way) {
+    postgres_drivers::binary::start_row(query, m_table.get_columns().size());
+    for (auto it = m_table.get_columns().begin(); it != m_table.get_columns().end(); it++) {
+        if (it->column_class() == postgres_drivers::ColumnClass::OSM_ID) {
+            postgres_drivers::binary::append_integer_field(query, it->type(), way.id());
+        } else if (it->column_class() == postgres_drivers::ColumnClass::INTERPOLATION_HOUSENUMBER) {
+            std::string number = std::to_string(housenumber.number);
+            if (housenumber.suffix != '\0') {
+                number.push_back(housenumber.suffix);
+            }
+            postgres_drivers::binary::append_bytes_field(query, number.data(), number.size());
+        } else if (it->column_class() == postgres_drivers::ColumnClass::INTERPOLATION_STREET) {
+            postgres_drivers::binary::append_text_field(query, tags->get_value_by_key("addr:street"));
+        } else if (it->column_class() == postgres_drivers::ColumnClass::INTERPOLATION_PLACE) {
+            postgres_drivers::binary::append_text_field(query, tags->get_value_by_key("addr:place"));
+        } else if (it->column_class() == postgres_drivers::ColumnClass::INTERPOLATION_SUBURB) {
+            postgres_drivers::binary::append_text_field(query, tags->get_value_by_key("addr:suburb"));
+        } else if (it->column_class() == postgres_drivers::ColumnClass::INTERPOLATION_POSTCODE) {
+            postgres_drivers::binary::append_text_field(query, tags->get_value_by_key("addr:postcode"));
+        } else if (it->column_class() == postgres_drivers::ColumnClass::INTERPOLATION_CITY) {
+            postgres_drivers::binary::append_text_field(query, tags->get_value_by_key("addr:city"));
+        } else if (it->column_class() == postgres_drivers::ColumnClass::INTERPOLATION_PROVINCE) {
+            postgres_drivers::binary::append_text_field(query, tags->get_value_by_key("addr:province"));
+        } else if (it->column_class() == postgres_drivers::ColumnClass::INTERPOLATION_STATE) {
+            postgres_drivers::binary::append_text_field(query, tags->get_value_by_key("addr:state"));
+        } else if (it->column_class() == postgres_drivers::ColumnClass::INTERPOLATION_COUNTRY) {
+            postgres_drivers::binary::append_text_field(query, tags->get_value_by_key("addr:country"));
+        } else if (it->column_class() == postgres_drivers::ColumnClass::GEOMETRY) {
+            // If creating a geometry fails, we have to use an empty geometry.
+            std::string wkb = postgres_drivers::binary::empty_ewkb(4, 4326);
+            try {
+                wkb = m_table.wkb_factory().create_point(location);
+            } catch (osmium::geometry_error& e) {
+                std::cerr << e.what() << "\n";
+            }
+            postgres_drivers::binary::append_bytes_field(query, wkb.data(), wkb.size());
+        } else {
+            postgres_drivers::binary::append_null(query);
+        }
+    }
+}
+
 osmium::Location AddrInterpolationHandler::get_remote_point(NodeConstIterator it1, NodeConstIterator it2, double fraction) {
     assert(fraction > 0.0 && fraction < 1.0);
     double total_length = 0.0;
@@ -177,6 +177,18 @@ class AddrInterpolationHandler : public osmium::handler::Handler {
             const osmium::TagList* tags1, const osmium::TagList* tags2, const osmium::Way& way,
             InterpolationType type);
 
+    /**
+     * Add one interpolated address point encoded in the binary format of COPY to a string.
+     *
+     * \param query string to add the row to
+     * \param location location of the address point
+     * \param housenumber interpolated house number
+     * \param tags tags of the first node of the segment
+     * \param way OSM way
+     */
+    void add_point_binary(std::string& query, const osmium::Location& location, const HouseNumber& housenumber,
+            const osmium::TagList* tags, const osmium::Way& way);
+
     /**
      * Get location of an interpolated address point.
      *
@@ -8,6 +8,10 @@
 #ifndef CEREPSOCONFIG_HPP_
 #define CEREPSOCONFIG_HPP_
 
+#include <cstdint>
+#include <string>
+#include <vector>
+
 #include <osmium/osm/metadata_options.hpp>
 #include <osmium/osm/tag.hpp>
 #include <postgres_drivers/config.hpp>
@@ -26,6 +30,9 @@ public:
     /// OSM file to read (Osmium will detect the file format based on the file name extension
     std::string m_osm_file = "";
 
+    /// diff files to apply in append mode, in the order they were published
+    std::vector<std::string> m_diff_files;
+
     /// Osm2pgsql style file path
     std::string m_style_file = "";
 
@@ -56,11 +63,55 @@ public:
      */
     bool m_order_by_geohash = true;
 
+    /**
+     * Sort the rows of the tables which would be ordered by ST_GeoHash along a Hilbert curve
+     * before they are sent to the database instead of ordering the tables afterwards.
+     *
+     * \notForAppendMode
+     */
+    bool m_spatial_sort = false;
+
+    /**
+     * Memory used by each table for sorting rows before they are written into temporary
+     * files (in MB).
+     *
+     * \notForAppendMode
+     */
+    size_t m_sort_memory = 256;
+
+    /**
+     * Directory for the temporary files of the spatial sort. The value of the environment
+     * variable TMPDIR or /tmp is used if it is empty.
+     *
+     * \notForAppendMode
+     */
+    std::string m_sort_dir = "";
+
     /**
      * Use append mode (DiffHandler1 and DiffHandler2 instead of ImportHandler and RelationCollector).
      */
     bool m_append = false;
 
+    /**
+     * Replication directory to follow in append mode. Cerepso runs as a daemon and applies
+     * every new diff in this directory. Empty if the diffs are given on the command line.
+     */
+    std::string m_follow_dir = "";
+
+    /// seconds to wait before the state file of #m_follow_dir is read again
+    int m_follow_interval = 60;
+
+    /// sequence number of the first diff to apply if no applied diff is recorded in the database, -1 if unset
+    int64_t m_follow_start = -1;
+
+    /**
+     * Read the input file only once. The node locations of all ways are kept in memory
+     * (WayNodeStore) to build the geometries of the relations.
+     *
+     * \notForAppendMode
+     */
+    bool m_single_pass = false;
+
     /**
      * Enable area support
      */
@@ -88,6 +139,61 @@ public:
      */
     bool m_id_index = true;
 
+    /**
+     * Number of database connections used for COPY into each of the large tables (nodes, untagged nodes,
+     * ways, node-ways mapping).
+     *
+     * \notForAppendMode
+     */
+    size_t m_copy_shards = 1;
+
+    /**
+     * Number of worker threads building the lines for COPY in pass 2 of the import. If it is 1,
+     * the lines are built by the main thread.
+     *
+     * In append mode, it is the number of worker threads recomputing the geometries of ways and
+     * relations whose members have been changed (only if a flat nodes file is used).
+     */
+    size_t m_threads = 1;
+
+    /**
+     * Maximum number of tables which are ordered and indexed concurrently after the import.
+     *
+     * \notForAppendMode
+     */
+    size_t m_finalize_jobs = 1;
+
+    /**
+     * Value of maintenance_work_mem for ordering and indexing the tables (e.g. "4GB"). The
+     * server default is used if it is empty.
+     *
+     * \notForAppendMode
+     */
+    std::string m_maintenance_work_mem = "";
+
+    /**
+     * Value of max_parallel_maintenance_workers for indexing the tables. The server default is
+     * used if it is negative.
+     *
+     * \notForAppendMode
+     */
+    int m_max_parallel_maintenance_workers = -1;
+
+    /**
+     * Resume an import which failed. Completed phases recorded in #m_state_file and the
+     * database are skipped.
+     *
+     * \notForAppendMode
+     */
+    bool m_resume = false;
+
+    /**
+     * File recording the completed phases of an import.
+     *
+     * \notForAppendMode
+     */
+    std::string m_state_file = "cerepso-import.state";
+
     /**
      *
      */
@@ -0,0 +1,62 @@
+/*
+ * change_merger.cpp
+ *
+ *  Created on:  2026-10-17
+ *      Author: Michael Reichert <michael.reichert@geofabrik.de>
+ */
+
+#include <algorithm>
+#include <iostream>
+#include <iterator>
+
+#include <osmium/io/any_input.hpp>
+#include <osmium/osm/object.hpp>
+
+#include "change_merger.hpp"
+
+osmium::memory::Buffer merge_changes(const std::vector<osmium::memory::Buffer>& buffers) {
+    std::vector<const osmium::OSMObject*> objects;
+    size_t committed = 0;
+    for (const auto& buffer : buffers) {
+        for (auto it = buffer.cbegin<osmium::OSMObject>(); it != buffer.cend<osmium::OSMObject>(); ++it) {
+            objects.push_back(&*it);
+        }
+        committed += buffer.committed();
+    }
+    // The stable sort keeps the order of the change sets for equal versions.
+    std::stable_sort(objects.begin(), objects.end(), [](const osmium::OSMObject* lhs, const osmium::OSMObject* rhs) {
+        if (lhs->type() != rhs->type()) {
+            return lhs->type() < rhs->type();
+        }
+        if (lhs->id() != rhs->id()) {
+            return lhs->id() < rhs->id();
+        }
+        return lhs->version() < rhs->version();
+    });
+    osmium::memory::Buffer merged{std::max(committed, static_cast<size_t>(1024)), osmium::memory::Buffer::auto_grow::yes};
+    for (auto it = objects.begin(); it != objects.end(); ++it) {
+        // Only the last element of each run of the same object is kept.
+        auto next = std::next(it);
+        if (next != objects.end() && (*next)->type() == (*it)->type() && (*next)->id() == (*it)->id()) {
+            continue;
+        }
+        merged.add_item(**it);
+        merged.commit();
+    }
+    return merged;
+}
+
+osmium::memory::Buffer read_changes(const std::vector<std::string>& files) {
+    if (files.size() == 1) {
+        return osmium::io::read_file(files.front(), osmium::osm_entity_bits::nwr);
+    }
+    std::vector<osmium::memory::Buffer> buffers;
+    buffers.reserve(files.size());
+    for (const std::string& file : files) {
+        buffers.push_back(osmium::io::read_file(file, osmium::osm_entity_bits::nwr));
+    }
+    std::cerr << "Merging " << files.size() << " diffs ...";
+    osmium::memory::Buffer merged = merge_changes(buffers);
+    std::cerr << " done\n";
+    return merged;
+}
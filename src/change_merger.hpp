@@ -0,0 +1,38 @@
+/*
+ * change_merger.hpp
+ *
+ *  Created on:  2026-10-17
+ *      Author: Michael Reichert <michael.reichert@geofabrik.de>
+ */
+
+#ifndef SRC_CHANGE_MERGER_HPP_
+#define SRC_CHANGE_MERGER_HPP_
+
+#include <string>
+#include <vector>
+
+#include <osmium/memory/buffer.hpp>
+
+/**
+ * \brief Merge change sets and keep only the newest version of each object.
+ *
+ * This is the same as `osmium merge-changes --simplify`. The objects of the result are sorted
+ * by type and ID. If two change sets contain the same version of an object, the object of
+ * the later change set is used.
+ *
+ * \param buffers change sets in the order they were published
+ * \returns buffer with a copy of each remaining object
+ */
+osmium::memory::Buffer merge_changes(const std::vector<osmium::memory::Buffer>& buffers);
+
+/**
+ * \brief Read diff files and merge them into one change set.
+ *
+ * A single file is returned as it has been read.
+ *
+ * \param files diff files in the order they were published
+ * \throws osmium::io_error if a file cannot be read
+ */
+osmium::memory::Buffer read_changes(const std::vector<std::string>& files);
+
+#endif /* SRC_CHANGE_MERGER_HPP_ */
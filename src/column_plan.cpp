@@ -0,0 +1,69 @@
+/*
+ * column_plan.cpp
+ *
+ *  Created on:  2026-10-17
+ *      Author: Michael Reichert <michael.reichert@geofabrik.de>
+ */
+
+#include <cstring>
+#include "column_plan.hpp"
+
+/*static*/ uint32_t ColumnPlan::hash(const char* key) noexcept {
+    // FNV-1a
+    uint32_t result = 2166136261u;
+    for (; *key; ++key) {
+        result ^= static_cast<unsigned char>(*key);
+        result *= 16777619u;
+    }
+    return result;
+}
+
+void ColumnPlan::insert(const int tag_index) {
+    const uint32_t h = hash(m_tag_keys[tag_index].c_str());
+    uint32_t pos = h & m_mask;
+    while (m_hash_table[pos].tag_index != -1) {
+        pos = (pos + 1) & m_mask;
+    }
+    m_hash_table[pos] = HashEntry{h, tag_index};
+}
+
+ColumnPlan::ColumnPlan(const postgres_drivers::Columns& columns) {
+    m_slots.reserve(columns.size());
+    for (postgres_drivers::ColumnsConstIterator it = columns.cbegin(); it != columns.cend(); ++it) {
+        int tag_index = -1;
+        if (it->column_class() == postgres_drivers::ColumnClass::TAG) {
+            // If the style contains a key twice, both columns share the value.
+            tag_index = find_tag_column(it->name().c_str());
+        }
+        if (it->column_class() == postgres_drivers::ColumnClass::TAG && tag_index == -1) {
+            tag_index = static_cast<int>(m_tag_keys.size());
+            m_tag_keys.push_back(it->name());
+            // Keep the load factor at or below 50 %.
+            if (m_tag_keys.size() * 2 > m_hash_table.size()) {
+                const size_t capacity = m_hash_table.empty() ? 16 : m_hash_table.size() * 2;
+                m_hash_table.assign(capacity, HashEntry{0, -1});
+                m_mask = static_cast<uint32_t>(capacity - 1);
+                for (size_t i = 0; i < m_tag_keys.size(); ++i) {
+                    insert(static_cast<int>(i));
+                }
+            } else {
+                insert(tag_index);
+            }
+        }
+        m_slots.push_back(Slot{it->column_class(), it->type(), tag_index});
+    }
+}
+
+int ColumnPlan::find_tag_column(const char* key) const noexcept {
+    if (m_hash_table.empty()) {
+        return -1;
+    }
+    const uint32_t h = hash(key);
+    for (uint32_t pos = h & m_mask; m_hash_table[pos].tag_index != -1; pos = (pos + 1) & m_mask) {
+        const HashEntry& entry = m_hash_table[pos];
+        if (entry.hash == h && strcmp(m_tag_keys[entry.tag_index].c_str(), key) == 0) {
+            return entry.tag_index;
+        }
+    }
+    return -1;
+}
@@ -0,0 +1,88 @@
+/*
+ * column_plan.hpp
+ *
+ *  Created on:  2026-10-17
+ *      Author: Michael Reichert <michael.reichert@geofabrik.de>
+ */
+
+#ifndef SRC_COLUMN_PLAN_HPP_
+#define SRC_COLUMN_PLAN_HPP_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <postgres_drivers/columns.hpp>
+
+/**
+ * \brief Precompiled description of the columns of a table used to build the lines for COPY.
+ *
+ * The plan is built once per table. It contains one slot per column and a hash table which maps
+ * the keys of the tag columns to their position in the list of tag values of an object. This
+ * allows matching all tags of an object with the columns in a single pass over its tag list.
+ */
+class ColumnPlan {
+public:
+    /**
+     * One column of the table.
+     */
+    struct Slot {
+        postgres_drivers::ColumnClass column_class;
+
+        postgres_drivers::ColumnType type;
+
+        /// index in the list of tag values if this is a tag column, -1 otherwise
+        int tag_index;
+    };
+
+private:
+    struct HashEntry {
+        uint32_t hash;
+        /// index of the tag column, -1 if the entry is empty
+        int tag_index;
+    };
+
+    std::vector<Slot> m_slots;
+
+    /// keys of the tag columns, ordered by tag index
+    std::vector<std::string> m_tag_keys;
+
+    /// open addressing hash table, its size is a power of two
+    std::vector<HashEntry> m_hash_table;
+
+    uint32_t m_mask = 0;
+
+    static uint32_t hash(const char* key) noexcept;
+
+    /// Add a tag column to the hash table. The table must have space left.
+    void insert(const int tag_index);
+
+public:
+    ColumnPlan() = default;
+
+    explicit ColumnPlan(const postgres_drivers::Columns& columns);
+
+    const std::vector<Slot>& slots() const noexcept {
+        return m_slots;
+    }
+
+    /**
+     * Number of columns filled with the values of tags.
+     */
+    size_t tag_column_count() const noexcept {
+        return m_tag_keys.size();
+    }
+
+    /**
+     * Get the tag column a key is written to.
+     *
+     * This method does not allocate any memory.
+     *
+     * \param key key of the tag
+     *
+     * \returns index of the tag column or -1 if there is no column for this key
+     */
+    int find_tag_column(const char* key) const noexcept;
+};
+
+#endif /* SRC_COLUMN_PLAN_HPP_ */
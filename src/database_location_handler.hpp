@@ -48,6 +48,13 @@ public:
      */
     osmium::Location get_node_location(const osmium::object_id_type id) const;
 
+    /**
+     * Lookups use the database connections of the nodes tables which must not be shared by threads.
+     */
+    bool concurrent_lookups() const noexcept {
+        return false;
+    }
+
     /**
      * Retrieve locations of all nodes in the way from storage and add
      * them to the way object.
@@ -17,7 +17,7 @@
 void DiffHandler1::node(const osmium::Node& node) {
     // If node has version 1, we don't have to check if it already exists.
     // The latter check is necessary to get along with somehow broken diff files (or handcrafted diffs).
-    if (node.version() == 1 && !node.deleted()) {
+    if (node.version() == 1 && !node.deleted() && !m_replay) {
         return;
     }
     // expire tiles where the node has been before
@@ -40,21 +40,13 @@ void DiffHandler1::node(const osmium::Node& node) {
             // Because this happens quite often, we will do nothing.
         }
     }
-    // delete old node, try first untagged nodes table
-    // TODO untagged_nodes table maybe not necessary any more
-    if (!m_config.m_driver_config.untagged_nodes) {
-        m_nodes_table.delete_object(node.id());
-    } else {
-        if (!m_untagged_nodes_table->delete_object(node.id())) {
-            m_nodes_table.delete_object(node.id());
-        }
-    }
+    m_deleted_nodes.push_back(node.id());
 }
 
 
 void DiffHandler1::way(const osmium::Way& way) {
     // The latter check is necessary to get along with somehow broken diff files (or handcrafted diffs).
-    if (way.version() == 1 && !way.deleted()) {
+    if (way.version() == 1 && !way.deleted() && !m_replay) {
         return;
     }
     if (m_config.m_expiry_enabled) {
@@ -66,30 +58,51 @@ void DiffHandler1::way(const osmium::Way& way) {
             m_expire_tiles->expire_from_geos_linestring(old_geom.get());
         }
     }
-    m_ways_linear_table.delete_object(way.id());
-    // A polygon might have been written to both the way and the polygon table. Therefore we have to check both.
-    if (m_config.m_areas) {
-        m_areas_table->delete_object(way.id());
-    }
-    if (m_config.m_driver_config.updateable) {
-        m_node_ways_table->delete_way_node_list(way.id());
-    }
+    m_deleted_ways.push_back(way.id());
 }
 
 
 void DiffHandler1::relation(const osmium::Relation& relation) {
     // The latter check is necessary to get along with somehow broken diff files (or handcrafted diffs).
-    if (relation.version() > 1 || relation.deleted()) {
-        m_relations_table.delete_object(relation.id());
-        // A polygon might have been written to both the relations and the polygon table. Therefore we have to check both.
-        if (m_config.m_areas) {
-            m_areas_table->delete_object(relation.id());
-        }
-        m_node_relations_table->delete_relation_members(relation.id());
-        m_way_relations_table->delete_relation_members(relation.id());
-        m_relation_relations_table->delete_relation_members(relation.id());
+    if (relation.version() > 1 || relation.deleted() || m_replay) {
+        m_deleted_relations.push_back(relation.id());
     }
 }
 
 void DiffHandler1::area(const osmium::Area&) {
 }
+
+void DiffHandler1::delete_objects() {
+    std::cerr << "Deleting " << m_deleted_nodes.size() << " nodes, " << m_deleted_ways.size() << " ways and "
+            << m_deleted_relations.size() << " relations ...";
+    // A node is either in the untagged nodes table or in the nodes table.
+    // TODO untagged_nodes table maybe not necessary any more
+    if (m_config.m_driver_config.untagged_nodes) {
+        m_untagged_nodes_table->delete_from_list(m_deleted_nodes);
+    }
+    m_nodes_table.delete_from_list(m_deleted_nodes);
+
+    m_ways_linear_table.delete_from_list(m_deleted_ways);
+    if (m_config.m_driver_config.updateable) {
+        m_node_ways_table->delete_from_list(m_deleted_ways, "way_id");
+    }
+
+    m_relations_table.delete_from_list(m_deleted_relations);
+    m_node_relations_table->delete_from_list(m_deleted_relations, "relation_id");
+    m_way_relations_table->delete_from_list(m_deleted_relations, "relation_id");
+    m_relation_relations_table->delete_from_list(m_deleted_relations, "relation_id");
+
+    // A polygon might have been written to both the way or relations table and the polygon table.
+    // Therefore we have to check both. Areas built from relations have negative IDs.
+    if (m_config.m_areas) {
+        std::vector<osmium::object_id_type> area_ids {m_deleted_ways};
+        for (const osmium::object_id_type id : m_deleted_relations) {
+            area_ids.push_back(-id);
+        }
+        m_areas_table->delete_from_list(area_ids);
+    }
+    m_deleted_nodes.clear();
+    m_deleted_ways.clear();
+    m_deleted_relations.clear();
+    std::cerr << " done\n";
+}
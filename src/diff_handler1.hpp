@@ -33,6 +33,18 @@ private:
 
     geos_factory_type m_geom_factory;
 
+    /// IDs of the nodes to be deleted by delete_objects()
+    std::vector<osmium::object_id_type> m_deleted_nodes;
+
+    /// IDs of the ways to be deleted by delete_objects()
+    std::vector<osmium::object_id_type> m_deleted_ways;
+
+    /// IDs of the relations to be deleted by delete_objects()
+    std::vector<osmium::object_id_type> m_deleted_relations;
+
+    /// The diff may have been applied partially before, objects with version 1 are deleted as well.
+    bool m_replay = false;
+
 public:
     DiffHandler1(CerepsoConfig& config, PostgresTable& nodes_table, PostgresTable* untagged_nodes_table, PostgresTable& ways_table,
             PostgresTable& relations_table, PostgresTable& node_ways_table, PostgresTable& node_relations_table,
@@ -73,9 +85,19 @@ public:
 
     ~DiffHandler1() {};
 
+    /**
+     * \brief Delete objects with version 1, too.
+     *
+     * Call this if the diff may have been applied partially before. Otherwise the objects
+     * created by the diff would be inserted a second time.
+     */
+    void replay() noexcept {
+        m_replay = true;
+    }
+
 
     /**
-     * Expire tiles at the old location of the node if there is any. Delete node from database.
+     * Expire tiles at the old location of the node if there is any. Remember the node to be deleted.
      *
      * This method does not use the location of the node. Instead the location is looked up
      * in the persisent location cache.
@@ -83,7 +105,7 @@ public:
     void node(const osmium::Node& node);
 
     /**
-     * Expire tiles along the old geometry of the way and delete it from database.
+     * Expire tiles along the old geometry of the way and remember it to be deleted.
      *
      * This method does not need valid locations on the node references. Instead the locations are
      * looked up in the persisent location cache.
@@ -94,6 +116,16 @@ public:
 
     /// Handler not used but has to implemented because it is a full virtual method.
     void area(const osmium::Area& area);
+
+    /**
+     * Delete all objects collected by the callbacks from the database. There is one `DELETE`
+     * command per table.
+     *
+     * Call this method after the diff has been read.
+     *
+     * \throws std::runtime_error
+     */
+    void delete_objects();
 };
 
 
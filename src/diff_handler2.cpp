@@ -5,15 +5,31 @@
  *      Author: michael
  */
 
+#include <mutex>
+
 #include <geos/geom/CoordinateArraySequenceFactory.h>
-#include <geos/geom/CoordinateArraySequence.h>
-#include <geos/geom/GeometryFactory.h>
-#include <geos/io/WKBWriter.h>
-#include <geos/geom/LineString.h>
+#include <geos/geom/CoordinateSequence.h>
 #include <osmium/osm/relation.hpp>
 
 #include "diff_handler2.hpp"
 #include "postgres_table.hpp"
+#include "worker_pool.hpp"
+
+namespace {
+
+    /// number of pending ways whose node lists are read from the database at once
+    constexpr size_t pending_ways_batch_size = 1000;
+
+    /// number of pending relations whose members are read from the database at once
+    constexpr size_t pending_relations_batch_size = 100;
+
+    /// maximum number of node lists of ways kept in the cache
+    constexpr size_t way_nodes_cache_size = 100000;
+
+    /// maximum number of member lists of relations kept in the cache
+    constexpr size_t relation_members_cache_size = 10000;
+
+} // anonymous namespace
 
 
 DiffHandler2::DiffHandler2(CerepsoConfig& config, PostgresTable& nodes_table, PostgresTable* untagged_nodes_table, PostgresTable& ways_table,
@@ -29,17 +45,19 @@ DiffHandler2::DiffHandler2(CerepsoConfig& config, PostgresTable& nodes_table, Po
         m_expire_tiles(expire_tiles),
         m_pending_ways(),
         m_pending_relations(),
+        m_changed_nodes(),
+        m_changed_ways(),
         m_pending_ways_idx(0),
         m_pending_relations_idx(0),
+        m_member_cache(way_nodes_cache_size, relation_members_cache_size),
+        m_pending_updates(node_ways_table, node_relations_table, way_relations_table, relation_relations_table,
+                m_config.m_areas ? areas_table : nullptr, ways_table, location_index, m_member_cache),
+        m_workers(),
         m_mp_manager(mp_manager),
         m_relation_buffer(100000, osmium::memory::Buffer::auto_grow::yes),
         m_new_areas_buffer(),
         m_updated_areas_buffer(),
-#ifdef GEOS_36
-        m_geom_factory(geos::geom::GeometryFactory::create().release(), GEOSGeometryFactoryDeleter())
-#else
-        m_geom_factory(new geos::geom::GeometryFactory{})
-#endif
+        m_relation_geometries()
 {
     m_untagged_nodes_table->start_copy();
     m_nodes_table.start_copy();
@@ -75,15 +93,15 @@ DiffHandler2::DiffHandler2(PostgresTable& nodes_table, PostgresTable* untagged_n
     m_expire_tiles(expire_tiles),
     m_pending_ways_idx(0),
     m_pending_relations_idx(0),
+    m_member_cache(way_nodes_cache_size, relation_members_cache_size),
+    m_pending_updates(node_ways_table, node_relations_table, way_relations_table, relation_relations_table,
+            m_config.m_areas ? areas_table : nullptr, ways_table, location_index, m_member_cache),
+    m_workers(),
     m_mp_manager(mp_manager),
     m_relation_buffer(100000, osmium::memory::Buffer::auto_grow::yes),
     m_new_areas_buffer(),
     m_updated_areas_buffer(),
-#ifdef GEOS_36
-        m_geom_factory(geos::geom::GeometryFactory::create().release(), GEOSGeometryFactoryDeleter())
-#else
-        m_geom_factory(new geos::geom::GeometryFactory{})
-#endif
+    m_relation_geometries()
 {
     m_new_areas_buffer.set_callback([&](osmium::memory::Buffer&& buffer) {
         for (auto& item : buffer) {
@@ -112,88 +130,39 @@ void DiffHandler2::node(const osmium::Node& node) {
     }
     //TODO Expire tiles
     handle_node(node);
-    // check if ways have to be updated
-    std::vector<osmium::object_id_type> new_way_ids = m_node_ways_table->get_way_ids(node.id());
-    for (auto id : new_way_ids) {
-        m_pending_ways.push_back(id);
-    }
-    // check if relations have to be updated
-    std::vector<osmium::object_id_type> rel_ids = m_node_relations_table->get_relation_ids_by_member(node.id());
-    for (auto id : rel_ids) {
-        m_pending_relations.push_back(id);
-    }
+    // Ways and relations which have to be updated are looked up by write_new_nodes().
+    m_changed_nodes.push_back(node.id());
 }
 
 osmium::Location DiffHandler2::get_point_from_tables(osmium::object_id_type id) {
     return m_location_index.get_node_location(id);
 }
 
-void DiffHandler2::update_relation(const osmium::object_id_type id) {
-    // get relation members from relations table
-    std::vector<postgres_drivers::MemberIdTypePos> members;
-    m_node_relations_table->get_members_by_id_and_type(members, id, osmium::item_type::node);
-    m_way_relations_table->get_members_by_id_and_type(members, id, osmium::item_type::way);
-    m_relation_relations_table->get_members_by_id_and_type(members, id, osmium::item_type::relation);
-    std::sort(members.begin(), members.end());
-    std::vector<geos::geom::Geometry*>* points = new std::vector<geos::geom::Geometry*>();
-    std::vector<geos::geom::Geometry*>* linestrings = new std::vector<geos::geom::Geometry*>();
-    for (auto it = members.begin(); it != members.end(); ++it) {
-        if (it->type == osmium::item_type::node) {
-            osmium::Location loc = get_point_from_tables(it->id);
-            if (loc.valid()) {
-                std::unique_ptr<geos::geom::Point> point (m_geom_factory->createPoint(
-                        geos::geom::Coordinate(loc.lon_without_check(), loc.lat_without_check())));
-                points->push_back(point.release());
-            }
-        } else if (it->type == osmium::item_type::way) {
-            //TODO not DRY with insert_relation()
-            std::vector<MemberNode> nodes = m_node_ways_table->get_way_nodes(it->id);
-            std::unique_ptr<std::vector<geos::geom::Coordinate>> coordinates {new std::vector<geos::geom::Coordinate>};
-            coordinates->reserve(nodes.size());
-            bool all_locations_valid = true;
-            for (auto itn = nodes.begin(); itn != nodes.end(); ++itn) {
-                osmium::Location loc = get_point_from_tables(itn->node_ref.ref());
-                all_locations_valid &= loc.valid();
-                coordinates->emplace_back(loc.lon(), loc.lat());
-            }
-            if (!all_locations_valid) {
-                // some nodes are missing for this way
-                continue;
-            }
-            geos::geom::CoordinateArraySequenceFactory coord_sequence_factory;
-            std::unique_ptr<geos::geom::CoordinateSequence> coord_sequence {coord_sequence_factory.create(coordinates.release(), 2)};
-            std::unique_ptr<geos::geom::LineString> linestring {m_geom_factory->createLineString(coord_sequence.release())};
-            if (linestring) {
-                linestrings->push_back(linestring.release());
-            }
-        }
-        // We do not add the geometry of this relation to the GeometryCollection.
-        /// \todo support one level of nested relations
-    }
-    geos::geom::MultiPoint* multipoints = m_geom_factory->createMultiPoint(points);
-    geos::geom::MultiLineString* multilinestrings = m_geom_factory->createMultiLineString(linestrings);
-    // add multipoints to query string
-    // convert to WKB
-    std::stringstream multipoint_stream;
-    geos::io::WKBWriter wkb_writer;
-    wkb_writer.writeHEX(*multipoints, multipoint_stream);
-    delete multipoints;
-    // add multilinestrings to query string
-    // convert to WKB
-    std::stringstream multilinestring_stream;
-    wkb_writer.writeHEX(*multilinestrings, multilinestring_stream);
-    std::string mp_str = multipoint_stream.str();
-    std::string ml_str = multilinestring_stream.str();
-    m_relations_table.update_relation_member_geometry(id, mp_str.c_str(), ml_str.c_str());
-    //TODO code before this "if" becomes unnecessary once ways are not written to lines table any more if they are considered as areas only.
-    if (m_config.m_areas && (m_areas_table->count_osm_id(-id) > 0)) {
-        update_multipolygon_geometry(id, members);
-    }
-    delete multilinestrings;
+bool DiffHandler2::add_member_way_geometry(const osmium::object_id_type way_id,
+        std::vector<geos::geom::Coordinate>* coordinates) {
+    return PendingUpdates::add_member_way_geometry(m_relation_geometries, m_location_index,
+            m_member_cache.get_way_nodes(*m_node_ways_table, way_id), coordinates);
+}
+
+void DiffHandler2::apply_pending_updates(PendingUpdates::Result& result) {
+    for (const auto& geometry : result.way_geometries) {
+        m_ways_linear_table.queue_geometry_update(geometry.first, geometry.second.c_str());
+    }
+    for (const auto& geometry : result.area_geometries) {
+        m_areas_table->queue_geometry_update(geometry.first, geometry.second.c_str());
+    }
+    for (const auto& geometries : result.relation_geometries) {
+        m_relations_table.queue_relation_member_geometry_update(geometries.id, geometries.points.c_str(),
+                geometries.lines.c_str());
+    }
+    m_changed_ways.insert(m_changed_ways.end(), result.updated_ways.begin(), result.updated_ways.end());
+    for (auto& multipolygon : result.multipolygons) {
+        update_multipolygon_geometry(multipolygon.first, multipolygon.second, result.way_nodes);
+    }
 }
 
 void DiffHandler2::update_multipolygon_geometry(const osmium::object_id_type id,
-        std::vector<postgres_drivers::MemberIdTypePos>& members) {
+        std::vector<postgres_drivers::MemberIdTypePos>& members, const PendingUpdates::way_nodes_map_type& way_nodes) {
     std::vector<const osmium::Way*> ways;
     ways.reserve(members.size());
     for (auto& m : members) {
@@ -205,9 +174,9 @@ void DiffHandler2::update_multipolygon_geometry(const osmium::object_id_type id,
             // The diff file contained the way.
             ways.push_back(way);
         } else {
-            // Fetch the elements of the way from the database and reconstruct the OSM object.
-            std::vector<MemberNode> nodes = m_node_ways_table->get_way_nodes(m.id);
-            if (nodes.size() < 2) {
+            // Reconstruct the OSM object from the elements of the way read from the database.
+            const auto found = way_nodes.find(m.id);
+            if (found == way_nodes.end() || found->second.size() < 2) {
                 // No nodes found for this member. Skip it and set its ID to 0.
                 // The ID is set to 0 to mark this member as incomplete and avoid that we
                 // add it to our artificially created relation below.
@@ -221,7 +190,7 @@ void DiffHandler2::update_multipolygon_geometry(const osmium::object_id_type id,
                 way_builder.set_user("");
                 {
                     osmium::builder::WayNodeListBuilder wnl_builder{m_relation_buffer, &way_builder};
-                    for (auto n : nodes) {
+                    for (auto n : found->second) {
                         n.node_ref.set_location(m_location_index.get_node_location(n.node_ref.ref()));
                         wnl_builder.add_node_ref(n.node_ref);
                     }
@@ -265,10 +234,10 @@ void DiffHandler2::update_multipolygon_geometry(const osmium::object_id_type id,
 void DiffHandler2::insert_relation(const osmium::Relation& relation, std::string& copy_buffer) {
     //TODO immediatedly return if multipolygon relations should not be written into the relations table (if areas are enabled)
     try {
-        std::vector<geos::geom::Geometry*>* points = new std::vector<geos::geom::Geometry*>();
-        std::vector<geos::geom::Geometry*>* linestrings = new std::vector<geos::geom::Geometry*>();
+        m_relation_geometries.clear();
         // check if this relation should trigger a tile expiration
         bool trigger_tile_expiry = m_config.m_expiry_enabled && m_config.expire_this_relation(relation.tags());
+        std::vector<geos::geom::Coordinate> coordinates;
         for (const auto& member : relation.members()) {
             if ((member.type() == osmium::item_type::node)) {
                 osmium::Location loc = get_point_from_tables(member.ref());
@@ -276,50 +245,23 @@ void DiffHandler2::insert_relation(const osmium::Relation& relation, std::string
                     if (trigger_tile_expiry) {
                         m_expire_tiles->expire_from_point(loc);
                     }
-                    std::unique_ptr<geos::geom::Point> point (m_geom_factory->createPoint(geos::geom::Coordinate(loc.lon(), loc.lat())));
-                    points->push_back(point.release());
+                    m_relation_geometries.add_point(loc);
                 }
             }
             else if ((member.type() == osmium::item_type::way)) {
-                std::vector<MemberNode> nodes = m_node_ways_table->get_way_nodes(member.ref());
-                std::unique_ptr<std::vector<geos::geom::Coordinate>> coordinates {new std::vector<geos::geom::Coordinate>()};
-                coordinates->reserve(nodes.size());
-                std::vector<MemberNode>::iterator itn = nodes.begin();
-                std::vector<geos::geom::Coordinate>::iterator itc = coordinates->begin();
-                for (; itn != nodes.end() && itc != coordinates->end(); ++itn, ++itc) {
-                    osmium::Location loc = get_point_from_tables(itn->node_ref.ref());
-                    itc->x = loc.lon();
-                    itc->y = loc.lat();
-                }
-                geos::geom::CoordinateArraySequenceFactory coord_sequence_factory;
-                std::unique_ptr<geos::geom::CoordinateSequence> coord_sequence {coord_sequence_factory.create(coordinates.release(), 2)};
-                if (trigger_tile_expiry) {
+                coordinates.clear();
+                if (add_member_way_geometry(member.ref(), trigger_tile_expiry ? &coordinates : nullptr)
+                        && trigger_tile_expiry) {
+                    geos::geom::CoordinateArraySequenceFactory coord_sequence_factory;
+                    std::unique_ptr<geos::geom::CoordinateSequence> coord_sequence {coord_sequence_factory.create(
+                            new std::vector<geos::geom::Coordinate>(std::move(coordinates)), 2)};
                     m_expire_tiles->expire_from_coord_sequence(coord_sequence.get());
                 }
-                std::unique_ptr<geos::geom::LineString> linestring {m_geom_factory->createLineString(coord_sequence.release())};
-                if (linestring) {
-                    linestrings->push_back(linestring.release());
-                }
             }
             // We do not add the geometry of this relation to the GeometryCollection.
             /// \todo support one level of nested relations
         }
-        // create GeometryCollection
-        geos::geom::MultiPoint* multipoints = m_geom_factory->createMultiPoint(points);
-        geos::geom::MultiLineString* multilinestrings = m_geom_factory->createMultiLineString(linestrings);
-        // add multipoints to query string
-        // convert to WKB
-        std::stringstream multipoint_stream;
-        geos::io::WKBWriter wkb_writer;
-        wkb_writer.writeHEX(*multipoints, multipoint_stream);
-        delete multipoints;
-        // add multilinestrings to query string
-        // convert to WKB
-        std::stringstream multilinestring_stream;
-        wkb_writer.writeHEX(*multilinestrings, multilinestring_stream);
-        delete multilinestrings;
-        PostgresHandler::prepare_relation_query(relation, copy_buffer, multipoint_stream,
-                multilinestring_stream, m_relations_table);
+        PostgresHandler::prepare_relation_query(relation, copy_buffer, m_relation_geometries, m_relations_table);
         m_relations_table.send_line(copy_buffer);
     }
     catch (osmium::geometry_error& e) {
@@ -341,11 +283,9 @@ void DiffHandler2::way(const osmium::Way& way) {
     if (with_tags) {
         m_ways_linear_table.send_line(prepare_query(way, m_ways_linear_table, nullptr));
     }
-    // check if relations have to be updated
-    std::vector<osmium::object_id_type> rel_ids = m_way_relations_table->get_relation_ids_by_member(way.id());
-    for (auto id : rel_ids) {
-        m_pending_relations.push_back(id);
-    }
+    // Relations which have to be updated are looked up by write_new_ways().
+    m_changed_ways.push_back(way.id());
+    m_member_cache.invalidate_way(way.id());
     // update list of member nodes
     m_node_ways_table->send_line(prepare_node_way_query(way));
     // expire tiles
@@ -368,58 +308,6 @@ void DiffHandler2::way(const osmium::Way& way) {
     }
 }
 
-void DiffHandler2::update_way(const osmium::object_id_type id) {
-    //TODO trigger tile expiry
-    // Check if we have to update an area
-    bool area_to_update = m_config.m_areas && (m_areas_table->count_osm_id(id) > 0);
-    // get node list of that way
-    std::vector<MemberNode> member_nodes = m_node_ways_table->get_way_nodes(id);
-    //TODO PostgresTable::get_way_nodes should return std::vector<osmium::NodeRef> directly.
-    std::vector<osmium::NodeRef> node_refs;
-    // add locations
-    std::string wkb = "010200000000000000";
-    try {
-        m_ways_linear_table.wkb_factory().linestring_start();
-        for (auto& n : member_nodes) {
-            n.node_ref.set_location(m_location_index.get_node_location(n.node_ref.ref()));
-        }
-        for (auto& n : member_nodes) {
-            node_refs.push_back(n.node_ref);
-        }
-        size_t points = m_ways_linear_table.wkb_factory().fill_linestring(node_refs.begin(), node_refs.end());
-        wkb = m_ways_linear_table.wkb_factory().linestring_finish(points);
-
-        // This point is only reached if a valid geometry could be build. If so,
-        // trigger a geometry update of all relations using this way.
-        // Check if relations have to be updated:
-        std::vector<osmium::object_id_type> rel_ids = m_way_relations_table->get_relation_ids_by_member(id);
-        for (auto id : rel_ids) {
-            m_pending_relations.push_back(id);
-        }
-    } catch (osmium::geometry_error& e) {
-        std::cerr << e.what() << "\n";
-    } catch (osmium::not_found& e) {
-        std::cerr << e.what() << "\n";
-    }
-    m_ways_linear_table.update_geometry(id, wkb.c_str());
-    //TODO code before this "if" becomes unnecessary once ways are not written to lines table any more if they are considered as areas only.
-    if (!area_to_update) {
-        return;
-    }
-    wkb = "010300000000000000";
-    try {
-        m_areas_table->wkb_factory().polygon_start();
-        size_t points = m_areas_table->wkb_factory().fill_polygon_unique(node_refs.begin(), node_refs.end());
-        wkb = m_areas_table->wkb_factory().polygon_finish(points);
-    } catch (osmium::geometry_error& e) {
-        //TODO delete entry if something failed
-        std::cerr << e.what() << "\n";
-    } catch (osmium::not_found& e) {
-        std::cerr << e.what() << "\n";
-    }
-    m_areas_table->update_geometry(id, wkb.c_str());
-}
-
 void DiffHandler2::update_area_geometry(const osmium::Area& area) {
     std::string wkb = "010300000000000000";
     try {
@@ -430,7 +318,8 @@ void DiffHandler2::update_area_geometry(const osmium::Area& area) {
     } catch (osmium::not_found& e) {
         std::cerr << e.what() << "\n";
     }
-    m_areas_table->update_geometry(area.orig_id(), wkb.c_str());
+    // Areas built from relations have negative IDs.
+    m_areas_table->queue_geometry_update(area.from_way() ? area.orig_id() : -area.orig_id(), wkb.c_str());
 }
 
 void DiffHandler2::relation(const osmium::Relation& relation) {
@@ -444,6 +333,7 @@ void DiffHandler2::relation(const osmium::Relation& relation) {
     if (relation.deleted()) {
         return;
     }
+    m_member_cache.invalidate_relation(relation.id());
     std::string copy_buffer;
     insert_relation(relation, copy_buffer);
     // write list of relation members to the database
@@ -506,7 +396,7 @@ void DiffHandler2::incomplete_relation(const osmium::Relation& relation) {
             ways.push_back(way);
         } else {
             //fetch elements from database
-            std::vector<MemberNode> nodes = m_node_ways_table->get_way_nodes(member.ref());
+            std::vector<MemberNode> nodes = m_member_cache.get_way_nodes(*m_node_ways_table, member.ref());
             {
                 osmium::builder::WayBuilder way_builder(m_relation_buffer);
                 osmium::Way& reconstructeded_way = static_cast<osmium::Way&>(way_builder.object());
@@ -538,12 +428,21 @@ void DiffHandler2::incomplete_relation(const osmium::Relation& relation) {
 void DiffHandler2::flush() {
     m_new_areas_buffer.flush();
     m_updated_areas_buffer.flush();
+    if (m_areas_table) {
+        m_areas_table->apply_geometry_updates();
+    }
 }
 
 void DiffHandler2::write_new_nodes() {
     std::cerr << "write_new_nodes\n";
     m_nodes_table.end_copy();
     m_untagged_nodes_table->end_copy();
+    // check if ways and relations have to be updated
+    std::cerr << "looking up ways and relations of " << m_changed_nodes.size() << " nodes ...";
+    m_node_ways_table->get_way_ids(m_changed_nodes, m_pending_ways);
+    m_node_relations_table->get_relation_ids_by_members(m_changed_nodes, m_pending_relations);
+    m_changed_nodes.clear();
+    std::cerr << " done\n";
     m_ways_linear_table.start_copy();
     if (m_areas_table) {
         m_areas_table->start_copy();
@@ -570,6 +469,12 @@ void DiffHandler2::write_new_ways() {
         m_areas_table->end_copy();
     }
     work_on_pending_ways();
+    m_ways_linear_table.apply_geometry_updates();
+    // check if relations have to be updated
+    std::cerr << "looking up relations of " << m_changed_ways.size() << " ways ...";
+    m_way_relations_table->get_relation_ids_by_members(m_changed_ways, m_pending_relations);
+    m_changed_ways.clear();
+    std::cerr << " done\n";
     // sort list of pending relations
     std::cerr << "sorting list of pending relations ...";
     std::sort(m_pending_relations.begin(), m_pending_relations.end());
@@ -590,6 +495,13 @@ void DiffHandler2::write_new_ways() {
 }
 
 void DiffHandler2::after_relations() {
+    // The lookups of pending ways and relations are done even if the diff contains no ways or relations.
+    if (m_progress == TypeProgress::POINT) {
+        write_new_nodes();
+    }
+    if (m_progress != TypeProgress::RELATION) {
+        write_new_ways();
+    }
     m_relations_table.end_copy();
     if (m_node_relations_table && m_way_relations_table && m_relation_relations_table) {
         m_node_relations_table->end_copy();
@@ -600,39 +512,100 @@ void DiffHandler2::after_relations() {
         m_areas_table->end_copy();
     }
     std::cerr << "sorting list of relations ways ...";
-//    using namespace std::placeholders;
-//    std::function<void(osmium::object_id_type)> func = std::bind(&DiffHandler2::update_relation, this, _1);
-    clean_up_container_and_work_on(m_pending_relations, [this](const osmium::object_id_type id){this->update_relation(id);});
+    work_on_pending(m_pending_relations, pending_relations_batch_size,
+            [](PendingUpdates& updates, const std::vector<osmium::object_id_type>& ids) {
+                return updates.update_relations(ids);
+            });
+    m_relations_table.apply_geometry_updates();
+    m_member_cache.print_statistics(std::cerr);
 }
 
 void DiffHandler2::work_on_pending_ways() {
     std::cerr << "sorting list of pending ways ...";
-//    using namespace std::placeholders;
-//    std::function<void(osmium::object_id_type)> func = std::bind(&DiffHandler2::update_way, this, _1);
-    clean_up_container_and_work_on(m_pending_ways, [this](const osmium::object_id_type id){this->update_way(id);});
+    work_on_pending(m_pending_ways, pending_ways_batch_size,
+            [](PendingUpdates& updates, const std::vector<osmium::object_id_type>& ids) {
+                return updates.update_ways(ids);
+            });
 }
 
-// Can be converted in a template if we work on containers
 void DiffHandler2::clean_up_container_and_work_on(std::vector<osmium::object_id_type>& container,
-        std::function<void(const osmium::object_id_type)> func) {
+        const size_t batch_size, std::function<void(const std::vector<osmium::object_id_type>&)> func) {
     std::sort(container.begin(), container.end());
-    std::cerr << " working on it ...";    // find first element after 0
-    //TODO use std::unique
-    std::vector<osmium::object_id_type>::iterator it = std::find_if(container.begin(),
-            container.end(),
-            [](const osmium::object_id_type x){return x > 0;});
+    container.erase(std::unique(container.begin(), container.end()), container.end());
+    std::cerr << " working on it ...";
+    // Processed elements have been set to zero.
+    std::vector<osmium::object_id_type>::iterator it = std::upper_bound(container.begin(), container.end(), 0);
     // check if vector of pending ways is empty or contains only zeros
     if (it == container.end()) {
         std::cerr << " nothing to do\n";
         return;
     }
-    ++it;
-    osmium::object_id_type last = 0;
-    for (;it != container.end(); ++it) {
-        if (last != *it) {
-            func(*it);
-            last = *it;
+    std::vector<osmium::object_id_type> batch;
+    batch.reserve(batch_size);
+    for (; it != container.end(); ++it) {
+        batch.push_back(*it);
+        if (batch.size() == batch_size) {
+            func(batch);
+            batch.clear();
         }
     }
+    if (!batch.empty()) {
+        func(batch);
+    }
     std::cerr << " done\n";
 }
+
+size_t DiffHandler2::pending_update_threads() {
+    if (m_config.m_threads <= 1 || !m_location_index.concurrent_lookups()) {
+        return 1;
+    }
+    while (m_workers.size() < m_config.m_threads) {
+        m_workers.emplace_back(new PendingUpdatesWorker{m_config, *m_node_ways_table, *m_node_relations_table,
+                *m_way_relations_table, *m_relation_relations_table, m_config.m_areas ? m_areas_table : nullptr,
+                m_ways_linear_table, m_location_index, m_member_cache});
+    }
+    return m_workers.size();
+}
+
+void DiffHandler2::work_on_pending(std::vector<osmium::object_id_type>& container, const size_t batch_size,
+        std::function<PendingUpdates::Result(PendingUpdates&, const std::vector<osmium::object_id_type>&)> compute) {
+    const size_t threads = pending_update_threads();
+    if (threads == 1) {
+        clean_up_container_and_work_on(container, batch_size, [&](const std::vector<osmium::object_id_type>& ids) {
+            PendingUpdates::Result result = compute(m_pending_updates, ids);
+            apply_pending_updates(result);
+        });
+        return;
+    }
+    // Every running task takes the connections of an idle worker.
+    std::mutex idle_mutex;
+    std::vector<PendingUpdates*> idle_workers;
+    for (auto& worker : m_workers) {
+        idle_workers.push_back(&worker->updates());
+    }
+    auto consumer = [this](PendingUpdates::Result& result) {
+        apply_pending_updates(result);
+    };
+    OrderedWorkerPool<PendingUpdates::Result> pool{threads, threads * 2};
+    clean_up_container_and_work_on(container, batch_size, [&](const std::vector<osmium::object_id_type>& ids) {
+        pool.submit([&compute, &idle_mutex, &idle_workers, ids]() -> PendingUpdates::Result {
+            PendingUpdates* updates;
+            {
+                std::lock_guard<std::mutex> lock{idle_mutex};
+                updates = idle_workers.back();
+                idle_workers.pop_back();
+            }
+            try {
+                PendingUpdates::Result result = compute(*updates, ids);
+                std::lock_guard<std::mutex> lock{idle_mutex};
+                idle_workers.push_back(updates);
+                return result;
+            } catch (...) {
+                std::lock_guard<std::mutex> lock{idle_mutex};
+                idle_workers.push_back(updates);
+                throw;
+            }
+        }, consumer);
+    });
+    pool.drain(consumer);
+}
@@ -9,14 +9,17 @@
 #define DIFF_HANDLER2_HPP_
 
 #include <functional>
-#include <geos/geom/GeometryFactory.h>
+#include <memory>
+#include <geos/geom/Coordinate.h>
 #include <osmium/area/assembler.hpp>
 #include <osmium/area/multipolygon_manager.hpp>
 #include "postgres_handler.hpp"
-#include "geos_compatibility_definitions.hpp"
+#include "relation_geometry_builder.hpp"
 #include "expire_tiles.hpp"
 #include "definitions.hpp"
 #include "update_location_handler.hpp"
+#include "member_cache.hpp"
+#include "pending_updates.hpp"
 
 enum class TypeProgress : char {
     POINT = 1,
@@ -54,6 +57,18 @@ class DiffHandler2 : public PostgresHandler {
      */
     std::vector<osmium::object_id_type> m_pending_relations;
 
+    /**
+     * Nodes of the diff whose ways and relations have not been looked up yet. They are looked
+     * up in batches by write_new_nodes().
+     */
+    std::vector<osmium::object_id_type> m_changed_nodes;
+
+    /**
+     * Ways of the diff and ways with updated geometries whose relations have not been looked
+     * up yet. They are looked up in batches by write_new_ways().
+     */
+    std::vector<osmium::object_id_type> m_changed_ways;
+
     /**
      * Iterator pointing to element in list of pending ways which has been worked on.
      */
@@ -64,6 +79,15 @@ class DiffHandler2 : public PostgresHandler {
      */
     std::vector<osmium::object_id_type>::size_type m_pending_relations_idx;
 
+    /// node lists of ways and member lists of relations read from the database while this diff is applied
+    MemberCache m_member_cache;
+
+    /// recomputes pending ways and relations on the main thread
+    PendingUpdates m_pending_updates;
+
+    /// database connections of the worker threads recomputing pending ways and relations, opened on first use
+    std::vector<std::unique_ptr<PendingUpdatesWorker>> m_workers;
+
     osmium::area::MultipolygonManager<osmium::area::Assembler>* m_mp_manager;
 
     osmium::memory::Buffer m_relation_buffer;
@@ -73,11 +97,8 @@ class DiffHandler2 : public PostgresHandler {
     /// Buffer for assembled areas which required an update due to changes to their members
     osmium::memory::CallbackBuffer m_updated_areas_buffer;
 
-#ifdef GEOS_36
-    geos_factory_type m_geom_factory;
-#else
-    geos_factory_type m_geom_factory;
-#endif
+    /// geometries of the members of the relation which is being written, reused for all relations
+    RelationGeometryBuilder m_relation_geometries;
 
     /**
      * \brief Track progress of import.
@@ -96,6 +117,21 @@ class DiffHandler2 : public PostgresHandler {
      */
     osmium::Location get_point_from_tables(osmium::object_id_type id);
 
+    /**
+     * \brief Add the linestring of a member way to m_relation_geometries.
+     *
+     * The nodes of the way are read from the cache or the database, their locations from the location index.
+     * The way is skipped if the location of any of its nodes is missing.
+     *
+     * \param way_id OSM ID of the way
+     * \param coordinates vector to append the coordinates of the way to (used for tile expiry),
+     * may be nullptr
+     *
+     * \returns true if the linestring was added
+     */
+    bool add_member_way_geometry(const osmium::object_id_type way_id,
+            std::vector<geos::geom::Coordinate>* coordinates);
+
     /**
      * \brief Write all nodes which have to be written to the database.
      *
@@ -111,43 +147,63 @@ class DiffHandler2 : public PostgresHandler {
     void write_new_ways();
 
     /**
-     * Update geometry of a way.
+     * Queue the geometries recomputed for a batch of pending ways or relations for the update of
+     * their tables and assemble the areas of the relations again.
      *
-     * \param id OSM way ID
+     * \param result result of PendingUpdates::update_ways or PendingUpdates::update_relations
      */
-    void update_way(const osmium::object_id_type id);
+    void apply_pending_updates(PendingUpdates::Result& result);
 
     /**
-     * Update geometry of an area.
+     * Update geometry of an area. The update is queued and sent by flush().
      *
      * \param id OSM way ID
      */
     void update_area_geometry(const osmium::Area& area);
 
-    /**
-     * Update multigeometry of the points and lines referenced by a relation.
-     *
-     * \param id OSM relation ID
-     */
-    void update_relation(const osmium::object_id_type id);
-
     /**
      * Build an Osmium Area object for a relation whose members changed.
      *
      * \param id relation ID
      * \param members ID, type and rank of the members. The method will set the ID of a
      * way member in the vector to 0 if there are no nodes available for it.
+     * \param way_nodes member nodes of (at least) all member ways which are not in the diff
      */
     void update_multipolygon_geometry(const osmium::object_id_type id,
-            std::vector<postgres_drivers::MemberIdTypePos>& members);
+            std::vector<postgres_drivers::MemberIdTypePos>& members, const PendingUpdates::way_nodes_map_type& way_nodes);
 
     /**
-     * Sort a container of osmium::object_id_type, remove duplicates and then call a function for each non-zero element.
+     * Sort a container of osmium::object_id_type, remove duplicates and then call a function for batches
+     * of the positive elements.
      *
      * \param container container to work on
+     * \param batch_size maximum number of elements passed to the function at once
      * \param func function to call
      */
-    void clean_up_container_and_work_on(std::vector<osmium::object_id_type>& container, std::function<void(osmium::object_id_type)> func);
+    void clean_up_container_and_work_on(std::vector<osmium::object_id_type>& container, const size_t batch_size,
+            std::function<void(const std::vector<osmium::object_id_type>&)> func);
+
+    /**
+     * Number of threads recomputing pending ways and relations. Opens the connections of the
+     * workers if more than one thread is used.
+     *
+     * Workers are only used if `--threads` is given and the location index can be used by
+     * multiple threads.
+     */
+    size_t pending_update_threads();
+
+    /**
+     * Recompute the geometries of pending ways or relations in batches and apply the results.
+     *
+     * The batches are distributed to worker threads if pending_update_threads() returns more than
+     * one. The results are applied by this thread in the order of the IDs.
+     *
+     * \param container IDs of pending ways or relations
+     * \param batch_size maximum number of objects of a batch
+     * \param compute function computing a batch
+     */
+    void work_on_pending(std::vector<osmium::object_id_type>& container, const size_t batch_size,
+            std::function<PendingUpdates::Result(PendingUpdates&, const std::vector<osmium::object_id_type>&)> compute);
 
 public:
     DiffHandler2(CerepsoConfig& config, PostgresTable& nodes_table, PostgresTable* untagged_nodes_table, PostgresTable& ways_table,
@@ -202,7 +258,7 @@ public:
     void incomplete_relation(const osmium::Relation& relation);
 
     /**
-     * Flush area output buffers.
+     * Flush area output buffers and send queued updates of area geometries.
      *
      * Call this method at the end of processing.
      */
@@ -0,0 +1,183 @@
+/*
+ * escape_kernels.hpp
+ *
+ *  Created on:  2026-10-17
+ *      Author: Michael Reichert <michael.reichert@geofabrik.de>
+ */
+
+#ifndef SRC_ESCAPE_KERNELS_HPP_
+#define SRC_ESCAPE_KERNELS_HPP_
+
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/**
+ * \brief Search functions for the characters which have to be escaped.
+ *
+ * The escaping functions of PostgresTable copy runs of characters which do not need any
+ * escaping at once and handle only the special characters one by one. These functions find
+ * the next special character. They check 32 (AVX2) or 16 (SSE2) bytes at once if the compiler
+ * targets these instruction sets and fall back to a simple loop otherwise.
+ */
+namespace escape_kernels {
+
+    /**
+     * Special characters of the text format of COPY: backslash, backspace (8), tab, newline,
+     * vertical tab (11), form feed (12) and carriage return.
+     */
+    inline bool is_copy_special(const char c) noexcept {
+        return c == '\\' || (static_cast<unsigned char>(c) - 8u) < 6u;
+    }
+
+    /**
+     * Special characters inside quoted hstore keys and values and array elements: backslash,
+     * quotation mark, tab, newline and carriage return.
+     */
+    inline bool is_quoted_special(const char c) noexcept {
+        return c == '\\' || c == '"' || c == '\t' || c == '\n' || c == '\r';
+    }
+
+#if defined(__AVX2__)
+    namespace detail {
+        constexpr size_t block_size = 32;
+
+        using block_type = __m256i;
+
+        inline block_type load(const char* data) noexcept {
+            return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data));
+        }
+
+        inline block_type set1(const char c) noexcept {
+            return _mm256_set1_epi8(c);
+        }
+
+        inline block_type cmpeq(const block_type a, const block_type b) noexcept {
+            return _mm256_cmpeq_epi8(a, b);
+        }
+
+        inline block_type or_(const block_type a, const block_type b) noexcept {
+            return _mm256_or_si256(a, b);
+        }
+
+        /// mask of bytes of a which are in range [low, low + count)
+        inline block_type in_range(const block_type a, const char low, const char count) noexcept {
+            const block_type shifted = _mm256_sub_epi8(a, set1(low));
+            return cmpeq(_mm256_min_epu8(shifted, set1(count - 1)), shifted);
+        }
+
+        inline uint32_t movemask(const block_type a) noexcept {
+            return static_cast<uint32_t>(_mm256_movemask_epi8(a));
+        }
+    }
+#elif defined(__SSE2__)
+    namespace detail {
+        constexpr size_t block_size = 16;
+
+        using block_type = __m128i;
+
+        inline block_type load(const char* data) noexcept {
+            return _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+        }
+
+        inline block_type set1(const char c) noexcept {
+            return _mm_set1_epi8(c);
+        }
+
+        inline block_type cmpeq(const block_type a, const block_type b) noexcept {
+            return _mm_cmpeq_epi8(a, b);
+        }
+
+        inline block_type or_(const block_type a, const block_type b) noexcept {
+            return _mm_or_si128(a, b);
+        }
+
+        /// mask of bytes of a which are in range [low, low + count)
+        inline block_type in_range(const block_type a, const char low, const char count) noexcept {
+            const block_type shifted = _mm_sub_epi8(a, set1(low));
+            return cmpeq(_mm_min_epu8(shifted, set1(count - 1)), shifted);
+        }
+
+        inline uint32_t movemask(const block_type a) noexcept {
+            return static_cast<uint32_t>(_mm_movemask_epi8(a));
+        }
+    }
+#endif
+
+#if defined(__AVX2__) || defined(__SSE2__)
+    namespace detail {
+        inline size_t first_set_bit(const uint32_t mask) noexcept {
+            return static_cast<size_t>(__builtin_ctz(mask));
+        }
+    }
+#endif
+
+    /**
+     * Find the next character which has to be escaped for the text format of COPY.
+     *
+     * \param data string to search in
+     * \param pos position to start searching at
+     * \param length length of the string
+     * \returns position of the special character or length if there is none
+     */
+    inline size_t find_copy_special(const char* data, size_t pos, const size_t length) noexcept {
+#if defined(__AVX2__) || defined(__SSE2__)
+        const detail::block_type backslash = detail::set1('\\');
+        for (; pos + detail::block_size <= length; pos += detail::block_size) {
+            const detail::block_type block = detail::load(data + pos);
+            const uint32_t mask = detail::movemask(detail::or_(detail::cmpeq(block, backslash),
+                    detail::in_range(block, 8, 6)));
+            if (mask) {
+                return pos + detail::first_set_bit(mask);
+            }
+        }
+#endif
+        for (; pos < length; ++pos) {
+            if (is_copy_special(data[pos])) {
+                return pos;
+            }
+        }
+        return length;
+    }
+
+    /**
+     * Find the next character which has to be escaped in a quoted hstore key or value or array element.
+     *
+     * \param data string to search in
+     * \param pos position to start searching at
+     * \param length length of the string
+     * \returns position of the special character or length if there is none
+     */
+    inline size_t find_quoted_special(const char* data, size_t pos, const size_t length) noexcept {
+#if defined(__AVX2__) || defined(__SSE2__)
+        const detail::block_type backslash = detail::set1('\\');
+        const detail::block_type quote = detail::set1('"');
+        const detail::block_type carriage_return = detail::set1('\r');
+        for (; pos + detail::block_size <= length; pos += detail::block_size) {
+            const detail::block_type block = detail::load(data + pos);
+            // tab and newline are adjacent (9 and 10)
+            const detail::block_type matches = detail::or_(
+                    detail::or_(detail::cmpeq(block, backslash), detail::cmpeq(block, quote)),
+                    detail::or_(detail::cmpeq(block, carriage_return), detail::in_range(block, '\t', 2)));
+            const uint32_t mask = detail::movemask(matches);
+            if (mask) {
+                return pos + detail::first_set_bit(mask);
+            }
+        }
+#endif
+        for (; pos < length; ++pos) {
+            if (is_quoted_special(data[pos])) {
+                return pos;
+            }
+        }
+        return length;
+    }
+
+} // namespace escape_kernels
+
+#endif /* SRC_ESCAPE_KERNELS_HPP_ */
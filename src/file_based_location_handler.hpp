@@ -42,6 +42,11 @@ public:
         return m_location_handler.get_node_location(id);
     }
 
+    /// Lookups only read the location storage.
+    bool concurrent_lookups() const noexcept {
+        return true;
+    }
+
     void way(osmium::Way& way) {
         m_location_handler.way(way);
     }
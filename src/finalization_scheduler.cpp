@@ -0,0 +1,79 @@
+/*
+ * finalization_scheduler.cpp
+ *
+ *  Created on:  2026-10-17
+ *      Author: Michael Reichert <michael.reichert@geofabrik.de>
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include "finalization_scheduler.hpp"
+
+FinalizationScheduler::FinalizationScheduler(const size_t max_jobs, ImportState* state) :
+    m_tables(),
+    m_max_jobs(max_jobs > 0 ? max_jobs : 1),
+    m_state(state) {
+}
+
+void FinalizationScheduler::add(PostgresTable& table) {
+    m_tables.push_back(&table);
+}
+
+void FinalizationScheduler::for_each_table(const std::function<void(PostgresTable&)>& task) {
+    std::atomic<size_t> next_table{0};
+    std::mutex error_mutex;
+    std::string error;
+    const auto work = [&]() {
+        for (size_t i = next_table++; i < m_tables.size(); i = next_table++) {
+            try {
+                task(*m_tables[i]);
+            } catch (const std::exception& e) {
+                std::lock_guard<std::mutex> lock{error_mutex};
+                if (error.empty()) {
+                    error = e.what();
+                }
+            }
+        }
+    };
+    const size_t thread_count = std::min(m_max_jobs, m_tables.size());
+    if (thread_count <= 1) {
+        work();
+    } else {
+        std::vector<std::thread> threads;
+        threads.reserve(thread_count);
+        for (size_t i = 0; i < thread_count; ++i) {
+            threads.emplace_back(work);
+        }
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+    }
+    if (!error.empty()) {
+        throw std::runtime_error(error);
+    }
+}
+
+void FinalizationScheduler::run() {
+    // Ending COPY sends the sorted rows with --spatial-sort, therefore it runs concurrently, too.
+    for_each_table([](PostgresTable& table) {
+        table.end_load();
+    });
+    // All tables are recorded as loaded before the first one is ordered or indexed.
+    for (PostgresTable* table : m_tables) {
+        table->record_loaded(m_state);
+    }
+    try {
+        for_each_table([this](PostgresTable& table) {
+            table.finalize(m_state);
+        });
+    } catch (...) {
+        m_tables.clear();
+        throw;
+    }
+    m_tables.clear();
+}
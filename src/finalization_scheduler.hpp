@@ -0,0 +1,70 @@
+/*
+ * finalization_scheduler.hpp
+ *
+ *  Created on:  2026-10-17
+ *      Author: Michael Reichert <michael.reichert@geofabrik.de>
+ */
+
+#ifndef SRC_FINALIZATION_SCHEDULER_HPP_
+#define SRC_FINALIZATION_SCHEDULER_HPP_
+
+#include <functional>
+#include <vector>
+
+#include "postgres_table.hpp"
+
+/**
+ * \brief Finalize multiple tables concurrently after the import.
+ *
+ * Ordering a table by geohash and creating its indexes takes a long time. Every table has its
+ * own database connection, therefore these steps can run for multiple tables at the same time.
+ * The steps of one table are executed one after another by PostgresTable::finalize().
+ *
+ * The tables are started in the order they were added. Add the largest tables first to
+ * avoid that a large table is started last.
+ */
+class FinalizationScheduler {
+
+    std::vector<PostgresTable*> m_tables;
+
+    /// maximum number of tables finalized concurrently
+    size_t m_max_jobs;
+
+    /// state of the import receiving the completed steps, may be nullptr
+    ImportState* m_state;
+
+    /**
+     * Execute a task for every table with up to #m_max_jobs threads and wait until all tables are
+     * done. If the task fails for a table, it is executed for the remaining tables nevertheless.
+     *
+     * \throws std::runtime_error with the error message of the first table the task failed for
+     */
+    void for_each_table(const std::function<void(PostgresTable&)>& task);
+
+public:
+    /**
+     * \param max_jobs maximum number of tables finalized concurrently, 1 finalizes the tables
+     * one after another on the calling thread
+     * \param state state of the import, see PostgresTable::finalize()
+     */
+    explicit FinalizationScheduler(const size_t max_jobs, ImportState* state = nullptr);
+
+    /**
+     * Add a table. Tables which have not been initialized are skipped by PostgresTable::finalize().
+     */
+    void add(PostgresTable& table);
+
+    /**
+     * Finalize all tables and wait until all of them are done.
+     *
+     * PostgresTable::end_load() is called for all tables concurrently first. After all of them
+     * have completed, all tables are recorded as loaded before the long running ordering and
+     * indexing starts. If finalizing a table fails, the remaining tables are finalized nevertheless.
+     *
+     * \throws std::runtime_error if ending the COPY of a table fails or with the error message of
+     * the first table whose finalization failed
+     */
+    void run();
+};
+
+#endif /* SRC_FINALIZATION_SCHEDULER_HPP_ */
@@ -8,10 +8,8 @@
 #ifndef SRC_HANDLER_COLLECTION_HPP_
 #define SRC_HANDLER_COLLECTION_HPP_
 
-#include <functional>
-#include <vector>
-
 #include <osmium/handler.hpp>
+#include <osmium/osm/area.hpp>
 #include <osmium/osm/node.hpp>
 #include <osmium/osm/relation.hpp>
 #include <osmium/osm/way.hpp>
@@ -27,37 +25,143 @@ enum class ViewType : char {
     tagging= 4
 };
 
+namespace detail {
+
+    /*
+     * The callbacks are called if the handler has a matching method. The overload taking an
+     * int is preferred by the caller, the one taking a long is the fallback if the expression
+     * in the return type of the first one is invalid.
+     */
+
+    template <typename THandler, typename TNode>
+    auto call_node(THandler* handler, TNode& node, int) -> decltype(handler->node(node), void()) {
+        if (handler) {
+            handler->node(node);
+        }
+    }
+
+    template <typename THandler, typename TNode>
+    void call_node(THandler*, TNode&, long) {
+    }
+
+    template <typename THandler, typename TWay>
+    auto call_way(THandler* handler, TWay& way, int) -> decltype(handler->way(way), void()) {
+        if (handler) {
+            handler->way(way);
+        }
+    }
+
+    template <typename THandler, typename TWay>
+    void call_way(THandler*, TWay&, long) {
+    }
+
+    template <typename THandler, typename TRelation>
+    auto call_relation(THandler* handler, TRelation& relation, int) -> decltype(handler->relation(relation), void()) {
+        if (handler) {
+            handler->relation(relation);
+        }
+    }
+
+    template <typename THandler, typename TRelation>
+    void call_relation(THandler*, TRelation&, long) {
+    }
+
+    template <typename THandler, typename TArea>
+    auto call_area(THandler* handler, TArea& area, int) -> decltype(handler->area(area), void()) {
+        if (handler) {
+            handler->area(area);
+        }
+    }
+
+    template <typename THandler, typename TArea>
+    void call_area(THandler*, TArea&, long) {
+    }
+
+} // namespace detail
+
 /**
  * The handler collection manages all handlers and calls their node, way, relation and area callbacks one
  * after another. This allows us to only instanciate those handlers which are necessary.
+ *
+ * The handlers are stored as pointers, their types are template parameters. Therefore the calls
+ * of the callbacks can be inlined. Handlers which do not have a callback for a type are skipped
+ * at compile time. A handler which is a nullptr is skipped at runtime, this allows to disable
+ * handlers depending on the configuration.
+ *
+ * Use make_handler_collection() to create a collection.
  */
-class HandlerCollection : public osmium::handler::Handler {
-    std::vector< std::function< void(const osmium::Node&)> > m_node_callbacks;
-    std::vector< std::function< void(const osmium::Way&)> > m_way_callbacks;
-    std::vector< std::function< void(const osmium::Relation&)> > m_relation_callbacks;
+template <typename... THandlers>
+class HandlerCollection;
 
+template <>
+class HandlerCollection<> : public osmium::handler::Handler {
 public:
-    template <class THandler>
-    void add(THandler& handler) {
-        // register node callback
-        using namespace std::placeholders;
-        auto node_fn = std::bind(&THandler::node, &handler, _1);
-        m_node_callbacks.push_back(std::move(node_fn));
-        // register way callback
-        auto way_fn = std::bind(&THandler::way, &handler, _1);
-        m_way_callbacks.push_back(std::move(way_fn));
-        // register relation callback
-        auto rel_fn = std::bind(&THandler::relation, &handler, _1);
-        m_relation_callbacks.push_back(std::move(rel_fn));
+    template <typename TNode>
+    void node(TNode&) {
     }
 
-    void node(const osmium::Node& node);
+    template <typename TWay>
+    void way(TWay&) {
+    }
 
-    void way(const osmium::Way& way);
+    template <typename TRelation>
+    void relation(TRelation&) {
+    }
 
-    void relation(const osmium::Relation& relation);
+    template <typename TArea>
+    void area(TArea&) {
+    }
 };
 
+template <typename THandler, typename... TRest>
+class HandlerCollection<THandler, TRest...> : public osmium::handler::Handler {
+    THandler* m_handler;
+
+    HandlerCollection<TRest...> m_rest;
+
+public:
+    explicit HandlerCollection(THandler* handler, TRest*... rest) :
+        m_handler(handler),
+        m_rest(rest...) {
+    }
+
+    /**
+     * The callbacks are templates to forward non-const objects to handlers which modify them
+     * (e.g. location handlers).
+     */
+    template <typename TNode>
+    void node(TNode& node) {
+        detail::call_node(m_handler, node, 0);
+        m_rest.node(node);
+    }
+
+    template <typename TWay>
+    void way(TWay& way) {
+        detail::call_way(m_handler, way, 0);
+        m_rest.way(way);
+    }
+
+    template <typename TRelation>
+    void relation(TRelation& relation) {
+        detail::call_relation(m_handler, relation, 0);
+        m_rest.relation(relation);
+    }
+
+    template <typename TArea>
+    void area(TArea& area) {
+        detail::call_area(m_handler, area, 0);
+        m_rest.area(area);
+    }
+};
 
+/**
+ * Create a handler collection.
+ *
+ * \param handlers pointers to the handlers, nullptr to disable a handler
+ */
+template <typename... THandlers>
+HandlerCollection<THandlers...> make_handler_collection(THandlers*... handlers) {
+    return HandlerCollection<THandlers...>{handlers...};
+}
 
 #endif /* SRC_HANDLER_COLLECTION_HPP_ */
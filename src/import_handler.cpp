@@ -14,7 +14,30 @@ void ImportHandler::node(const osmium::Node& node) {
     handle_node(node);
 }
 
+std::string& ImportBatch::buffer(PostgresTable& table, const osmium::object_id_type shard_key) {
+    for (TableRows& entry : m_tables) {
+        if (entry.table == &table) {
+            return entry.rows;
+        }
+    }
+    m_tables.push_back(TableRows{&table, shard_key, std::string{}});
+    return m_tables.back().rows;
+}
+
+void ImportBatch::send() {
+    for (TableRows& entry : m_tables) {
+        if (!entry.rows.empty()) {
+            entry.table->send_line(entry.rows, entry.shard_key);
+        }
+    }
+}
+
 void ImportHandler::way(const osmium::Way& way) {
+    DirectRowSink sink;
+    build_way_rows(way, sink);
+}
+
+void ImportHandler::build_way_rows(const osmium::Way& way, RowSink& sink) {
     if (way.nodes().size() < 2) {
         // degenerated way (none or only one node)
         //TODO add logging
@@ -32,11 +55,11 @@ void ImportHandler::way(const osmium::Way& way) {
         return;
     }
     const osmium::TagList* rel_tags_to_apply = get_relation_tags_to_apply(way.id(), osmium::item_type::way);
-    std::string query = prepare_query(way, m_ways_linear_table, rel_tags_to_apply);
-    m_ways_linear_table.send_line(query);
+    prepare_query(way, m_ways_linear_table, rel_tags_to_apply, sink.buffer(m_ways_linear_table, way.id()));
+    sink.release(m_ways_linear_table);
     if (m_config.m_driver_config.updateable) {
-        query = prepare_node_way_query(way);
-        m_node_ways_table->send_line(query);
+        prepare_node_way_query(way, sink.buffer(*m_node_ways_table, way.id()), m_node_ways_table->binary_copy());
+        sink.release(*m_node_ways_table);
     }
 }
 
@@ -45,19 +68,44 @@ void ImportHandler::area(const osmium::Area& area) {
 }
 
 void ImportHandler::relation(const osmium::Relation& relation) {
+    DirectRowSink sink;
+    build_relation_rows(relation, sink);
+}
+
+void ImportHandler::build_relation_rows(const osmium::Relation& relation, RowSink& sink) {
     if (!m_config.m_driver_config.updateable) {
         return;
     }
-    std::string query = prepare_node_relation_query(relation);
-    if (query.c_str()[0] != '\0') {
-        m_node_relations_table->send_line(query);
-    }
-    query = prepare_way_relation_query(relation);
-    if (query.c_str()[0] != '\0') {
-        m_way_relations_table->send_line(query);
-    }
-    query = prepare_relation_relation_query(relation);
-    if (query.c_str()[0] != '\0') {
-        m_relation_relations_table->send_line(query);
+    prepare_node_relation_query(relation, sink.buffer(*m_node_relations_table, 0),
+            m_node_relations_table->binary_copy());
+    sink.release(*m_node_relations_table);
+    prepare_way_relation_query(relation, sink.buffer(*m_way_relations_table, 0),
+            m_way_relations_table->binary_copy());
+    sink.release(*m_way_relations_table);
+    prepare_relation_relation_query(relation, sink.buffer(*m_relation_relations_table, 0),
+            m_relation_relations_table->binary_copy());
+    sink.release(*m_relation_relations_table);
+}
+
+ImportBatch ImportHandler::build_batch(const osmium::memory::Buffer& buffer) {
+    ImportBatch batch;
+    for (const osmium::memory::Item& item : buffer) {
+        switch (item.type()) {
+        case osmium::item_type::node:
+            handle_node(static_cast<const osmium::Node&>(item), batch);
+            break;
+        case osmium::item_type::way:
+            build_way_rows(static_cast<const osmium::Way&>(item), batch);
+            break;
+        case osmium::item_type::relation:
+            build_relation_rows(static_cast<const osmium::Relation&>(item), batch);
+            break;
+        case osmium::item_type::area:
+            handle_area(static_cast<const osmium::Area&>(item), batch);
+            break;
+        default:
+            break;
+        }
     }
+    return batch;
 }
@@ -8,8 +8,42 @@
 #ifndef IMPORTHANDLER_HPP_
 #define IMPORTHANDLER_HPP_
 
+#include <osmium/memory/buffer.hpp>
 #include "postgres_handler.hpp"
 
+/**
+ * \brief Lines for `COPY` built from one buffer of OSM objects.
+ *
+ * Batches are built by worker threads and sent to the tables by the main thread. The lines
+ * of each table are collected in a single string.
+ */
+class ImportBatch : public RowSink {
+    struct TableRows {
+        PostgresTable* table;
+        /// OSM ID of the first object of the batch written to this table
+        osmium::object_id_type shard_key;
+        std::string rows;
+    };
+
+    std::vector<TableRows> m_tables;
+
+public:
+    std::string& buffer(PostgresTable& table, const osmium::object_id_type shard_key);
+
+    void release(PostgresTable&) {
+    }
+
+    /**
+     * Send the lines to the tables. The tables have to be in COPY mode.
+     *
+     * If a table uses multiple COPY shards, all lines of this batch go to the same shard. It is
+     * chosen by the ID of the first object.
+     *
+     * \throws std::runtime_error
+     */
+    void send();
+};
+
 /**
  * \brief Handler for nodes and ways to be imported into the database.
  *
@@ -68,6 +102,24 @@ public:
      * \osmiumcallback
      */
     void relation(const osmium::Relation& relation);
+
+    /**
+     * \brief Build the lines of a way and append them to a sink.
+     *
+     * This method and its counterparts for nodes and relations may be called by multiple
+     * threads concurrently as long as each thread uses its own sink.
+     */
+    void build_way_rows(const osmium::Way& way, RowSink& sink);
+
+    void build_relation_rows(const osmium::Relation& relation, RowSink& sink);
+
+    /**
+     * \brief Build the lines of all nodes, ways, relations and areas of a buffer.
+     *
+     * Node locations have to be set on the ways already.
+     * It is safe to call this method from multiple threads concurrently.
+     */
+    ImportBatch build_batch(const osmium::memory::Buffer& buffer);
 };
 
 
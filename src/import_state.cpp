@@ -0,0 +1,212 @@
+/*
+ * import_state.cpp
+ *
+ *  Created on:  2026-10-17
+ *      Author: Michael Reichert <michael.reichert@geofabrik.de>
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <stdexcept>
+
+#include <boost/format.hpp>
+
+#include "import_state.hpp"
+
+namespace {
+
+    /// name of the table in the target database
+    constexpr const char* table_name = "cerepso_import_state";
+
+    /// first line of the state file, followed by the input file
+    constexpr const char* file_header = "cerepso import state";
+
+    /// prefix of the lines of completed phases
+    constexpr const char* phase_prefix = "completed ";
+
+} // anonymous namespace
+
+ImportState::ImportState(const std::string& filename, const std::string& database_name) :
+    m_filename(filename),
+    m_connection(nullptr),
+    m_completed() {
+    if (database_name.empty()) {
+        return;
+    }
+    const std::string connection_params = "dbname=" + database_name;
+    m_connection = PQconnectdb(connection_params.c_str());
+    if (PQstatus(m_connection) != CONNECTION_OK) {
+        const std::string message = PQerrorMessage(m_connection);
+        PQfinish(m_connection);
+        m_connection = nullptr;
+        throw std::runtime_error((boost::format("Cannot establish connection to database: %1%\n") % message).str());
+    }
+}
+
+ImportState::~ImportState() {
+    if (m_connection) {
+        PQfinish(m_connection);
+    }
+}
+
+void ImportState::execute(const char* query) {
+    PGresult* result = PQexec(m_connection, query);
+    if (PQresultStatus(result) != PGRES_COMMAND_OK) {
+        const std::string message = PQerrorMessage(m_connection);
+        PQclear(result);
+        throw std::runtime_error((boost::format("%1% failed: %2%\n") % query % message).str());
+    }
+    PQclear(result);
+}
+
+std::set<std::string> ImportState::read_database() {
+    std::set<std::string> phases;
+    // Check if the table exists first because the query fails otherwise.
+    PGresult* result = PQexec(m_connection, (boost::format("SELECT to_regclass('%1%') IS NOT NULL") % table_name).str().c_str());
+    if (PQresultStatus(result) != PGRES_TUPLES_OK) {
+        const std::string message = PQerrorMessage(m_connection);
+        PQclear(result);
+        throw std::runtime_error((boost::format("Reading %1% failed: %2%\n") % table_name % message).str());
+    }
+    const bool exists = !strcmp(PQgetvalue(result, 0, 0), "t");
+    PQclear(result);
+    if (!exists) {
+        return phases;
+    }
+    result = PQexec(m_connection, (boost::format("SELECT phase FROM %1%") % table_name).str().c_str());
+    if (PQresultStatus(result) != PGRES_TUPLES_OK) {
+        const std::string message = PQerrorMessage(m_connection);
+        PQclear(result);
+        throw std::runtime_error((boost::format("Reading %1% failed: %2%\n") % table_name % message).str());
+    }
+    for (int i = 0; i < PQntuples(result); ++i) {
+        phases.insert(PQgetvalue(result, i, 0));
+    }
+    PQclear(result);
+    return phases;
+}
+
+bool ImportState::table_contains_rows(const std::string& table) {
+    // The table name is checked with to_regclass first because the query fails if it does not exist.
+    const char* params[1] = {table.c_str()};
+    PGresult* result = PQexecParams(m_connection, "SELECT to_regclass($1) IS NOT NULL", 1, nullptr, params,
+            nullptr, nullptr, 0);
+    if (PQresultStatus(result) != PGRES_TUPLES_OK) {
+        const std::string message = PQerrorMessage(m_connection);
+        PQclear(result);
+        throw std::runtime_error((boost::format("Checking table %1% failed: %2%\n") % table % message).str());
+    }
+    const bool exists = !strcmp(PQgetvalue(result, 0, 0), "t");
+    PQclear(result);
+    if (!exists) {
+        return false;
+    }
+    result = PQexec(m_connection, (boost::format("SELECT EXISTS (SELECT 1 FROM %1%)") % table).str().c_str());
+    if (PQresultStatus(result) != PGRES_TUPLES_OK) {
+        const std::string message = PQerrorMessage(m_connection);
+        PQclear(result);
+        throw std::runtime_error((boost::format("Checking table %1% failed: %2%\n") % table % message).str());
+    }
+    const bool contains_rows = !strcmp(PQgetvalue(result, 0, 0), "t");
+    PQclear(result);
+    return contains_rows;
+}
+
+std::set<std::string> ImportState::read_file(const std::string& input_file) {
+    std::set<std::string> phases;
+    std::ifstream file{m_filename};
+    if (!file) {
+        throw std::runtime_error((boost::format("Cannot open state file %1%: %2%\n") % m_filename % strerror(errno)).str());
+    }
+    std::string line;
+    if (!std::getline(file, line) || line != file_header) {
+        throw std::runtime_error((boost::format("%1% is not a state file of Cerepso.\n") % m_filename).str());
+    }
+    if (!std::getline(file, line) || line != input_file) {
+        throw std::runtime_error((boost::format("State file %1% belongs to an import of %2%, not %3%.\n") % m_filename
+                % line % input_file).str());
+    }
+    const size_t prefix_length = strlen(phase_prefix);
+    while (std::getline(file, line)) {
+        // An incomplete last line (e.g. after a crash) does not match any phase.
+        if (line.compare(0, prefix_length, phase_prefix) == 0) {
+            phases.insert(line.substr(prefix_length));
+        }
+    }
+    return phases;
+}
+
+void ImportState::start(const std::string& input_file) {
+    std::ofstream file{m_filename, std::ios::trunc};
+    file << file_header << '\n' << input_file << '\n';
+    file.close();
+    if (!file) {
+        throw std::runtime_error((boost::format("Cannot write state file %1%: %2%\n") % m_filename % strerror(errno)).str());
+    }
+    if (m_connection) {
+        execute((boost::format("DROP TABLE IF EXISTS %1%") % table_name).str().c_str());
+        execute((boost::format("CREATE TABLE %1% (phase text PRIMARY KEY, completed timestamp with time zone DEFAULT now())")
+                % table_name).str().c_str());
+    }
+    m_completed.clear();
+    m_resumed = false;
+}
+
+void ImportState::resume(const std::string& input_file) {
+    m_completed = read_file(input_file);
+    if (m_connection) {
+        const std::set<std::string> in_database = read_database();
+        std::set<std::string> in_both;
+        std::set_intersection(m_completed.begin(), m_completed.end(), in_database.begin(), in_database.end(),
+                std::inserter(in_both, in_both.begin()));
+        m_completed = std::move(in_both);
+        const std::string loaded_prefix = "loaded:";
+        for (auto it = m_completed.begin(); it != m_completed.end();) {
+            const bool loaded = it->compare(0, loaded_prefix.size(), loaded_prefix) == 0;
+            const std::string table = loaded ? it->substr(loaded_prefix.size()) : "";
+            if (loaded && m_completed.count("contains rows:" + table) && !table_contains_rows(table)) {
+                std::cerr << "Table " << table << " has been emptied, probably by the crash recovery of the database.\n";
+                it = m_completed.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+    m_resumed = true;
+}
+
+bool ImportState::completed(const std::string& phase) {
+    std::lock_guard<std::mutex> lock{m_mutex};
+    return m_completed.count(phase) > 0;
+}
+
+void ImportState::complete(const std::string& phase) {
+    std::lock_guard<std::mutex> lock{m_mutex};
+    if (m_completed.count(phase)) {
+        return;
+    }
+    if (m_connection) {
+        const std::string query = (boost::format("INSERT INTO %1% (phase) VALUES ($1) ON CONFLICT DO NOTHING")
+                % table_name).str();
+        const char* params[1] = {phase.c_str()};
+        PGresult* result = PQexecParams(m_connection, query.c_str(), 1, nullptr, params, nullptr, nullptr, 0);
+        if (PQresultStatus(result) != PGRES_COMMAND_OK) {
+            const std::string message = PQerrorMessage(m_connection);
+            PQclear(result);
+            throw std::runtime_error((boost::format("%1% failed: %2%\n") % query % message).str());
+        }
+        PQclear(result);
+    }
+    // Lines are appended and flushed one by one to keep them if the import crashes.
+    std::ofstream file{m_filename, std::ios::app};
+    file << phase_prefix << phase << '\n';
+    file.close();
+    if (!file) {
+        throw std::runtime_error((boost::format("Cannot write state file %1%: %2%\n") % m_filename % strerror(errno)).str());
+    }
+    m_completed.insert(phase);
+}
@@ -0,0 +1,127 @@
+/*
+ * import_state.hpp
+ *
+ *  Created on:  2026-10-17
+ *      Author: Michael Reichert <michael.reichert@geofabrik.de>
+ */
+
+#ifndef SRC_IMPORT_STATE_HPP_
+#define SRC_IMPORT_STATE_HPP_
+
+#include <mutex>
+#include <set>
+#include <string>
+
+#include <libpq-fe.h>
+
+/**
+ * \brief Completed phases of an import, used to resume a failed import.
+ *
+ * Phases are identified by names like `loaded:planet_osm_point` (COPY into the table finished),
+ * `ordered:TABLE`, `geometry index:TABLE`, `id index:TABLE` or `location index` (flat nodes file
+ * written). Every completed phase is appended to a local state file and inserted into the table
+ * `cerepso_import_state` of the target database.
+ *
+ * A phase counts as completed on resume only if it is recorded in both places. This way a
+ * database which has been recreated or a state file of another import do not cause phases to be
+ * skipped wrongly.
+ *
+ * complete() may be called by multiple threads concurrently.
+ */
+class ImportState {
+
+    std::string m_filename;
+
+    /// connection to the database, nullptr if the state is kept in the file only
+    PGconn* m_connection;
+
+    std::set<std::string> m_completed;
+
+    /// This is a resumed import.
+    bool m_resumed = false;
+
+    std::mutex m_mutex;
+
+    /**
+     * \throws std::runtime_error
+     */
+    void execute(const char* query);
+
+    /**
+     * Phases recorded in the database table, empty if the table does not exist.
+     *
+     * \throws std::runtime_error
+     */
+    std::set<std::string> read_database();
+
+    /**
+     * Check if a table exists and contains at least one row.
+     *
+     * \throws std::runtime_error
+     */
+    bool table_contains_rows(const std::string& table);
+
+    /**
+     * Phases recorded in the state file if it belongs to an import of the input file.
+     *
+     * \throws std::runtime_error if the file cannot be read or belongs to another input file
+     */
+    std::set<std::string> read_file(const std::string& input_file);
+
+public:
+    ImportState() = delete;
+
+    ImportState(const ImportState&) = delete;
+
+    ImportState& operator=(const ImportState&) = delete;
+
+    /**
+     * \param filename path of the state file
+     * \param database_name name of the database to keep the state in, empty to keep the state
+     * in the file only
+     *
+     * \throws std::runtime_error if the connection to the database fails
+     */
+    ImportState(const std::string& filename, const std::string& database_name);
+
+    ~ImportState();
+
+    /**
+     * Start a new import. All recorded phases are removed.
+     *
+     * \param input_file input file of the import
+     *
+     * \throws std::runtime_error
+     */
+    void start(const std::string& input_file);
+
+    /**
+     * Continue an import. The phases recorded by the earlier run are read.
+     *
+     * The tables are unlogged, the crash recovery of the database empties them. If a table
+     * contained rows when it was recorded as loaded but is empty now, it does not count as loaded.
+     *
+     * \param input_file input file of the import, has to be the same as the one of the earlier run
+     *
+     * \throws std::runtime_error if the state cannot be read or belongs to another input file
+     */
+    void resume(const std::string& input_file);
+
+    /**
+     * Has resume() been called?
+     */
+    bool resumed() const noexcept {
+        return m_resumed;
+    }
+
+    bool completed(const std::string& phase);
+
+    /**
+     * Record a phase as completed. Nothing is done if it has been recorded before.
+     *
+     * \throws std::runtime_error
+     */
+    void complete(const std::string& phase);
+};
+
+#endif /* SRC_IMPORT_STATE_HPP_ */
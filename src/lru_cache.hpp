@@ -0,0 +1,119 @@
+/*
+ * lru_cache.hpp
+ *
+ *  Created on:  2026-10-17
+ *      Author: Michael Reichert <michael.reichert@geofabrik.de>
+ */
+
+#ifndef SRC_LRU_CACHE_HPP_
+#define SRC_LRU_CACHE_HPP_
+
+#include <list>
+#include <unordered_map>
+#include <utility>
+
+/**
+ * \brief Map with a maximum number of entries which drops the least recently used entry if it is full.
+ *
+ * The cache counts hits and misses of get(). It is not thread-safe.
+ *
+ * \tparam TKey key type, has to be hashable
+ * \tparam TValue value type
+ */
+template <typename TKey, typename TValue>
+class LRUCache {
+
+    using entry_type = std::pair<TKey, TValue>;
+
+    /// entries, most recently used first
+    std::list<entry_type> m_entries;
+
+    std::unordered_map<TKey, typename std::list<entry_type>::iterator> m_index;
+
+    size_t m_capacity;
+
+    size_t m_hits = 0;
+
+    size_t m_misses = 0;
+
+public:
+    /**
+     * \param capacity maximum number of entries, a cache with capacity 0 never stores anything
+     */
+    explicit LRUCache(const size_t capacity) :
+        m_entries(),
+        m_index(),
+        m_capacity(capacity) {
+    }
+
+    /**
+     * Look up an entry and mark it as most recently used.
+     *
+     * \returns pointer to the value or nullptr if the key is not cached. The pointer is valid
+     * until the entry is evicted or erased.
+     */
+    const TValue* get(const TKey& key) {
+        auto found = m_index.find(key);
+        if (found == m_index.end()) {
+            ++m_misses;
+            return nullptr;
+        }
+        ++m_hits;
+        m_entries.splice(m_entries.begin(), m_entries, found->second);
+        return &(found->second->second);
+    }
+
+    /**
+     * Add or replace an entry. The least recently used entry is dropped if the cache is full.
+     */
+    void put(const TKey& key, TValue value) {
+        if (m_capacity == 0) {
+            return;
+        }
+        auto found = m_index.find(key);
+        if (found != m_index.end()) {
+            found->second->second = std::move(value);
+            m_entries.splice(m_entries.begin(), m_entries, found->second);
+            return;
+        }
+        if (m_entries.size() == m_capacity) {
+            m_index.erase(m_entries.back().first);
+            m_entries.pop_back();
+        }
+        m_entries.emplace_front(key, std::move(value));
+        m_index.emplace(key, m_entries.begin());
+    }
+
+    /**
+     * Remove an entry if it is cached.
+     */
+    void erase(const TKey& key) {
+        auto found = m_index.find(key);
+        if (found != m_index.end()) {
+            m_entries.erase(found->second);
+            m_index.erase(found);
+        }
+    }
+
+    /**
+     * Remove all entries. The counters are not reset.
+     */
+    void clear() {
+        m_entries.clear();
+        m_index.clear();
+    }
+
+    size_t size() const noexcept {
+        return m_entries.size();
+    }
+
+    size_t hits() const noexcept {
+        return m_hits;
+    }
+
+    size_t misses() const noexcept {
+        return m_misses;
+    }
+};
+
+#endif /* SRC_LRU_CACHE_HPP_ */
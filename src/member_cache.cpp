@@ -0,0 +1,111 @@
+/*
+ * member_cache.cpp
+ *
+ *  Created on:  2026-10-17
+ *      Author: Michael Reichert <michael.reichert@geofabrik.de>
+ */
+
+#include <ostream>
+
+#include "member_cache.hpp"
+
+MemberCache::MemberCache(const size_t way_capacity, const size_t relation_capacity) :
+    m_way_nodes(way_capacity),
+    m_relation_members(relation_capacity),
+    m_mutex() {
+}
+
+std::vector<MemberNode> MemberCache::get_way_nodes(PostgresTable& node_ways_table,
+        const osmium::object_id_type way_id) {
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        const std::vector<MemberNode>* cached = m_way_nodes.get(way_id);
+        if (cached) {
+            return *cached;
+        }
+    }
+    std::vector<MemberNode> nodes = node_ways_table.get_way_nodes(way_id);
+    std::lock_guard<std::mutex> lock{m_mutex};
+    m_way_nodes.put(way_id, nodes);
+    return nodes;
+}
+
+std::vector<std::vector<MemberNode>> MemberCache::get_way_nodes(PostgresTable& node_ways_table,
+        const std::vector<osmium::object_id_type>& way_ids) {
+    std::vector<std::vector<MemberNode>> nodes(way_ids.size());
+    // positions of the ways which are not cached
+    std::vector<size_t> missing;
+    std::vector<osmium::object_id_type> missing_ids;
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        for (size_t i = 0; i != way_ids.size(); ++i) {
+            const std::vector<MemberNode>* cached = m_way_nodes.get(way_ids[i]);
+            if (cached) {
+                nodes[i] = *cached;
+            } else {
+                missing.push_back(i);
+                missing_ids.push_back(way_ids[i]);
+            }
+        }
+    }
+    if (missing.empty()) {
+        return nodes;
+    }
+    std::vector<std::vector<MemberNode>> queried = node_ways_table.get_way_nodes(missing_ids);
+    std::lock_guard<std::mutex> lock{m_mutex};
+    for (size_t i = 0; i != missing.size(); ++i) {
+        m_way_nodes.put(missing_ids[i], queried[i]);
+        nodes[missing[i]] = std::move(queried[i]);
+    }
+    return nodes;
+}
+
+std::vector<MemberCache::member_list_type> MemberCache::get_relation_members(PostgresTable& node_relations_table,
+        PostgresTable& way_relations_table, PostgresTable& relation_relations_table,
+        const std::vector<osmium::object_id_type>& relation_ids) {
+    std::vector<member_list_type> members(relation_ids.size());
+    std::vector<size_t> missing;
+    std::vector<osmium::object_id_type> missing_ids;
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        for (size_t i = 0; i != relation_ids.size(); ++i) {
+            const member_list_type* cached = m_relation_members.get(relation_ids[i]);
+            if (cached) {
+                members[i] = *cached;
+            } else {
+                missing.push_back(i);
+                missing_ids.push_back(relation_ids[i]);
+            }
+        }
+    }
+    if (missing.empty()) {
+        return members;
+    }
+    std::vector<member_list_type> queried(missing_ids.size());
+    node_relations_table.get_members_by_id_and_type(queried, missing_ids, osmium::item_type::node);
+    way_relations_table.get_members_by_id_and_type(queried, missing_ids, osmium::item_type::way);
+    relation_relations_table.get_members_by_id_and_type(queried, missing_ids, osmium::item_type::relation);
+    std::lock_guard<std::mutex> lock{m_mutex};
+    for (size_t i = 0; i != missing.size(); ++i) {
+        m_relation_members.put(missing_ids[i], queried[i]);
+        members[missing[i]] = std::move(queried[i]);
+    }
+    return members;
+}
+
+void MemberCache::invalidate_way(const osmium::object_id_type way_id) {
+    std::lock_guard<std::mutex> lock{m_mutex};
+    m_way_nodes.erase(way_id);
+}
+
+void MemberCache::invalidate_relation(const osmium::object_id_type relation_id) {
+    std::lock_guard<std::mutex> lock{m_mutex};
+    m_relation_members.erase(relation_id);
+}
+
+void MemberCache::print_statistics(std::ostream& out) {
+    std::lock_guard<std::mutex> lock{m_mutex};
+    out << "way node cache: " << m_way_nodes.hits() << " hits, " << m_way_nodes.misses() << " misses\n";
+    out << "relation member cache: " << m_relation_members.hits() << " hits, "
+            << m_relation_members.misses() << " misses\n";
+}
@@ -0,0 +1,102 @@
+/*
+ * member_cache.hpp
+ *
+ *  Created on:  2026-10-17
+ *      Author: Michael Reichert <michael.reichert@geofabrik.de>
+ */
+
+#ifndef SRC_MEMBER_CACHE_HPP_
+#define SRC_MEMBER_CACHE_HPP_
+
+#include <iosfwd>
+#include <mutex>
+#include <vector>
+
+#include "lru_cache.hpp"
+#include "postgres_table.hpp"
+
+/**
+ * \brief Cache of the node lists of ways and the member lists of relations read from the
+ * database while a diff is applied.
+ *
+ * A way can be a member of many relations, e.g. route relations, and is needed again if
+ * the areas of a relation are assembled. The cache avoids reading it from the database every time.
+ *
+ * The entry of a way or relation has to be invalidated if the diff writes a new version of it.
+ * The cache can be used by multiple threads, the database is queried without holding the lock.
+ */
+class MemberCache {
+
+    using member_list_type = std::vector<postgres_drivers::MemberIdTypePos>;
+
+    LRUCache<osmium::object_id_type, std::vector<MemberNode>> m_way_nodes;
+
+    LRUCache<osmium::object_id_type, member_list_type> m_relation_members;
+
+    std::mutex m_mutex;
+
+public:
+    /**
+     * \param way_capacity maximum number of cached node lists of ways
+     * \param relation_capacity maximum number of cached member lists of relations
+     */
+    MemberCache(const size_t way_capacity, const size_t relation_capacity);
+
+    MemberCache(const MemberCache&) = delete;
+
+    MemberCache& operator=(const MemberCache&) = delete;
+
+    /**
+     * \brief Get the member nodes of a way from the cache or the database.
+     *
+     * \param node_ways_table table to query if the way is not cached
+     * \param way_id OSM way ID
+     * \throws std::runtime_error if query execution fails
+     * \returns vector of node IDs sorted by position or empty vector if none was found
+     */
+    std::vector<MemberNode> get_way_nodes(PostgresTable& node_ways_table, const osmium::object_id_type way_id);
+
+    /**
+     * \brief Get the member nodes of multiple ways from the cache or the database.
+     *
+     * The ways missing in the cache are read with one batch of queries.
+     *
+     * \param node_ways_table table to query for the ways which are not cached
+     * \param way_ids OSM way IDs
+     * \throws std::runtime_error if query execution fails
+     * \returns vector with the node IDs of each way sorted by position (empty vector if none was found)
+     */
+    std::vector<std::vector<MemberNode>> get_way_nodes(PostgresTable& node_ways_table,
+            const std::vector<osmium::object_id_type>& way_ids);
+
+    /**
+     * \brief Get the node, way and relation members of multiple relations from the cache or the database.
+     *
+     * \param node_relations_table table of node members
+     * \param way_relations_table table of way members
+     * \param relation_relations_table table of relation members
+     * \param relation_ids OSM relation IDs
+     * \throws std::runtime_error if query execution fails
+     * \returns vector with the members of each relation in the order node, way and relation members
+     */
+    std::vector<member_list_type> get_relation_members(PostgresTable& node_relations_table,
+            PostgresTable& way_relations_table, PostgresTable& relation_relations_table,
+            const std::vector<osmium::object_id_type>& relation_ids);
+
+    /**
+     * Drop the node list of a way because the diff contains a new version of it.
+     */
+    void invalidate_way(const osmium::object_id_type way_id);
+
+    /**
+     * Drop the member list of a relation because the diff contains a new version of it.
+     */
+    void invalidate_relation(const osmium::object_id_type relation_id);
+
+    /**
+     * Print the number of cache hits and misses.
+     */
+    void print_statistics(std::ostream& out);
+};
+
+#endif /* SRC_MEMBER_CACHE_HPP_ */
@@ -0,0 +1,259 @@
+/*
+ * parallel_multipolygon_manager.hpp
+ *
+ *  Created on:  2026-10-17
+ *      Author: Michael Reichert <michael.reichert@geofabrik.de>
+ */
+
+#ifndef SRC_PARALLEL_MULTIPOLYGON_MANAGER_HPP_
+#define SRC_PARALLEL_MULTIPOLYGON_MANAGER_HPP_
+
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include <osmium/area/assembler.hpp>
+#include <osmium/area/stats.hpp>
+#include <osmium/memory/buffer.hpp>
+#include <osmium/osm/relation.hpp>
+#include <osmium/osm/way.hpp>
+#include <osmium/relations/relations_manager.hpp>
+#include <osmium/tags/taglist.hpp>
+#include <osmium/tags/tags_filter.hpp>
+
+#include "worker_pool.hpp"
+
+/**
+ * \brief Multipolygon manager which assembles the areas with worker threads.
+ *
+ * It collects the multipolygon and boundary relations in the first pass and their member ways
+ * in the second pass like osmium::area::MultipolygonManager. Instead of assembling the areas on
+ * the thread reading the input file, closed ways and complete relations (followed by copies of
+ * their member ways) are copied into jobs. The jobs are assembled by a pool of worker threads.
+ * Each worker writes the areas into its own output buffer which is passed to the area handler
+ * on the same worker thread. Its results are handed over to the sink on the reading thread in
+ * the order the jobs were created, i.e. the sink does not have to be thread-safe.
+ *
+ * The area statistics of all workers are added up.
+ *
+ * \tparam TResult return type of the area handler, has to be movable
+ */
+template <typename TResult>
+class ParallelMultipolygonManager : public osmium::relations::RelationsManager<ParallelMultipolygonManager<TResult>,
+    false, true, false> {
+
+public:
+    /// Called by the worker threads with a buffer of areas, has to be thread-safe.
+    using area_handler_type = std::function<TResult(const osmium::memory::Buffer&)>;
+
+    /// Called on the reading thread with the results of the area handler.
+    using sink_type = std::function<void(TResult&)>;
+
+private:
+    struct AssemblyResult {
+        TResult result;
+        osmium::area::area_stats stats;
+    };
+
+    /// jobs are submitted if they are larger than this (in bytes)
+    static constexpr size_t max_job_size = 1024 * 1024;
+
+    static constexpr size_t initial_buffer_size = 2 * max_job_size;
+
+    const osmium::area::Assembler::config_type m_assembler_config;
+
+    osmium::TagsFilter m_filter;
+
+    area_handler_type m_area_handler;
+
+    sink_type m_sink;
+
+    osmium::area::area_stats m_stats;
+
+    /// ways and relations to be assembled by the next job
+    std::shared_ptr<osmium::memory::Buffer> m_job;
+
+    // The pool has to be destroyed before the other members because its workers access them.
+    OrderedWorkerPool<AssemblyResult> m_pool;
+
+    static std::shared_ptr<osmium::memory::Buffer> make_job() {
+        return std::shared_ptr<osmium::memory::Buffer>{new osmium::memory::Buffer{initial_buffer_size,
+            osmium::memory::Buffer::auto_grow::yes}};
+    }
+
+    /**
+     * Assemble all areas of a job. This method is called by the worker threads.
+     *
+     * A relation is followed by all its member ways whose reference is not 0.
+     */
+    AssemblyResult assemble(const osmium::memory::Buffer& job) const {
+        osmium::memory::Buffer areas{initial_buffer_size, osmium::memory::Buffer::auto_grow::yes};
+        osmium::area::area_stats stats;
+        std::vector<const osmium::Way*> ways;
+        auto it = job.cbegin<osmium::OSMObject>();
+        const auto end = job.cend<osmium::OSMObject>();
+        while (it != end) {
+            if (it->type() == osmium::item_type::way) {
+                const osmium::Way& way = static_cast<const osmium::Way&>(*it);
+                ++it;
+                try {
+                    osmium::area::Assembler assembler{m_assembler_config};
+                    assembler(way, areas);
+                    stats += assembler.stats();
+                } catch (const osmium::invalid_location&) {
+                    // A node of the way has no location (e.g. it is missing in the input file),
+                    // no area can be built. The way is skipped like by Osmium's
+                    // MultipolygonManager used without worker threads. Uncommitted parts of the
+                    // area are dropped.
+                    areas.rollback();
+                }
+                continue;
+            }
+            const osmium::Relation& relation = static_cast<const osmium::Relation&>(*it);
+            ++it;
+            ways.clear();
+            for (const auto& member : relation.members()) {
+                if (member.ref() != 0) {
+                    ways.push_back(static_cast<const osmium::Way*>(&*it));
+                    ++it;
+                }
+            }
+            try {
+                osmium::area::Assembler assembler{m_assembler_config};
+                assembler(relation, ways, areas);
+                stats += assembler.stats();
+            } catch (const osmium::invalid_location&) {
+                // Skipped for the same reason as ways above.
+                areas.rollback();
+            }
+        }
+        return AssemblyResult{m_area_handler(areas), stats};
+    }
+
+    void consume(AssemblyResult& result) {
+        m_stats += result.stats;
+        m_sink(result.result);
+    }
+
+    void submit_job() {
+        if (m_job->committed() == 0) {
+            return;
+        }
+        std::shared_ptr<osmium::memory::Buffer> job = std::move(m_job);
+        m_job = make_job();
+        m_pool.submit([this, job]() {
+            return assemble(*job);
+        }, [this](AssemblyResult& result) {
+            consume(result);
+        });
+    }
+
+    void possibly_submit_job() {
+        if (m_job->committed() >= max_job_size) {
+            submit_job();
+        }
+    }
+
+public:
+    /**
+     * Start the worker threads.
+     *
+     * \param assembler_config configuration of the assemblers
+     * \param threads number of worker threads
+     * \param area_handler function called by the workers with the assembled areas
+     * \param sink function called on the reading thread with the results of area_handler
+     * \param filter closed ways are only assembled if they have at least one tag matching the filter
+     */
+    ParallelMultipolygonManager(const osmium::area::Assembler::config_type& assembler_config, const size_t threads,
+            area_handler_type area_handler, sink_type sink, const osmium::TagsFilter& filter = osmium::TagsFilter{true}) :
+        m_assembler_config(assembler_config),
+        m_filter(filter),
+        m_area_handler(std::move(area_handler)),
+        m_sink(std::move(sink)),
+        m_stats(),
+        m_job(make_job()),
+        m_pool(threads, threads * 2) {
+    }
+
+    /**
+     * Statistics of all areas assembled so far.
+     */
+    const osmium::area::area_stats& stats() const noexcept {
+        return m_stats;
+    }
+
+    /**
+     * \brief Decide if a relation is interesting.
+     *
+     * Same as osmium::area::MultipolygonManager::new_relation().
+     */
+    bool new_relation(const osmium::Relation& relation) const noexcept {
+        const char* type = relation.tags().get_value_by_key("type");
+        if (type == nullptr) {
+            return false;
+        }
+        if (!std::strcmp(type, "multipolygon") || !std::strcmp(type, "boundary")) {
+            for (const auto& member : relation.members()) {
+                if (member.type() == osmium::item_type::way) {
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    bool new_member(const osmium::Relation& /*relation*/, const osmium::RelationMember& member,
+            std::size_t /*n*/) const noexcept {
+        return member.type() == osmium::item_type::way;
+    }
+
+    /**
+     * Add a relation whose members are all available and its member ways to the current job.
+     */
+    void complete_relation(const osmium::Relation& relation) {
+        m_job->add_item(relation);
+        m_job->commit();
+        for (const auto& member : relation.members()) {
+            if (member.ref() != 0) {
+                m_job->add_item(*this->get_member_way(member.ref()));
+                m_job->commit();
+            }
+        }
+        possibly_submit_job();
+    }
+
+    /**
+     * Add a closed way to the current job if it might be an area.
+     */
+    void after_way(const osmium::Way& way) {
+        // you need at least 4 nodes to make up a polygon
+        if (way.nodes().size() <= 3) {
+            return;
+        }
+        if (!way.nodes().front().location() || !way.nodes().back().location()
+                || !way.ends_have_same_location()) {
+            return;
+        }
+        if (way.tags().has_tag("area", "no") || osmium::tags::match_none_of(way.tags(), m_filter)) {
+            return;
+        }
+        m_job->add_item(way);
+        m_job->commit();
+        possibly_submit_job();
+    }
+
+    /**
+     * Assemble the remaining jobs and wait until the sink got all results.
+     *
+     * Call this method after the second pass.
+     */
+    void finish() {
+        submit_job();
+        m_pool.drain([this](AssemblyResult& result) {
+            consume(result);
+        });
+    }
+};
+
+#endif /* SRC_PARALLEL_MULTIPOLYGON_MANAGER_HPP_ */
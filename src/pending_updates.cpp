@@ -0,0 +1,207 @@
+/*
+ * pending_updates.cpp
+ *
+ *  Created on:  2026-10-17
+ *      Author: Michael Reichert <michael.reichert@geofabrik.de>
+ */
+
+#include <algorithm>
+#include <iostream>
+
+#include "pending_updates.hpp"
+
+PendingUpdates::PendingUpdates(PostgresTable& node_ways_table, PostgresTable& node_relations_table,
+        PostgresTable& way_relations_table, PostgresTable& relation_relations_table,
+        PostgresTable* areas_table, PostgresTable& ways_linear_table,
+        const UpdateLocationHandler& location_index, MemberCache& member_cache) :
+    m_node_ways_table(node_ways_table),
+    m_node_relations_table(node_relations_table),
+    m_way_relations_table(way_relations_table),
+    m_relation_relations_table(relation_relations_table),
+    m_areas_table(areas_table),
+    m_ways_linear_table(ways_linear_table),
+    m_location_index(location_index),
+    m_member_cache(member_cache),
+    m_relation_geometries(),
+    m_wkb_buffer() {
+}
+
+/*static*/ bool PendingUpdates::add_member_way_geometry(RelationGeometryBuilder& geometries,
+        const UpdateLocationHandler& location_index, const std::vector<MemberNode>& nodes,
+        std::vector<geos::geom::Coordinate>* coordinates) {
+    geometries.linestring_start();
+    for (auto itn = nodes.begin(); itn != nodes.end(); ++itn) {
+        osmium::Location loc = location_index.get_node_location(itn->node_ref.ref());
+        if (!loc.valid()) {
+            // some nodes are missing for this way
+            geometries.linestring_discard();
+            return false;
+        }
+        geometries.linestring_add_location(loc);
+        if (coordinates) {
+            coordinates->emplace_back(loc.lon_without_check(), loc.lat_without_check());
+        }
+    }
+    return geometries.linestring_finish() >= 2;
+}
+
+PendingUpdates::Result PendingUpdates::update_ways(const std::vector<osmium::object_id_type>& ids) {
+    Result result;
+    // get node lists of the ways
+    std::vector<std::vector<MemberNode>> member_nodes = m_member_cache.get_way_nodes(m_node_ways_table, ids);
+    // Check if we have to update areas
+    std::vector<bool> areas;
+    if (m_areas_table) {
+        areas = m_areas_table->contains_osm_ids(ids);
+    }
+    result.way_geometries.reserve(ids.size());
+    for (size_t i = 0; i != ids.size(); ++i) {
+        update_way(ids[i], member_nodes[i], m_areas_table && areas[i], result);
+    }
+    return result;
+}
+
+void PendingUpdates::update_way(const osmium::object_id_type id, std::vector<MemberNode>& member_nodes,
+        const bool area_to_update, Result& result) {
+    //TODO trigger tile expiry
+    //TODO PostgresTable::get_way_nodes should return std::vector<osmium::NodeRef> directly.
+    std::vector<osmium::NodeRef> node_refs;
+    // add locations
+    m_wkb_buffer.clear();
+    try {
+        // The WKB factory appends the geometry to the buffer only if it could be built.
+        wkbhpp::output_scope scope{m_ways_linear_table.wkb_output(), m_wkb_buffer};
+        m_ways_linear_table.wkb_factory().linestring_start();
+        for (auto& n : member_nodes) {
+            n.node_ref.set_location(m_location_index.get_node_location(n.node_ref.ref()));
+        }
+        for (auto& n : member_nodes) {
+            node_refs.push_back(n.node_ref);
+        }
+        size_t points = m_ways_linear_table.wkb_factory().fill_linestring(node_refs.begin(), node_refs.end());
+        m_ways_linear_table.wkb_factory().linestring_finish(points);
+
+        // This point is only reached if a valid geometry could be build. If so,
+        // trigger a geometry update of all relations using this way.
+        result.updated_ways.push_back(id);
+    } catch (osmium::geometry_error& e) {
+        std::cerr << e.what() << "\n";
+    } catch (osmium::not_found& e) {
+        std::cerr << e.what() << "\n";
+    }
+    if (m_wkb_buffer.empty()) {
+        m_wkb_buffer = "010200000000000000";
+    }
+    result.way_geometries.emplace_back(id, m_wkb_buffer);
+    //TODO code before this "if" becomes unnecessary once ways are not written to lines table any more if they are considered as areas only.
+    if (!area_to_update) {
+        return;
+    }
+    m_wkb_buffer.clear();
+    try {
+        wkbhpp::output_scope scope{m_areas_table->wkb_output(), m_wkb_buffer};
+        m_areas_table->wkb_factory().polygon_start();
+        size_t points = m_areas_table->wkb_factory().fill_polygon_unique(node_refs.begin(), node_refs.end());
+        m_areas_table->wkb_factory().polygon_finish(points);
+    } catch (osmium::geometry_error& e) {
+        //TODO delete entry if something failed
+        std::cerr << e.what() << "\n";
+    } catch (osmium::not_found& e) {
+        std::cerr << e.what() << "\n";
+    }
+    if (m_wkb_buffer.empty()) {
+        m_wkb_buffer = "010300000000000000";
+    }
+    result.area_geometries.emplace_back(id, m_wkb_buffer);
+}
+
+PendingUpdates::Result PendingUpdates::update_relations(const std::vector<osmium::object_id_type>& ids) {
+    Result result;
+    // get relation members from relations table
+    std::vector<std::vector<postgres_drivers::MemberIdTypePos>> members = m_member_cache.get_relation_members(
+            m_node_relations_table, m_way_relations_table, m_relation_relations_table, ids);
+    std::vector<bool> areas;
+    if (m_areas_table) {
+        // Areas built from relations have negative IDs.
+        std::vector<osmium::object_id_type> area_ids;
+        area_ids.reserve(ids.size());
+        for (const osmium::object_id_type id : ids) {
+            area_ids.push_back(-id);
+        }
+        areas = m_areas_table->contains_osm_ids(area_ids);
+    }
+    // get node lists of all member ways
+    std::vector<osmium::object_id_type> way_ids;
+    for (const auto& relation_members : members) {
+        for (const auto& m : relation_members) {
+            if (m.type == osmium::item_type::way) {
+                way_ids.push_back(m.id);
+            }
+        }
+    }
+    std::sort(way_ids.begin(), way_ids.end());
+    way_ids.erase(std::unique(way_ids.begin(), way_ids.end()), way_ids.end());
+    std::vector<std::vector<MemberNode>> nodes = m_member_cache.get_way_nodes(m_node_ways_table, way_ids);
+    result.way_nodes.reserve(way_ids.size());
+    for (size_t i = 0; i != way_ids.size(); ++i) {
+        result.way_nodes.emplace(way_ids[i], std::move(nodes[i]));
+    }
+    result.relation_geometries.reserve(ids.size());
+    for (size_t i = 0; i != ids.size(); ++i) {
+        update_relation(ids[i], members[i], result.way_nodes, result);
+        //TODO code before this "if" becomes unnecessary once ways are not written to lines table any more if they are considered as areas only.
+        if (m_areas_table && areas[i]) {
+            result.multipolygons.emplace_back(ids[i], std::move(members[i]));
+        }
+    }
+    return result;
+}
+
+void PendingUpdates::update_relation(const osmium::object_id_type id, std::vector<postgres_drivers::MemberIdTypePos>& members,
+        const way_nodes_map_type& way_nodes, Result& result) {
+    std::sort(members.begin(), members.end());
+    m_relation_geometries.clear();
+    for (auto it = members.begin(); it != members.end(); ++it) {
+        if (it->type == osmium::item_type::node) {
+            osmium::Location loc = m_location_index.get_node_location(it->id);
+            if (loc.valid()) {
+                m_relation_geometries.add_point(loc);
+            }
+        } else if (it->type == osmium::item_type::way) {
+            const auto found = way_nodes.find(it->id);
+            if (found != way_nodes.end()) {
+                add_member_way_geometry(m_relation_geometries, m_location_index, found->second, nullptr);
+            }
+        }
+        // We do not add the geometry of this relation to the GeometryCollection.
+        /// \todo support one level of nested relations
+    }
+    RelationGeometries geometries {id, "", ""};
+    m_relation_geometries.append_multipoint(geometries.points, false);
+    m_relation_geometries.append_multilinestring(geometries.lines, false);
+    result.relation_geometries.push_back(std::move(geometries));
+}
+
+PendingUpdatesWorker::PendingUpdatesWorker(CerepsoConfig& config, PostgresTable& node_ways_table,
+        PostgresTable& node_relations_table, PostgresTable& way_relations_table,
+        PostgresTable& relation_relations_table, PostgresTable* areas_table, PostgresTable& ways_linear_table,
+        const UpdateLocationHandler& location_index, MemberCache& member_cache) :
+    m_node_ways_table(node_ways_table.get_name().c_str(), config, node_ways_table.get_columns()),
+    m_node_relations_table(node_relations_table.get_name().c_str(), config, node_relations_table.get_columns()),
+    m_way_relations_table(way_relations_table.get_name().c_str(), config, way_relations_table.get_columns()),
+    m_relation_relations_table(relation_relations_table.get_name().c_str(), config,
+            relation_relations_table.get_columns()),
+    m_areas_table(areas_table
+            ? new PostgresTable(areas_table->get_name().c_str(), config, areas_table->get_columns())
+            : nullptr),
+    m_updates(m_node_ways_table, m_node_relations_table, m_way_relations_table, m_relation_relations_table,
+            m_areas_table.get(), ways_linear_table, location_index, member_cache) {
+    // Tables are opened in append mode, i.e. only the prepared statements are created.
+    m_node_ways_table.init();
+    m_node_relations_table.init();
+    m_way_relations_table.init();
+    m_relation_relations_table.init();
+    if (m_areas_table) {
+        m_areas_table->init();
+    }
+}
@@ -0,0 +1,232 @@
+/*
+ * pending_updates.hpp
+ *
+ *  Created on:  2026-10-17
+ *      Author: Michael Reichert <michael.reichert@geofabrik.de>
+ */
+
+#ifndef SRC_PENDING_UPDATES_HPP_
+#define SRC_PENDING_UPDATES_HPP_
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <geos/geom/Coordinate.h>
+
+#include "member_cache.hpp"
+#include "postgres_table.hpp"
+#include "relation_geometry_builder.hpp"
+#include "update_location_handler.hpp"
+
+/**
+ * \brief Recompute the geometries of ways and relations whose members have been changed by a diff
+ * without changes to the ways or relations themselves.
+ *
+ * The new geometries are returned instead of being written to the database. This way the
+ * database is only read and multiple instances with their own database connections can be
+ * used by worker threads while the results are written by the main thread in the transaction
+ * of the diff.
+ */
+class PendingUpdates {
+public:
+    /// member nodes of ways by way ID
+    using way_nodes_map_type = std::unordered_map<osmium::object_id_type, std::vector<MemberNode>>;
+
+    /// ID and geometry (WKB as hex string)
+    using geometry_type = std::pair<osmium::object_id_type, std::string>;
+
+    /**
+     * New geometry collections of the point and line members of a relation.
+     */
+    struct RelationGeometries {
+        osmium::object_id_type id;
+
+        /// MultiPoint (WKB as hex string)
+        std::string points;
+
+        /// MultiLineString (WKB as hex string)
+        std::string lines;
+    };
+
+    /**
+     * Result of a batch of ways or relations.
+     */
+    struct Result {
+        /// new geometries of the ways' table
+        std::vector<geometry_type> way_geometries;
+
+        /// new geometries of the areas' table
+        std::vector<geometry_type> area_geometries;
+
+        /// new geometries of the relations' table
+        std::vector<RelationGeometries> relation_geometries;
+
+        /// ways with a valid new geometry, the relations using them have to be updated
+        std::vector<osmium::object_id_type> updated_ways;
+
+        /// relations whose areas have to be assembled again, with their members
+        std::vector<std::pair<osmium::object_id_type, std::vector<postgres_drivers::MemberIdTypePos>>> multipolygons;
+
+        /// member nodes of the member ways of the relations in #multipolygons (and maybe others)
+        way_nodes_map_type way_nodes;
+    };
+
+private:
+    PostgresTable& m_node_ways_table;
+
+    PostgresTable& m_node_relations_table;
+
+    PostgresTable& m_way_relations_table;
+
+    PostgresTable& m_relation_relations_table;
+
+    /// areas table, nullptr if areas are disabled
+    PostgresTable* m_areas_table;
+
+    /// table whose WKB factory is used, the factory is local to the calling thread
+    PostgresTable& m_ways_linear_table;
+
+    const UpdateLocationHandler& m_location_index;
+
+    /// cache of node lists and member lists, shared by all instances
+    MemberCache& m_member_cache;
+
+    /// geometries of the members of the relation which is being updated, reused for all relations
+    RelationGeometryBuilder m_relation_geometries;
+
+    /// buffer for geometries of updated ways, reused to avoid allocations
+    std::string m_wkb_buffer;
+
+    /**
+     * Compute the new geometries of a way and add them to the result.
+     *
+     * \param id OSM way ID
+     * \param member_nodes member nodes of the way, their locations are set by this method
+     * \param area_to_update the way is in the areas table
+     * \param result result to add the geometries to
+     */
+    void update_way(const osmium::object_id_type id, std::vector<MemberNode>& member_nodes,
+            const bool area_to_update, Result& result);
+
+    /**
+     * Compute the new geometry collections of a relation and add them to the result.
+     *
+     * \param id OSM relation ID
+     * \param members ID, type and rank of the members
+     * \param way_nodes member nodes of (at least) all member ways
+     * \param result result to add the geometries to
+     */
+    void update_relation(const osmium::object_id_type id, std::vector<postgres_drivers::MemberIdTypePos>& members,
+            const way_nodes_map_type& way_nodes, Result& result);
+
+public:
+    PendingUpdates() = delete;
+
+    PendingUpdates(const PendingUpdates&) = delete;
+
+    PendingUpdates& operator=(const PendingUpdates&) = delete;
+
+    /**
+     * \param areas_table areas table, nullptr if areas are disabled
+     * \param ways_linear_table only used to get the WKB factory of the calling thread, may be
+     * shared with other threads
+     * \param location_index location index, has to support concurrent lookups if the instance
+     * is used by another thread than the main thread
+     * \param member_cache cache of node lists of ways and member lists of relations
+     */
+    PendingUpdates(PostgresTable& node_ways_table, PostgresTable& node_relations_table,
+            PostgresTable& way_relations_table, PostgresTable& relation_relations_table,
+            PostgresTable* areas_table, PostgresTable& ways_linear_table,
+            const UpdateLocationHandler& location_index, MemberCache& member_cache);
+
+    /**
+     * \brief Add the linestring of a member way to a RelationGeometryBuilder.
+     *
+     * The way is skipped if the location of any of its nodes is missing.
+     *
+     * \param geometries builder to add the linestring to
+     * \param location_index location index to read the locations of the nodes from
+     * \param nodes member nodes of the way
+     * \param coordinates vector to append the coordinates of the way to (used for tile expiry),
+     * may be nullptr
+     *
+     * \returns true if the linestring was added
+     */
+    static bool add_member_way_geometry(RelationGeometryBuilder& geometries, const UpdateLocationHandler& location_index,
+            const std::vector<MemberNode>& nodes, std::vector<geos::geom::Coordinate>* coordinates);
+
+    /**
+     * Compute the new geometries of a batch of ways. The node lists of the ways are read from the
+     * cache or from the database with pipelined queries.
+     *
+     * \param ids OSM way IDs
+     *
+     * \throws std::runtime_error if a query fails
+     */
+    Result update_ways(const std::vector<osmium::object_id_type>& ids);
+
+    /**
+     * Compute the new geometries of a batch of relations. The members of the relations and the
+     * node lists of their member ways are read from the cache or from the database with
+     * pipelined queries.
+     *
+     * Areas of the relations are not assembled because the output of the area assembler has to
+     * be handled by the main thread. They are listed in Result::multipolygons instead.
+     *
+     * \param ids OSM relation IDs
+     *
+     * \throws std::runtime_error if a query fails
+     */
+    Result update_relations(const std::vector<osmium::object_id_type>& ids);
+};
+
+/**
+ * \brief Database connections of a thread recomputing pending ways and relations.
+ *
+ * The tables are opened again with the names and columns of the tables of the main thread.
+ */
+class PendingUpdatesWorker {
+
+    PostgresTable m_node_ways_table;
+
+    PostgresTable m_node_relations_table;
+
+    PostgresTable m_way_relations_table;
+
+    PostgresTable m_relation_relations_table;
+
+    std::unique_ptr<PostgresTable> m_areas_table;
+
+    PendingUpdates m_updates;
+
+public:
+    /**
+     * Open the database connections.
+     *
+     * \param config program configuration
+     * \param node_ways_table table of the main thread
+     * \param node_relations_table table of the main thread
+     * \param way_relations_table table of the main thread
+     * \param relation_relations_table table of the main thread
+     * \param areas_table table of the main thread, nullptr if areas are disabled
+     * \param ways_linear_table table of the main thread, only used to get the WKB factory of the
+     * worker's thread
+     * \param location_index location index supporting concurrent lookups
+     * \param member_cache cache shared with the main thread
+     *
+     * \throws std::runtime_error if a connection cannot be established
+     */
+    PendingUpdatesWorker(CerepsoConfig& config, PostgresTable& node_ways_table, PostgresTable& node_relations_table,
+            PostgresTable& way_relations_table, PostgresTable& relation_relations_table,
+            PostgresTable* areas_table, PostgresTable& ways_linear_table,
+            const UpdateLocationHandler& location_index, MemberCache& member_cache);
+
+    PendingUpdates& updates() noexcept {
+        return m_updates;
+    }
+};
+
+#endif /* SRC_PENDING_UPDATES_HPP_ */
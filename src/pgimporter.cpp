@@ -5,12 +5,18 @@
  *      Author: michael
  */
 
+#include <chrono>
+#include <csignal>
+#include <cstdlib> // getenv
 #include <iostream>
 #include <unistd.h> // ftruncate
+#include <sys/stat.h> // mkdir
 #include <functional>
 #include <getopt.h>
 #include <memory>
 #include <system_error>
+#include <thread>
+#include <vector>
 #include <osmium/area/multipolygon_manager.hpp>
 #include <osmium/index/map/sparse_mmap_array.hpp>
 #include <osmium/index/map/dense_mmap_array.hpp>
@@ -24,14 +30,20 @@
 #include <postgres_drivers/columns.hpp>
 #include "update_location_handler_factory.hpp"
 #include "definitions.hpp"
+#include "change_merger.hpp"
 #include "diff_handler1.hpp"
 #include "diff_handler2.hpp"
 #include "relation_collector.hpp"
 #include "expire_tiles_factory.hpp"
+#include "finalization_scheduler.hpp"
+#include "import_state.hpp"
+#include "replication_state.hpp"
 #include "column_config_parser.hpp"
 #include "definitions.hpp"
 #include "addr_interpolation_handler.hpp"
 #include "handler_collection.hpp"
+#include "parallel_multipolygon_manager.hpp"
+#include "worker_pool.hpp"
 
 /**
  * \mainpage
@@ -97,6 +109,24 @@ void dump_index_manually(index_type* location_index, const int fd) {
     mapping.unmap();
 }
 
+/**
+ * Create the output directory if necessary and truncate the manifest. The tables add their
+ * SQL scripts to the manifest later.
+ */
+void prepare_output_dir(const std::string& output_dir) {
+    if (::mkdir(output_dir.c_str(), 0777) == -1 && errno != EEXIST) {
+        std::cerr << "Can not create output directory '" << output_dir << "': " << std::strerror(errno) << "\n";
+        std::exit(1);
+    }
+    const std::string manifest = output_dir + "/manifest.sql";
+    const int fd = ::open(manifest.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666); // NOLINT(hicpp-signed-bitwise)
+    if (fd == -1) {
+        std::cerr << "Can not create manifest '" << manifest << "': " << std::strerror(errno) << "\n";
+        std::exit(1);
+    }
+    ::close(fd);
+}
+
 void dump_index(index_type* location_index, CerepsoConfig& config) {
     if (config.m_driver_config.updateable) {
         std::cerr << "Dumping location cache to file ";
@@ -119,6 +149,104 @@ void dump_index(index_type* location_index, CerepsoConfig& config) {
     }
 }
 
+/**
+ * \brief Run pass 2 of the import with worker threads building the lines of nodes, ways and relations.
+ *
+ * The handlers are applied to each buffer by the main thread first. Afterwards the buffer is
+ * handed over to a worker which builds the lines for the tables of the import handler. The
+ * batches are sent to the tables by the main thread in the order of the input file.
+ *
+ * \param reader reader of the input file
+ * \param import_handler handler building the lines
+ * \param threads number of worker threads
+ * \param handlers handlers to be applied on the main thread, the location handler has to be the first one
+ */
+template <typename... THandlers>
+void apply_with_workers(osmium::io::Reader& reader, ImportHandler& import_handler, const size_t threads,
+        THandlers&... handlers) {
+    OrderedWorkerPool<ImportBatch> pool{threads, threads * 2};
+    const auto send_batch = [](ImportBatch& batch) {
+        batch.send();
+    };
+    while (osmium::memory::Buffer buffer = reader.read()) {
+        osmium::apply(buffer, handlers...);
+        std::shared_ptr<osmium::memory::Buffer> shared_buffer = std::make_shared<osmium::memory::Buffer>(std::move(buffer));
+        pool.submit([&import_handler, shared_buffer]() {
+            return import_handler.build_batch(*shared_buffer);
+        }, send_batch);
+    }
+    pool.drain(send_batch);
+}
+
+namespace {
+
+    /// set by the handler of SIGINT and SIGTERM to stop following a replication directory
+    volatile std::sig_atomic_t stop_following = 0;
+
+    void handle_stop_signal(int) {
+        stop_following = 1;
+    }
+
+} // anonymous namespace
+
+/**
+ * \brief Apply the diffs of a replication directory until SIGINT or SIGTERM is received.
+ *
+ * The diff following the last one recorded in the database is applied next. The start of every
+ * diff is recorded, its sequence number is recorded in the transaction of the table committed
+ * last. The tables of way nodes, relation members and areas are not changed in a transaction.
+ * Therefore a diff which has been started but not recorded as applied may have been applied
+ * partially. It is replayed and the objects created by it are deleted first. A signal stops the
+ * loop after the current diff.
+ *
+ * \param config program configuration
+ * \param apply_diffs function applying diffs and writing their tile expiry list, see main()
+ *
+ * \throws std::runtime_error if the database has no record of an applied diff and no start is
+ * configured
+ */
+void follow_replication(CerepsoConfig& config,
+        const std::function<void(const std::vector<std::string>&, const bool, const std::string&)>& apply_diffs) {
+    ReplicationState state {config.m_follow_dir, config.m_driver_config.m_database_name};
+    int64_t next = state.last_applied() + 1;
+    if (next == 0) {
+        if (config.m_follow_start < 0) {
+            throw std::runtime_error{"The database has no record of an applied diff. Use --follow-start to set the first diff."};
+        }
+        next = config.m_follow_start;
+    }
+    // The previous run stopped while this diff was applied.
+    bool replay = state.in_progress() == next;
+    if (replay) {
+        std::cerr << "Diff " << next << " may have been applied partially, it is applied again.\n";
+    }
+    std::signal(SIGINT, handle_stop_signal);
+    std::signal(SIGTERM, handle_stop_signal);
+    while (!stop_following) {
+        const int64_t latest = state.latest_available();
+        while (next <= latest && !stop_following) {
+            const time_t diff_start = time(NULL);
+            const std::string file = state.diff_file(next);
+            std::cerr << "Applying diff " << next << " (" << file << ")" << std::endl;
+            state.start(next);
+            apply_diffs({file}, replay, ReplicationState::record_query(next));
+            replay = false;
+            std::cerr << "Diff " << next << " needed " << static_cast<int>(time(NULL) - diff_start) << " seconds" << std::endl;
+            ++next;
+        }
+        // Wait in steps of one second to react to signals quickly.
+        for (int i = 0; i < config.m_follow_interval && !stop_following; ++i) {
+            std::this_thread::sleep_for(std::chrono::seconds(1));
+        }
+    }
+    std::cerr << "Stopped following " << config.m_follow_dir << " after diff " << next - 1 << std::endl;
+}
+
+void print_area_stats(const osmium::area::area_stats& stats) {
+    std::cerr << "Assembled " << stats.from_ways << " areas from ways and " << stats.from_relations
+            << " areas from relations" << std::endl;
+}
+
 /**
  * \brief print program usage instructions and terminate the program
  *
@@ -130,9 +258,29 @@ void print_help(char* argv[], std::string message = "", const int return_code =
         std::cerr << message << "\n";
     }
     std::cerr << "Usage: " << argv[0] << " [OPTIONS] [INFILE]\n" \
-    "  -a, --append                     this is a diff import\n" \
+    "       " << argv[0] << " [OPTIONS] --append DIFF [DIFF ...]\n" \
+    "       " << argv[0] << " [OPTIONS] --append --follow=DIR\n" \
+    "  -a, --append                     this is a diff import, multiple diffs are merged and applied at once\n" \
     "  -A, --areas                      enable area support, disables updateability\n" \
     "  --associated-streets             Apply tags of relations of type associatedStreet to their members\n" \
+    "  --binary-copy                    use the binary format of COPY (import only, not with --append)\n" \
+    "  --copy-queue-size=NUM            number of chunks of COPY data queued per table for its writer thread\n" \
+    "                                   (default: 64), 0 disables the writer threads\n" \
+    "  --copy-shards=NUM                use NUM connections for COPY into the nodes, untagged nodes, ways and\n" \
+    "                                   node_ways tables (import only, default: 1)\n" \
+    "  --shard-by=MODE                  distribute rows among the connections by \"id\" or \"round-robin\"\n" \
+    "                                   (default: round-robin)\n" \
+    "  --output-dir=DIR                 write COPY files and SQL scripts to DIR instead of the database\n" \
+    "                                   (import only)\n" \
+    "  --compress-output                compress the COPY files written to the output directory with gzip\n" \
+    "  --threads=NUM                    build the lines for COPY with NUM worker threads (import) or\n" \
+    "                                   recompute changed geometries with NUM threads (append with\n" \
+    "                                   --flat-nodes), default: 1\n" \
+    "  --finalize-jobs=NUM              order and index up to NUM tables concurrently after the import\n" \
+    "                                   (default: 1)\n" \
+    "  --maintenance-work-mem=SIZE      maintenance_work_mem used for ordering and indexing (e.g. 4GB)\n" \
+    "  --max-parallel-maintenance-workers=NUM\n" \
+    "                                   max_parallel_maintenance_workers used for indexing\n" \
     "  -d, --database-name              database name\n" \
     "  -e FILE, --expire-tiles=FILE     write an expiry_tile list to FILE\n" \
     "  --expire-relations=SETTING       expiration setting for relations: NONE, ALL, NO_ROUTES\n" \
@@ -156,7 +304,24 @@ void print_help(char* argv[], std::string message = "", const int return_code =
     "  -s FILE, --style=FILE            Osm2pgsql style file (default: ./default.style)\n" \
     "  -l, --location-handler=HANDLER   use HANDLER as location handler\n" \
     "  -o, --no-order-by-geohash        don't order tables by ST_GeoHash\n" \
+    "  --spatial-sort                   sort the rows along a Hilbert curve before COPY instead of ordering\n" \
+    "                                   the tables by ST_GeoHash after the import (import only)\n" \
+    "  --sort-memory=MB                 memory used by each table for sorting before temporary files are\n" \
+    "                                   written (default: 256)\n" \
+    "  --sort-dir=DIR                   directory for the temporary files of --spatial-sort\n" \
+    "                                   (default: $TMPDIR or /tmp)\n" \
+    "  --resume                         resume a failed import, skip the phases it completed\n" \
+    "  --state-file=FILE                file recording the completed phases of an import\n" \
+    "                                   (default: cerepso-import.state)\n" \
+    "  --follow=DIR                     run as daemon and apply every new diff of the replication directory DIR\n" \
+    "                                   (append only)\n" \
+    "  --follow-interval=SEC            seconds to wait for new diffs in DIR (default: 60)\n" \
+    "  --follow-start=NUM               sequence number of the first diff to apply if the database has no\n" \
+    "                                   record of an applied diff\n" \
     "  -O, --one                        Don't create tables and columns needed for updates.\n" \
+    "  --single-pass                    read the input file only once and keep the node locations of all ways\n" \
+    "                                   in memory (requires --one, not with --areas, --associated-streets or\n" \
+    "                                   --interpolate-addr)\n" \
     "  --untagged-nodes                 Create a table for untagged nodes (in parallel to flatnodes file on disk).\n\n";
     exit(return_code);
 }
@@ -167,6 +332,25 @@ int main(int argc, char* argv[]) {
     static struct option long_options[] = {
             {"help",   no_argument, 0, 'h'},
             {"associated-streets", no_argument, 0, 203},
+            {"binary-copy", no_argument, 0, 206},
+            {"copy-queue-size", required_argument, 0, 207},
+            {"copy-shards", required_argument, 0, 208},
+            {"shard-by", required_argument, 0, 209},
+            {"output-dir", required_argument, 0, 210},
+            {"compress-output", no_argument, 0, 211},
+            {"threads", required_argument, 0, 212},
+            {"finalize-jobs", required_argument, 0, 213},
+            {"maintenance-work-mem", required_argument, 0, 214},
+            {"max-parallel-maintenance-workers", required_argument, 0, 215},
+            {"spatial-sort", no_argument, 0, 216},
+            {"sort-memory", required_argument, 0, 217},
+            {"sort-dir", required_argument, 0, 218},
+            {"resume", no_argument, 0, 219},
+            {"state-file", required_argument, 0, 220},
+            {"follow", required_argument, 0, 221},
+            {"follow-interval", required_argument, 0, 222},
+            {"follow-start", required_argument, 0, 223},
+            {"single-pass", no_argument, 0, 224},
             {"interpolate-addr", no_argument, 0, 205},
             {"debug",  no_argument, 0, 'D'},
             {"database",  required_argument, 0, 'd'},
@@ -277,6 +461,96 @@ int main(int argc, char* argv[]) {
             case 205:
                 config.m_address_interpolations = true;
                 break;
+            case 206:
+                config.m_driver_config.binary_copy = true;
+                break;
+            case 207:
+                if (atoi(optarg) < 0) {
+                    print_help(argv, "ERROR option --copy-queue-size: Wrong parameter.");
+                }
+                config.m_driver_config.copy_queue_size = atoi(optarg);
+                break;
+            case 208:
+                if (atoi(optarg) < 1) {
+                    print_help(argv, "ERROR option --copy-shards: Wrong parameter.");
+                }
+                config.m_copy_shards = atoi(optarg);
+                break;
+            case 209:
+                if (!strcmp(optarg, "id")) {
+                    config.m_driver_config.shard_by_id = true;
+                } else if (!strcmp(optarg, "round-robin")) {
+                    config.m_driver_config.shard_by_id = false;
+                } else {
+                    print_help(argv, "ERROR option --shard-by: Wrong parameter.");
+                }
+                break;
+            case 210:
+                config.m_driver_config.output_dir = optarg;
+                break;
+            case 211:
+                config.m_driver_config.compress_output = true;
+                break;
+            case 212:
+                if (atoi(optarg) < 1) {
+                    print_help(argv, "ERROR option --threads: Wrong parameter.");
+                }
+                config.m_threads = atoi(optarg);
+                break;
+            case 213:
+                if (atoi(optarg) < 1) {
+                    print_help(argv, "ERROR option --finalize-jobs: Wrong parameter.");
+                }
+                config.m_finalize_jobs = atoi(optarg);
+                break;
+            case 214:
+                if (strchr(optarg, '\'') || strchr(optarg, '\\') || optarg[0] == '\0') {
+                    print_help(argv, "ERROR option --maintenance-work-mem: Wrong parameter.");
+                }
+                config.m_maintenance_work_mem = optarg;
+                break;
+            case 215:
+                if (atoi(optarg) < 0) {
+                    print_help(argv, "ERROR option --max-parallel-maintenance-workers: Wrong parameter.");
+                }
+                config.m_max_parallel_maintenance_workers = atoi(optarg);
+                break;
+            case 216:
+                config.m_spatial_sort = true;
+                break;
+            case 217:
+                if (atoi(optarg) < 1) {
+                    print_help(argv, "ERROR option --sort-memory: Wrong parameter.");
+                }
+                config.m_sort_memory = atoi(optarg);
+                break;
+            case 218:
+                config.m_sort_dir = optarg;
+                break;
+            case 219:
+                config.m_resume = true;
+                break;
+            case 220:
+                config.m_state_file = optarg;
+                break;
+            case 221:
+                config.m_follow_dir = optarg;
+                break;
+            case 222:
+                if (atoi(optarg) < 1) {
+                    print_help(argv, "ERROR option --follow-interval: Wrong parameter.");
+                }
+                config.m_follow_interval = atoi(optarg);
+                break;
+            case 223:
+                if (atoll(optarg) < 0) {
+                    print_help(argv, "ERROR option --follow-start: Wrong parameter.");
+                }
+                config.m_follow_start = atoll(optarg);
+                break;
+            case 224:
+                config.m_single_pass = true;
+                break;
             default:
                 exit(1);
         }
@@ -292,6 +566,39 @@ int main(int argc, char* argv[]) {
     if (config.m_append && config.m_flat_nodes != "" && config.m_driver_config.untagged_nodes) {
         print_help(argv, "Ambigous command line options. A flat nodes file cannot be specified together with --untagged-nodes.");
     }
+    if (config.m_append && config.m_driver_config.binary_copy) {
+        print_help(argv, "Ambigous command line options. --binary-copy cannot be used together with --append.");
+    }
+    if (config.m_append && !config.m_driver_config.output_dir.empty()) {
+        print_help(argv, "Ambigous command line options. --output-dir cannot be used together with --append.");
+    }
+    if (config.m_append && config.m_spatial_sort) {
+        print_help(argv, "Ambigous command line options. --spatial-sort cannot be used together with --append.");
+    }
+    if (!config.m_follow_dir.empty() && !config.m_append) {
+        print_help(argv, "ERROR option --follow: requires --append.");
+    }
+    if (config.m_append && config.m_resume) {
+        print_help(argv, "Ambigous command line options. --resume cannot be used together with --append.");
+    }
+    if (config.m_single_pass && (config.m_driver_config.updateable || config.m_append || config.m_areas
+            || config.m_associated_streets || config.m_address_interpolations)) {
+        print_help(argv, "ERROR option --single-pass: requires --one and cannot be used together with --append,\n" \
+                "--areas, --associated-streets or --interpolate-addr.");
+    }
+    if (config.m_resume && !config.m_driver_config.output_dir.empty()) {
+        print_help(argv, "Ambigous command line options. --resume cannot be used together with --output-dir.");
+    }
+    if (config.m_spatial_sort && config.m_sort_dir.empty()) {
+        const char* tmpdir = getenv("TMPDIR");
+        config.m_sort_dir = (tmpdir && tmpdir[0] != '\0') ? tmpdir : "/tmp";
+    }
+    if (config.m_append && config.m_threads > 1 && config.m_flat_nodes.empty()) {
+        std::cerr << "WARNING: --threads is ignored in append mode without --flat-nodes.\n";
+    }
+    if (config.m_driver_config.compress_output && config.m_driver_config.output_dir.empty()) {
+        print_help(argv, "ERROR option --compress-output: requires --output-dir.");
+    }
     if (config.m_append && !config.m_flat_nodes.empty() && config.m_location_handler != "dense_file_array") {
         std::cerr << "WARNING: You are using --append with a flatnodes file but the wrong location index type.\n" \
                 "Flat node files can be only used with the dense_file_array location index in update mode.\n" \
@@ -300,10 +607,20 @@ int main(int argc, char* argv[]) {
     }
 
     int remaining_args = argc - optind;
-    if (remaining_args != 1) {
+    if (!config.m_follow_dir.empty()) {
+        // The diffs are read from the replication directory.
+        if (remaining_args != 0) {
+            print_help(argv, "ERROR: --follow cannot be used together with input files.");
+        }
+    } else if (remaining_args < 1 || (remaining_args > 1 && !config.m_append)) {
         print_help(argv, "ERROR: wrong arguments.");
     } else {
         config.m_osm_file =  argv[optind];
+        config.m_diff_files.assign(argv + optind, argv + argc);
+    }
+
+    if (!config.m_driver_config.output_dir.empty()) {
+        prepare_output_dir(config.m_driver_config.output_dir);
     }
 
     // column definitions, parse config
@@ -320,35 +637,84 @@ int main(int argc, char* argv[]) {
 
     time_t ts = time(NULL);
     PostgresTable nodes_table = config_parser.make_point_table("planet_osm_");
-    nodes_table.init();
     PostgresTable untagged_nodes_table {"untagged_nodes", config, std::move(untagged_nodes_columns)};
-    if (config.m_driver_config.untagged_nodes) {
-        untagged_nodes_table.init();
-    }
     PostgresTable node_ways_table {"node_ways", config, std::move(node_ways_columns)};
     PostgresTable node_relations_table {"node_relations", config, std::move(node_relations_columns)};
     PostgresTable way_relations_table {"way_relations", config, std::move(way_relations_columns)};
     PostgresTable relation_relations_table {"relation_relations", config, std::move(relation_relations_columns)};
-    if (config.m_driver_config.updateable) {
-        node_ways_table.init();
-        node_relations_table.init();
-        way_relations_table.init();
-        relation_relations_table.init();
-    }
     PostgresTable ways_linear_table = config_parser.make_line_table("planet_osm_");
-    ways_linear_table.init();
     PostgresTable areas_table = config_parser.make_polygon_table("planet_osm_");
-    if (config.m_areas) {
-        areas_table.init();
-    }
     PostgresTable interpolated_table {"interpolated_addresses", config,
         std::move(interpolation_columns)};
+    // tables written by this run except the relations table which is owned by the RelationCollector
+    std::vector<PostgresTable*> tables {&nodes_table};
+    if (config.m_driver_config.untagged_nodes) {
+        tables.push_back(&untagged_nodes_table);
+    }
+    if (config.m_driver_config.updateable) {
+        tables.push_back(&node_ways_table);
+        tables.push_back(&node_relations_table);
+        tables.push_back(&way_relations_table);
+        tables.push_back(&relation_relations_table);
+    }
+    tables.push_back(&ways_linear_table);
+    if (config.m_areas) {
+        tables.push_back(&areas_table);
+    }
+    if (config.m_address_interpolations) {
+        tables.push_back(&interpolated_table);
+    }
+
+    // The phases of an import are recorded to be able to resume it. If all tables have been
+    // loaded by an earlier run, they are only finalized.
+    std::unique_ptr<ImportState> import_state;
+    bool resume_finalization = false;
+    if (!config.m_append && config.m_driver_config.output_dir.empty()) {
+        import_state.reset(new ImportState{config.m_state_file, config.m_driver_config.m_database_name});
+        if (config.m_resume) {
+            import_state->resume(config.m_osm_file);
+            resume_finalization = import_state->completed("loaded:relations");
+            for (PostgresTable* table : tables) {
+                resume_finalization = resume_finalization && import_state->completed("loaded:" + table->get_name());
+            }
+            if (!resume_finalization) {
+                std::cerr << "Not all tables have been loaded by the earlier run. The import starts from the beginning.\n";
+            }
+        }
+        if (!resume_finalization) {
+            import_state->start(config.m_osm_file);
+        }
+    }
+    for (PostgresTable* table : tables) {
+        if (resume_finalization) {
+            table->attach();
+        } else {
+            table->init();
+        }
+    }
     AddrInterpolationHandler* interpolated_handler;
     if (config.m_address_interpolations) {
-        interpolated_table.init();
         interpolated_handler = new AddrInterpolationHandler(interpolated_table);
     }
 
+    // Order and index the tables. The largest tables are added first.
+    const auto finalize_tables = [&](PostgresTable& relations_table) {
+        const time_t finalization_start = time(NULL);
+        FinalizationScheduler scheduler{config.m_finalize_jobs, import_state.get()};
+        scheduler.add(untagged_nodes_table);
+        scheduler.add(nodes_table);
+        scheduler.add(node_ways_table);
+        scheduler.add(ways_linear_table);
+        scheduler.add(areas_table);
+        scheduler.add(relations_table);
+        scheduler.add(way_relations_table);
+        scheduler.add(node_relations_table);
+        scheduler.add(relation_relations_table);
+        scheduler.add(interpolated_table);
+        scheduler.run();
+        std::cerr << "Finalization of the tables needed " << static_cast<int> (time(NULL) - finalization_start) << " seconds" << std::endl;
+    };
+
     osmium::area::Assembler::config_type assembler_config;
     osmium::area::MultipolygonManager<osmium::area::Assembler>* mp_manager;
     if (config.m_areas) {
@@ -371,110 +737,208 @@ int main(int argc, char* argv[]) {
         std::unique_ptr<UpdateLocationHandler> location_handler = make_handler<dense_file_array_t>(
                 locations_table, locations_untagged_table, std::move(location_index));
         location_handler->ignore_errors();
-        osmium::io::Reader reader1(config.m_osm_file, osmium::osm_entity_bits::nwr);
         PostgresTable relations_table("relations", config, std::move(relation_other_columns));
         relations_table.init();
-        // send BEGIN to all tables
-        relations_table.send_begin();
-        nodes_table.send_begin();
-        untagged_nodes_table.send_begin();
-        ways_linear_table.send_begin();
-
-        ExpireTilesFactory expire_tiles_factory;
-        ExpireTiles* expire_tiles = expire_tiles_factory.create_expire_tiles(config);
-        DiffHandler1 append_handler1(config, nodes_table, &untagged_nodes_table, ways_linear_table, relations_table, node_ways_table,
-                node_relations_table, way_relations_table, relation_relations_table, expire_tiles, *location_handler, &areas_table);
-        // The location handler has not to be passed to the visitor in pass 1.
         if (config.m_areas) {
-            osmium::apply(reader1, append_handler1, *mp_manager);
-        } else {
-            osmium::apply(reader1, append_handler1);
+            // A multipolygon manager is created for every set of diffs.
+            delete mp_manager;
         }
-        reader1.close();
 
-        if (config.m_areas) {
-            // necessary because we don't use osmium::relations::read_relations
-            mp_manager->prepare_for_lookup();
-        }
+        // Apply a set of diffs. The tables with their prepared statements and the location index
+        // are reused if this is called multiple times. The tables of way nodes, relation members
+        // and areas are read by the worker threads with their own connections, therefore they
+        // commit every statement. The other tables are changed in one transaction. If the diffs
+        // may have been applied partially before, replay has to be set. The record query is sent
+        // in the transaction of the relations table which is committed last.
+        const auto apply_diffs = [&](const std::vector<std::string>& files, const bool replay,
+                const std::string& record_query) {
+            // The diff is decoded only once. Both passes are applied to the objects in memory.
+            // Multiple diffs are merged and only the newest version of each object is applied.
+            osmium::memory::Buffer diff_buffer = read_changes(files);
+            // send BEGIN to all tables
+            relations_table.send_begin();
+            nodes_table.send_begin();
+            untagged_nodes_table.send_begin();
+            ways_linear_table.send_begin();
 
-        osmium::io::Reader reader2(config.m_osm_file, osmium::osm_entity_bits::nwr);
-        DiffHandler2 append_handler2(config, nodes_table, &untagged_nodes_table, ways_linear_table, relations_table, node_ways_table,
-                node_relations_table, way_relations_table, relation_relations_table, expire_tiles, *location_handler, &areas_table, mp_manager);
-        if (config.m_areas) {
-            osmium::apply(reader2, *location_handler, append_handler2,
-                    mp_manager->handler([&append_handler2](osmium::memory::Buffer&& buffer) {
-                        osmium::apply(buffer, append_handler2);
-                    })
-                );
+            std::unique_ptr<osmium::area::MultipolygonManager<osmium::area::Assembler>> diff_mp_manager;
+            if (config.m_areas) {
+                diff_mp_manager.reset(new osmium::area::MultipolygonManager<osmium::area::Assembler>(assembler_config));
+            }
+            ExpireTilesFactory expire_tiles_factory;
+            ExpireTiles* expire_tiles = expire_tiles_factory.create_expire_tiles(config);
+            DiffHandler1 append_handler1(config, nodes_table, &untagged_nodes_table, ways_linear_table, relations_table, node_ways_table,
+                    node_relations_table, way_relations_table, relation_relations_table, expire_tiles, *location_handler, &areas_table);
+            if (replay) {
+                append_handler1.replay();
+            }
+            // The location handler has not to be passed to the visitor in pass 1.
+            if (config.m_areas) {
+                osmium::apply(diff_buffer, append_handler1, *diff_mp_manager);
+            } else {
+                osmium::apply(diff_buffer, append_handler1);
+            }
+            append_handler1.delete_objects();
+
+            if (config.m_areas) {
+                // necessary because we don't use osmium::relations::read_relations
+                diff_mp_manager->prepare_for_lookup();
+            }
+
+            {
+                // The tile expiry list is written when the handler is destroyed.
+                DiffHandler2 append_handler2(config, nodes_table, &untagged_nodes_table, ways_linear_table, relations_table, node_ways_table,
+                        node_relations_table, way_relations_table, relation_relations_table, expire_tiles, *location_handler, &areas_table,
+                        diff_mp_manager.get());
+                if (config.m_areas) {
+                    osmium::apply(diff_buffer, *location_handler, append_handler2,
+                            diff_mp_manager->handler([&append_handler2](osmium::memory::Buffer&& buffer) {
+                                osmium::apply(buffer, append_handler2);
+                            })
+                        );
+                } else {
+                    osmium::apply(diff_buffer, *location_handler, append_handler2);
+                }
+                append_handler2.after_relations();
+
+                // work on incomplete multipolygon and boundary relations
+                if (config.m_areas) {
+                    // Flush the content of the output buffer of the area assembler.
+                    append_handler2.flush();
+                    areas_table.start_copy();
+                    diff_mp_manager->for_each_incomplete_relation([&](const osmium::relations::RelationHandle& handle){
+                        append_handler2.incomplete_relation(handle);
+                    });
+                    // Flush the content of the output buffer of the area assembler.
+                    append_handler2.flush();
+                    areas_table.end_copy();
+                }
+            }
+            nodes_table.intermediate_commit();
+            untagged_nodes_table.intermediate_commit();
+            ways_linear_table.intermediate_commit();
+            if (!record_query.empty()) {
+                relations_table.send_query(record_query.c_str());
+            }
+            relations_table.intermediate_commit();
+        };
+
+        if (config.m_follow_dir.empty()) {
+            apply_diffs(config.m_diff_files, false, "");
         } else {
-            osmium::apply(reader2, *location_handler, append_handler2);
+            follow_replication(config, apply_diffs);
         }
-        append_handler2.after_relations();
-
-        // work on incomplete multipolygon and boundary relations
+    } else if (resume_finalization) {
+        std::cerr << "All tables have been loaded by the earlier run, resuming with their finalization." << std::endl;
         if (config.m_areas) {
-            // Flush the content of the output buffer of the area assembler.
-            append_handler2.flush();
-            areas_table.start_copy();
-            mp_manager->for_each_incomplete_relation([&](const osmium::relations::RelationHandle& handle){
-                append_handler2.incomplete_relation(handle);
-            });
-            // Flush the content of the output buffer of the area assembler.
-            append_handler2.flush();
-            areas_table.end_copy();
+            delete mp_manager;
         }
-
-        reader2.close();
+        if (config.m_flat_nodes != "" && !import_state->completed("location index")) {
+            // The location index is built again from the nodes of the input file.
+            ts = time(NULL);
+            std::cerr << "Reading nodes to dump the location cache";
+            const auto& map_factory = osmium::index::MapFactory<osmium::unsigned_object_id_type, osmium::Location>::instance();
+            auto location_index = map_factory.create_map(config.m_location_handler);
+            location_handler_type location_handler(*location_index);
+            osmium::io::Reader reader{config.m_osm_file, osmium::osm_entity_bits::node};
+            osmium::apply(reader, location_handler);
+            reader.close();
+            std::cerr << "… needed " << static_cast<int>(time(NULL) - ts) << " seconds" << std::endl;
+            ts = time(NULL);
+            std::cerr << "Dumping location cache as array to " << config.m_flat_nodes << " ...";
+            dump_index(location_index.get(), config);
+            std::cerr << " needed " << static_cast<int> (time(NULL) - ts) << " seconds" << std::endl;
+            import_state->complete("location index");
+        }
+        PostgresTable relations_table {"relations", config, std::move(relation_other_columns)};
+        relations_table.attach();
+        finalize_tables(relations_table);
     } else {
         const auto& map_factory = osmium::index::MapFactory<osmium::unsigned_object_id_type, osmium::Location>::instance();
         auto location_index = map_factory.create_map(config.m_location_handler);
         location_handler_type location_handler(*location_index);
-        ts = time(NULL);
-        std::cerr << "Pass 1 (relations)";
         RelationCollector rel_collector(config, relation_other_columns);
         AssociatedStreetRelationManager assoc_manager;
-        osmium::io::Reader reader1{config.m_osm_file, osmium::osm_entity_bits::way | osmium::osm_entity_bits::relation};
-        HandlerCollection handlers_collection1;
-        handlers_collection1.add(rel_collector);
-        if (config.m_areas) {
-            handlers_collection1.add<osmium::area::MultipolygonManager<osmium::area::Assembler>>(*mp_manager);
-        }
-        if (config.m_associated_streets) {
-            handlers_collection1.add<AssociatedStreetRelationManager>(assoc_manager);
-        }
-        if (config.m_address_interpolations) {
-            handlers_collection1.add<AddrInterpolationHandler>(*interpolated_handler);
+        // With --single-pass, relations are built from the location index and a way node store
+        // after the ways have been read. The options which need the relations before the nodes
+        // and ways are rejected while parsing the command line.
+        const bool single_pass = config.m_single_pass;
+        ImportHandler handler(config, nodes_table, &untagged_nodes_table, ways_linear_table, &assoc_manager, &areas_table, &node_ways_table,
+                &node_relations_table, &way_relations_table, &relation_relations_table);
+        // With worker threads, areas are assembled by worker threads as well. The lines of the
+        // areas are built by the same workers.
+        const bool parallel_areas = config.m_areas && config.m_threads > 1;
+        std::unique_ptr<ParallelMultipolygonManager<ImportBatch>> parallel_mp_manager;
+        if (parallel_areas) {
+            parallel_mp_manager.reset(new ParallelMultipolygonManager<ImportBatch>(assembler_config, config.m_threads,
+                [&handler](const osmium::memory::Buffer& areas) {
+                    return handler.build_batch(areas);
+                },
+                [](ImportBatch& batch) {
+                    batch.send();
+                }));
         }
-        osmium::apply(reader1, handlers_collection1);
-        reader1.close();
-        if (config.m_areas) {
-            // necessary because we don't use osmium::relations::read_relations
-            mp_manager->prepare_for_lookup();
+        if (!single_pass) {
+            ts = time(NULL);
+            std::cerr << "Pass 1 (relations)";
+            osmium::io::Reader reader1{config.m_osm_file, osmium::osm_entity_bits::way | osmium::osm_entity_bits::relation};
+            auto handlers_collection1 = make_handler_collection(&rel_collector,
+                    config.m_areas && !parallel_areas ? mp_manager : nullptr,
+                    parallel_mp_manager.get(),
+                    config.m_associated_streets ? &assoc_manager : nullptr,
+                    config.m_address_interpolations ? interpolated_handler : nullptr);
+            osmium::apply(reader1, handlers_collection1);
+            reader1.close();
+            if (parallel_areas) {
+                parallel_mp_manager->prepare_for_lookup();
+            } else if (config.m_areas) {
+                // necessary because we don't use osmium::relations::read_relations
+                mp_manager->prepare_for_lookup();
+            }
+            rel_collector.prepare_for_lookup();
+            std::cerr << "… needed " << static_cast<int>(time(NULL) - ts) << " seconds" << std::endl;
         }
-        rel_collector.prepare_for_lookup();
-        std::cerr << "… needed " << static_cast<int>(time(NULL) - ts) << " seconds" << std::endl;
 
         ts = time(NULL);
-        std::cerr << "Pass 2 (nodes and ways; writing everything to database)" << std::endl;
+        if (single_pass) {
+            std::cerr << "Single pass (nodes, ways and relations; writing everything to database)" << std::endl;
+        } else {
+            std::cerr << "Pass 2 (nodes and ways; writing everything to database)" << std::endl;
+        }
         osmium::io::Reader reader2(config.m_osm_file);
-        ImportHandler handler(config, nodes_table, &untagged_nodes_table, ways_linear_table, &assoc_manager, &areas_table, &node_ways_table,
-                &node_relations_table, &way_relations_table, &relation_relations_table);
-        HandlerCollection handlers_collection2;
-        handlers_collection2.add(rel_collector.handler());
+        SinglePassRelationHandler single_pass_handler(rel_collector, *location_index);
         if (config.m_address_interpolations) {
             interpolated_handler->after_pass1();
-            handlers_collection2.add(interpolated_handler->handler());
         }
-        handlers_collection2.add<ImportHandler>(handler);
-        if (config.m_areas) {
-            osmium::apply(reader2, location_handler, handlers_collection2,
-                mp_manager->handler([&handler](osmium::memory::Buffer&& buffer) {
-                    osmium::apply(buffer, handler);
-                })
-            );
-            delete mp_manager;
+        // With worker threads, the lines of the import handler are built by the workers.
+        auto handlers_collection2 = make_handler_collection(single_pass ? &single_pass_handler : nullptr,
+                single_pass ? nullptr : &rel_collector.handler(),
+                config.m_address_interpolations ? &interpolated_handler->handler() : nullptr,
+                config.m_threads > 1 ? nullptr : &handler);
+        if (config.m_threads > 1) {
+            // Lines of nodes, ways and relations are built by the workers. Areas are assembled
+            // and written by the workers of the multipolygon manager.
+            if (parallel_areas) {
+                apply_with_workers(reader2, handler, config.m_threads, location_handler, handlers_collection2,
+                        parallel_mp_manager->handler());
+                parallel_mp_manager->finish();
+                print_area_stats(parallel_mp_manager->stats());
+                delete mp_manager;
+            } else {
+                apply_with_workers(reader2, handler, config.m_threads, location_handler, handlers_collection2);
+            }
         } else {
-            osmium::apply(reader2, location_handler, handlers_collection2);
+            if (config.m_areas) {
+                osmium::apply(reader2, location_handler, handlers_collection2,
+                    mp_manager->handler([&handler](osmium::memory::Buffer&& buffer) {
+                        osmium::apply(buffer, handler);
+                    })
+                );
+                print_area_stats(mp_manager->stats());
+                delete mp_manager;
+            } else {
+                osmium::apply(reader2, location_handler, handlers_collection2);
+            }
         }
         reader2.close();
         std::cerr << "… needed " << static_cast<int> (time(NULL) - ts) << " seconds" << std::endl;
@@ -484,7 +948,11 @@ int main(int argc, char* argv[]) {
             std::cerr << "Dumping location cache as array to " << config.m_flat_nodes << " ...";
             dump_index(location_index.get(), config);
             std::cerr << " needed " << static_cast<int> (time(NULL) - ts) << " seconds" << std::endl;
+            if (import_state) {
+                import_state->complete("location index");
+            }
         }
+        finalize_tables(rel_collector.table());
     }
     if (config.m_address_interpolations) {
         delete interpolated_handler;
@@ -6,25 +6,50 @@
  */
 
 
+#include <ctime>
 #include <sstream>
+#include <postgres_drivers/binary_copy.hpp>
+#include <postgres_drivers/row_sorter.hpp>
 #include "postgres_handler.hpp"
+#include "spatial_sort_key.hpp"
+
+namespace {
+
+    /**
+     * Append the decimal representation of an integer to a string.
+     *
+     * This is much faster than sprintf and does not need any temporary string.
+     */
+    template <typename TInteger>
+    void append_integer(std::string& ss, const TInteger number) {
+        char buffer[24];
+        char* end = buffer + sizeof(buffer);
+        char* ptr = end;
+        const bool negative = number < 0;
+        // Negate as unsigned value to avoid an overflow for the smallest possible value.
+        uint64_t value = negative ? -static_cast<uint64_t>(number) : static_cast<uint64_t>(number);
+        do {
+            *--ptr = static_cast<char>('0' + value % 10);
+            value /= 10;
+        } while (value);
+        if (negative) {
+            *--ptr = '-';
+        }
+        ss.append(ptr, static_cast<size_t>(end - ptr));
+    }
+
+} // anonymous namespace
 
 void PostgresHandler::add_osm_id(std::string& ss, const osmium::object_id_type id) {
-    static char idbuffer[20];
-    sprintf(idbuffer, "%ld", id);
-    ss.append(idbuffer, strlen(idbuffer));
+    append_integer(ss, id);
 }
 
 void PostgresHandler::add_int32(std::string& ss, const int32_t number) {
-    static char idbuffer[16];
-    sprintf(idbuffer, "%d", number);
-    ss.append(idbuffer, strlen(idbuffer));
+    append_integer(ss, number);
 }
 
 void PostgresHandler::add_int16(std::string& ss, const int16_t number) {
-    static char idbuffer[8];
-    sprintf(idbuffer, "%hi", number);
-    ss.append(idbuffer, strlen(idbuffer));
+    append_integer(ss, number);
 }
 
 void PostgresHandler::add_username(std::string& ss, const char* username) {
@@ -32,25 +57,28 @@ void PostgresHandler::add_username(std::string& ss, const char* username) {
 }
 
 void PostgresHandler::add_uid(std::string& ss, const osmium::user_id_type uid) {
-    static char idbuffer[20];
-    sprintf(idbuffer, "%u", uid);
-    ss.append(idbuffer);
+    append_integer(ss, uid);
 }
 
 void PostgresHandler::add_version(std::string& ss, const osmium::object_version_type version) {
-    static char idbuffer[20];
-    sprintf(idbuffer, "%u", version);
-    ss.append(idbuffer);
+    append_integer(ss, version);
 }
 
 void PostgresHandler::add_timestamp(std::string& ss, const osmium::Timestamp& timestamp) {
-    ss.append(timestamp.to_iso());
+    // same output as osmium::Timestamp::to_iso() but without a temporary string
+    if (!timestamp.valid()) {
+        return;
+    }
+    const time_t seconds = timestamp.seconds_since_epoch();
+    struct tm tm;
+    gmtime_r(&seconds, &tm);
+    char buffer[32];
+    const size_t length = strftime(buffer, sizeof(buffer), "%Y-%m-%dT%H:%M:%SZ", &tm);
+    ss.append(buffer, length);
 }
 
 void PostgresHandler::add_changeset(std::string& ss, const osmium::changeset_id_type changeset) {
-    static char idbuffer[20];
-    sprintf(idbuffer, "%u", changeset);
-    ss.append(idbuffer);
+    append_integer(ss, changeset);
 }
 
 const osmium::TagList* PostgresHandler::get_relation_tags_to_apply(const osmium::object_id_type id,
@@ -71,9 +99,7 @@ const osmium::TagList* PostgresHandler::get_relation_tags_to_apply(const osmium:
         if (i != nodes.begin()) {
             query.append(", ");
         }
-        static char idbuffer[20];
-        sprintf(idbuffer, "%ld", i->ref());
-        query.append(idbuffer);
+        append_integer(query, i->ref());
     }
     query.push_back('}');
 }
@@ -84,9 +110,7 @@ const osmium::TagList* PostgresHandler::get_relation_tags_to_apply(const osmium:
         if (it != members.begin()) {
             query.append(", ");
         }
-        static char idbuffer[20];
-        sprintf(idbuffer, "%ld", it->ref());
-        query.append(idbuffer);
+        append_integer(query, it->ref());
     }
     query.push_back('}');
 }
@@ -116,157 +140,331 @@ const osmium::TagList* PostgresHandler::get_relation_tags_to_apply(const osmium:
 }
 
 /*static*/ void PostgresHandler::add_geometry(const osmium::OSMObject& object, std::string& query, PostgresTable& table) {
-    std::string wkb; // initalize with empty geometry
-    try {
+    const bool binary = table.binary_copy();
+    size_t field_offset = 0;
+    if (binary) {
+        field_offset = postgres_drivers::binary::start_field(query);
+    } else {
+        query.append("SRID=4326;");
+    }
+    const size_t geometry_offset = query.size();
+    {
+        // The WKB factory appends the geometry to the query only if it could be built.
+        wkbhpp::output_scope scope{table.wkb_output(), query};
+        try {
+            switch (object.type()) {
+            case osmium::item_type::node :
+                table.wkb_factory().create_point(static_cast<const osmium::Node&>(object));
+                break;
+            case osmium::item_type::way :
+                table.wkb_factory().create_linestring(static_cast<const osmium::Way&>(object).nodes());
+                break;
+            //TODO distinguish between simple polygons and multipolygons (OGC terminology here)
+            case osmium::item_type::area :
+                table.wkb_factory().create_multipolygon(static_cast<const osmium::Area&>(object));
+                break;
+            default :
+                assert(false && "This OSM object type is not supported for a geometry field.");
+            }
+        } catch (osmium::geometry_error& e) {
+            std::cerr << e.what() << "\n";
+        }
+    }
+    if (query.size() == geometry_offset) {
+        // write empty geometry
         switch (object.type()) {
         case osmium::item_type::node :
-            wkb = "010400000000000000";
-            wkb = table.wkb_factory().create_point(static_cast<const osmium::Node&>(object));
+            query.append(binary ? postgres_drivers::binary::empty_ewkb(4, 4326) : "010400000000000000");
             break;
         case osmium::item_type::way :
-            wkb = "010200000000000000";
-            wkb = table.wkb_factory().create_linestring(static_cast<const osmium::Way&>(object).nodes());
+            query.append(binary ? postgres_drivers::binary::empty_ewkb(2, 4326) : "010200000000000000");
             break;
-        //TODO distinguish between simple polygons and multipolygons (OGC terminology here)
         case osmium::item_type::area :
-            wkb = "0106000020E610000000000000";
-            wkb = table.wkb_factory().create_multipolygon(static_cast<const osmium::Area&>(object));
+            query.append(binary ? postgres_drivers::binary::empty_ewkb(6, 4326) : "0106000020E610000000000000");
             break;
         default :
-            assert(false && "This OSM object type is not supported for a geometry field.");
+            break;
         }
-    } catch (osmium::geometry_error& e) {
-        std::cerr << e.what() << "\n";
     }
-    query.append("SRID=4326;");
-    query.append(wkb);
+    if (binary) {
+        // The WKB factory of the table writes EWKB including the SRID in binary mode.
+        postgres_drivers::binary::finish_field(query, field_offset);
+    }
 }
 
-/*static*/ bool PostgresHandler::fill_field(const osmium::OSMObject& object, postgres_drivers::ColumnsConstIterator it,
-        std::string& query, bool column_added, std::vector<const char*>& written_keys, PostgresTable& table,
-        const osmium::TagList* rel_tags_to_apply) {
-    if (column_added) {
-        PostgresTable::add_separator_to_stringstream(query);
+/*static*/ void PostgresHandler::match_tags(const osmium::OSMObject& object, const PostgresTable& table,
+        const osmium::TagList* rel_tags_to_apply, std::vector<const char*>& tag_values) {
+    const ColumnPlan& plan = table.column_plan();
+    tag_values.assign(plan.tag_column_count(), nullptr);
+    if (plan.tag_column_count() == 0) {
+        return;
     }
-    column_added = true;
-    if (it->column_class() == postgres_drivers::ColumnClass::TAGS_OTHER) {
-        bool first_tag = true;
-        // add normal tags
-        for (const auto& tag : object.tags()) {
-            bool has_tag = false;
-            for (const char* k : written_keys) {
-                has_tag |= (strcmp(k, tag.key()) == 0);
+    for (const auto& tag : object.tags()) {
+        const int index = plan.find_tag_column(tag.key());
+        if (index >= 0 && !tag_values[index]) {
+            tag_values[index] = tag.value();
+        }
+    }
+    // Tags of the object take precedence over the tags of the relation.
+    if (rel_tags_to_apply) {
+        for (const auto& tag : *rel_tags_to_apply) {
+            const int index = plan.find_tag_column(tag.key());
+            if (index >= 0 && !tag_values[index]) {
+                tag_values[index] = tag.value();
             }
-            if (!has_tag && !table.get_columns().drop_filter()(tag)) {
-                if (!first_tag) {
-                    query.push_back(',');
-                }
-                PostgresTable::escape4hstore(tag.key(), query);
-                query.append("=>");
-                PostgresTable::escape4hstore(tag.value(), query);
-                first_tag = false;
+        }
+    }
+}
+
+namespace {
+
+    /**
+     * Call a function for all tags of an object and the relation tags to apply which belong into
+     * the hstore column, i.e. which have no column on their own and are not dropped.
+     */
+    template <typename TFunction>
+    void for_each_other_tag(const osmium::OSMObject& object, const PostgresTable& table,
+            const osmium::TagList* rel_tags_to_apply, TFunction&& function) {
+        const ColumnPlan& plan = table.column_plan();
+        for (const auto& tag : object.tags()) {
+            if (plan.find_tag_column(tag.key()) == -1 && !table.get_columns().drop_filter()(tag)) {
+                function(tag);
             }
         }
         if (rel_tags_to_apply) {
-            // add relation tags
             for (const auto& tag : *rel_tags_to_apply) {
-                bool has_tag = false;
-                for (const char* k : written_keys) {
-                    has_tag |= (strcmp(k, tag.key()) == 0);
-                }
-                if (!has_tag && !table.get_columns().drop_filter()(tag)) {
-                    if (!first_tag) {
-                        query.push_back(',');
-                    }
-                    PostgresTable::escape4hstore(tag.key(), query);
-                    query.append("=>");
-                    PostgresTable::escape4hstore(tag.value(), query);
-                    first_tag = false;
+                if (plan.find_tag_column(tag.key()) == -1 && !table.get_columns().drop_filter()(tag)) {
+                    function(tag);
                 }
             }
         }
-    } else if (it->column_class() == postgres_drivers::ColumnClass::TAG) {
-        const char* t = object.get_value_by_key(it->name().c_str());
-        if (!t && rel_tags_to_apply && rel_tags_to_apply->has_key(it->name().c_str())) {
-            PostgresTable::escape(rel_tags_to_apply->get_value_by_key(it->name().c_str()), query);
-            written_keys.push_back(it->name().c_str());
-        } else if (t) {
-            PostgresTable::escape(t, query);
-            written_keys.push_back(it->name().c_str());
+    }
+
+    osmium::object_id_type osm_id_of(const osmium::OSMObject& object) {
+        if (object.type() == osmium::item_type::area) {
+            const osmium::Area& area = static_cast<const osmium::Area&>(object);
+            return area.from_way() ? area.orig_id() : -area.orig_id();
+        }
+        return object.id();
+    }
+
+} // anonymous namespace
+
+/*static*/ bool PostgresHandler::fill_field(const osmium::OSMObject& object, const ColumnPlan::Slot& slot,
+        const std::vector<const char*>& tag_values, std::string& query, bool column_added, PostgresTable& table,
+        const osmium::TagList* rel_tags_to_apply) {
+    if (column_added) {
+        PostgresTable::add_separator_to_stringstream(query);
+    }
+    switch (slot.column_class) {
+    case postgres_drivers::ColumnClass::TAGS_OTHER: {
+        bool first_tag = true;
+        for_each_other_tag(object, table, rel_tags_to_apply, [&query, &first_tag](const osmium::Tag& tag) {
+            if (!first_tag) {
+                query.push_back(',');
+            }
+            PostgresTable::escape4hstore(tag.key(), query);
+            query.append("=>");
+            PostgresTable::escape4hstore(tag.value(), query);
+            first_tag = false;
+        });
+        return true;
+    }
+    case postgres_drivers::ColumnClass::TAG:
+        if (tag_values[slot.tag_index]) {
+            PostgresTable::escape(tag_values[slot.tag_index], query);
         } else {
             query.append("\\N");
         }
-    } else if (it->column_class() == postgres_drivers::ColumnClass::OSM_ID) {
-        if (object.type() == osmium::item_type::node || object.type() == osmium::item_type::way
-                || object.type() == osmium::item_type::relation) {
-            add_osm_id(query, object.id());
-        } else if (object.type() == osmium::item_type::area
-                && static_cast<const osmium::Area&>(object).from_way()) {
-            add_osm_id(query, static_cast<const osmium::Area&>(object).orig_id());
-        } else if (object.type() == osmium::item_type::area) {
-            add_osm_id(query, -static_cast<const osmium::Area&>(object).orig_id());
-        }
-    } else if (it->column_class() == postgres_drivers::ColumnClass::VERSION) {
+        return true;
+    case postgres_drivers::ColumnClass::OSM_ID:
+        add_osm_id(query, osm_id_of(object));
+        return true;
+    case postgres_drivers::ColumnClass::VERSION:
         add_version(query, object.version());
-    } else if (it->column_class() == postgres_drivers::ColumnClass::UID) {
+        return true;
+    case postgres_drivers::ColumnClass::UID:
         add_uid(query, object.version());
-    } else if (it->column_class() == postgres_drivers::ColumnClass::USERNAME) {
+        return true;
+    case postgres_drivers::ColumnClass::USERNAME:
         add_username(query, object.user());
-    } else if (it->column_class() == postgres_drivers::ColumnClass::CHANGESET) {
+        return true;
+    case postgres_drivers::ColumnClass::CHANGESET:
         add_changeset(query, object.version());
-    } else if (it->column_class() == postgres_drivers::ColumnClass::TIMESTAMP) {
+        return true;
+    case postgres_drivers::ColumnClass::TIMESTAMP:
         add_timestamp(query, object.timestamp());
-    } else if (it->column_class() == postgres_drivers::ColumnClass::WAY_NODES
-            && object.type() == osmium::item_type::way
-            && table.config().m_driver_config.updateable) {
-        add_way_nodes(static_cast<const osmium::Way&>(object).nodes(), query);
-    } else if (it->column_class() == postgres_drivers::ColumnClass::GEOMETRY) {
+        return true;
+    case postgres_drivers::ColumnClass::WAY_NODES:
+        if (object.type() == osmium::item_type::way && table.config().m_driver_config.updateable) {
+            add_way_nodes(static_cast<const osmium::Way&>(object).nodes(), query);
+            return true;
+        }
+        break;
+    case postgres_drivers::ColumnClass::GEOMETRY:
         add_geometry(object, query, table);
-    } else if (object.type() == osmium::item_type::node && it->column_class() == postgres_drivers::ColumnClass::LATITUDE) {
-        add_int32(query, static_cast<const osmium::Node&>(object).location().y());
-    } else if (object.type() == osmium::item_type::node && it->column_class() == postgres_drivers::ColumnClass::LONGITUDE) {
-        add_int32(query, static_cast<const osmium::Node&>(object).location().x());
-    } else {
-        column_added = false;
+        return true;
+    case postgres_drivers::ColumnClass::LATITUDE:
+        if (object.type() == osmium::item_type::node) {
+            add_int32(query, static_cast<const osmium::Node&>(object).location().y());
+            return true;
+        }
+        break;
+    case postgres_drivers::ColumnClass::LONGITUDE:
+        if (object.type() == osmium::item_type::node) {
+            add_int32(query, static_cast<const osmium::Node&>(object).location().x());
+            return true;
+        }
+        break;
+    default:
+        break;
+    }
+    // Nothing written. The separator stays, the next column must not add another one.
+    return false;
+}
+
+/*static*/ bool PostgresHandler::fill_field_binary(const osmium::OSMObject& object, const ColumnPlan::Slot& slot,
+        const std::vector<const char*>& tag_values, std::string& query, PostgresTable& table,
+        const osmium::TagList* rel_tags_to_apply) {
+    switch (slot.column_class) {
+    case postgres_drivers::ColumnClass::TAGS_OTHER: {
+        size_t offset = postgres_drivers::binary::start_hstore(query);
+        size_t pair_count = 0;
+        for_each_other_tag(object, table, rel_tags_to_apply, [&query, &pair_count](const osmium::Tag& tag) {
+            postgres_drivers::binary::append_hstore_pair(query, tag.key(), tag.value());
+            ++pair_count;
+        });
+        postgres_drivers::binary::finish_hstore(query, offset, pair_count);
+        return true;
     }
-    return column_added;
+    case postgres_drivers::ColumnClass::TAG:
+        postgres_drivers::binary::append_typed_text_field(query, slot.type, tag_values[slot.tag_index]);
+        return true;
+    case postgres_drivers::ColumnClass::OSM_ID:
+        postgres_drivers::binary::append_integer_field(query, slot.type, osm_id_of(object));
+        return true;
+    case postgres_drivers::ColumnClass::VERSION:
+        postgres_drivers::binary::append_integer_field(query, slot.type, object.version());
+        return true;
+    case postgres_drivers::ColumnClass::UID:
+        // same value as written by fill_field()
+        postgres_drivers::binary::append_integer_field(query, slot.type, object.version());
+        return true;
+    case postgres_drivers::ColumnClass::USERNAME:
+        postgres_drivers::binary::append_text_field(query, object.user());
+        return true;
+    case postgres_drivers::ColumnClass::CHANGESET:
+        postgres_drivers::binary::append_integer_field(query, slot.type, object.version());
+        return true;
+    case postgres_drivers::ColumnClass::TIMESTAMP:
+        postgres_drivers::binary::append_text_field(query, object.timestamp().to_iso().c_str());
+        return true;
+    case postgres_drivers::ColumnClass::WAY_NODES:
+        if (object.type() == osmium::item_type::way && table.config().m_driver_config.updateable) {
+            const osmium::WayNodeList& nodes = static_cast<const osmium::Way&>(object).nodes();
+            size_t offset = postgres_drivers::binary::start_array(query, postgres_drivers::binary::oid_int8);
+            for (const auto& node_ref : nodes) {
+                postgres_drivers::binary::append_int64_field(query, node_ref.ref());
+            }
+            postgres_drivers::binary::finish_array(query, offset, nodes.size());
+            return true;
+        }
+        break;
+    case postgres_drivers::ColumnClass::GEOMETRY:
+        add_geometry(object, query, table);
+        return true;
+    case postgres_drivers::ColumnClass::LATITUDE:
+        if (object.type() == osmium::item_type::node) {
+            postgres_drivers::binary::append_int32_field(query, static_cast<const osmium::Node&>(object).location().y());
+            return true;
+        }
+        break;
+    case postgres_drivers::ColumnClass::LONGITUDE:
+        if (object.type() == osmium::item_type::node) {
+            postgres_drivers::binary::append_int32_field(query, static_cast<const osmium::Node&>(object).location().x());
+            return true;
+        }
+        break;
+    default:
+        break;
+    }
+    return false;
 }
 
 /*static*/ std::string PostgresHandler::prepare_query(const osmium::OSMObject& object,
         PostgresTable& table, const osmium::TagList* rel_tags_to_apply) {
     std::string query;
-    std::vector<const char*> written_keys;
-    bool column_added = false;
-    for (postgres_drivers::ColumnsConstIterator it = table.get_columns().cbegin(); it != table.get_columns().cend(); it++) {
-        column_added = fill_field(object, it, query, column_added, written_keys, table, rel_tags_to_apply);
-    }
-    query.push_back('\n');
+    prepare_query(object, table, rel_tags_to_apply, query);
     return query;
 }
 
-/*static*/ std::string PostgresHandler::prepare_node_way_query(const osmium::Way& way) {
+/*static*/ void PostgresHandler::prepare_query(const osmium::OSMObject& object,
+        PostgresTable& table, const osmium::TagList* rel_tags_to_apply, std::string& query) {
+    // reused for all objects to avoid allocations
+    static thread_local std::vector<const char*> tag_values;
+    match_tags(object, table, rel_tags_to_apply, tag_values);
+    // Rows of sorted tables are framed with their sort key.
+    const size_t frame_offset = table.sorts_rows()
+            ? postgres_drivers::sorted_row::start(query, spatial_sort_key::from_object(object)) : 0;
+    if (table.binary_copy()) {
+        postgres_drivers::binary::start_row(query, table.get_columns().size());
+        for (const ColumnPlan::Slot& slot : table.column_plan().slots()) {
+            if (!fill_field_binary(object, slot, tag_values, query, table, rel_tags_to_apply)) {
+                postgres_drivers::binary::append_null(query);
+            }
+        }
+    } else {
+        bool column_added = false;
+        for (const ColumnPlan::Slot& slot : table.column_plan().slots()) {
+            column_added = fill_field(object, slot, tag_values, query, column_added, table, rel_tags_to_apply);
+        }
+        query.push_back('\n');
+    }
+    if (table.sorts_rows()) {
+        postgres_drivers::sorted_row::finish(query, frame_offset);
+    }
+}
+
+/*static*/ std::string PostgresHandler::prepare_node_way_query(const osmium::Way& way, const bool binary) {
     std::string query;
+    prepare_node_way_query(way, query, binary);
+    return query;
+}
+
+/*static*/ void PostgresHandler::prepare_node_way_query(const osmium::Way& way, std::string& query, const bool binary) {
     for (size_t i = 0; i != way.nodes().size(); ++i) {
+        assert (i < std::numeric_limits<uint16_t>::max());
+        if (binary) {
+            postgres_drivers::binary::start_row(query, 3);
+            postgres_drivers::binary::append_int64_field(query, way.id());
+            postgres_drivers::binary::append_int64_field(query, way.nodes()[i].ref());
+            postgres_drivers::binary::append_int16_field(query, static_cast<int16_t>(i));
+            continue;
+        }
         add_osm_id(query, way.id());
         PostgresTable::add_separator_to_stringstream(query);
         add_osm_id(query, way.nodes()[i].ref());
         PostgresTable::add_separator_to_stringstream(query);
-        assert (i < std::numeric_limits<uint16_t>::max());
         add_int16(query, static_cast<int16_t>(i));
         query.push_back('\n');
     }
-    return query;
 }
 
-/*static*/ std::string PostgresHandler::prepare_relation_member_list_query(const osmium::Relation& relation, const osmium::item_type type) {
-    std::string query;
+/*static*/ void PostgresHandler::prepare_relation_member_list_query(const osmium::Relation& relation, const osmium::item_type type,
+        std::string& query, const bool binary) {
     int i = 0;
     for (auto& member : relation.members()) {
         // Skip tail of element list if there are equal or more than 2^16 - 1 members.
         if (i >= std::numeric_limits<uint16_t>::max()) {
-            return query;
+            return;
         }
-        if (member.type() == type) {
+        if (member.type() == type && binary) {
+            postgres_drivers::binary::start_row(query, 4);
+            postgres_drivers::binary::append_int64_field(query, member.ref());
+            postgres_drivers::binary::append_int64_field(query, relation.id());
+            postgres_drivers::binary::append_int16_field(query, static_cast<int16_t>(i));
+            postgres_drivers::binary::append_text_field(query, member.role());
+        } else if (member.type() == type) {
             add_osm_id(query, member.ref());
             PostgresTable::add_separator_to_stringstream(query);
             add_osm_id(query, relation.id());
@@ -278,64 +476,116 @@ const osmium::TagList* PostgresHandler::get_relation_tags_to_apply(const osmium:
         }
         ++i;
     }
+}
+
+/*static*/ std::string PostgresHandler::prepare_node_relation_query(const osmium::Relation& relation, const bool binary) {
+    std::string query;
+    prepare_relation_member_list_query(relation, osmium::item_type::node, query, binary);
+    return query;
+}
+
+/*static*/ void PostgresHandler::prepare_node_relation_query(const osmium::Relation& relation, std::string& query, const bool binary) {
+    prepare_relation_member_list_query(relation, osmium::item_type::node, query, binary);
+}
+
+/*static*/ std::string PostgresHandler::prepare_way_relation_query(const osmium::Relation& relation, const bool binary) {
+    std::string query;
+    prepare_relation_member_list_query(relation, osmium::item_type::way, query, binary);
     return query;
 }
 
-/*static*/ std::string PostgresHandler::prepare_node_relation_query(const osmium::Relation& relation) {
-    return prepare_relation_member_list_query(relation, osmium::item_type::node);
+/*static*/ void PostgresHandler::prepare_way_relation_query(const osmium::Relation& relation, std::string& query, const bool binary) {
+    prepare_relation_member_list_query(relation, osmium::item_type::way, query, binary);
 }
 
-/*static*/ std::string PostgresHandler::prepare_way_relation_query(const osmium::Relation& relation) {
-    return prepare_relation_member_list_query(relation, osmium::item_type::way);
+/*static*/ std::string PostgresHandler::prepare_relation_relation_query(const osmium::Relation& relation, const bool binary) {
+    std::string query;
+    prepare_relation_member_list_query(relation, osmium::item_type::relation, query, binary);
+    return query;
 }
 
-/*static*/ std::string PostgresHandler::prepare_relation_relation_query(const osmium::Relation& relation) {
-    return prepare_relation_member_list_query(relation, osmium::item_type::relation);
+/*static*/ void PostgresHandler::prepare_relation_relation_query(const osmium::Relation& relation, std::string& query, const bool binary) {
+    prepare_relation_member_list_query(relation, osmium::item_type::relation, query, binary);
 }
 
 /*static*/ void PostgresHandler::prepare_relation_query(const osmium::Relation& relation, std::string& query,
-        std::stringstream& multipoint_wkb, std::stringstream& multilinestring_wkb,
-        PostgresTable& table) {
-    std::vector<const char*> written_keys;
-    bool column_added = false;
-    for (postgres_drivers::ColumnsConstIterator it = table.get_columns().cbegin(); it != table.get_columns().cend(); ++it) {
-        column_added = fill_field(relation, it, query, column_added, written_keys, table, nullptr);
-        if (!column_added) {
+        const RelationGeometryBuilder& geometries, PostgresTable& table) {
+    static thread_local std::vector<const char*> tag_values;
+    match_tags(relation, table, nullptr, tag_values);
+    const size_t frame_offset = table.sorts_rows()
+            ? postgres_drivers::sorted_row::start(query, spatial_sort_key::from_box(geometries.envelope())) : 0;
+    if (table.binary_copy()) {
+        postgres_drivers::binary::start_row(query, table.get_columns().size());
+        for (const ColumnPlan::Slot& slot : table.column_plan().slots()) {
+            if (fill_field_binary(relation, slot, tag_values, query, table, nullptr)) {
+                continue;
+            }
             // special geometry columns for relations
-            if (it->column_class() == postgres_drivers::ColumnClass::GEOMETRY_MULTIPOINT) {
-                query.append("SRID=4326;");
-                query.append(multipoint_wkb.str());
-                PostgresTable::add_separator_to_stringstream(query);
-            } else if (it->column_class() == postgres_drivers::ColumnClass::GEOMETRY_MULTILINESTRING) {
-                query.append("SRID=4326;");
-                query.append(multilinestring_wkb.str());
-                PostgresTable::add_separator_to_stringstream(query);
+            if (slot.column_class == postgres_drivers::ColumnClass::GEOMETRY_MULTIPOINT) {
+                const size_t offset = postgres_drivers::binary::start_field(query);
+                geometries.append_multipoint(query, true);
+                postgres_drivers::binary::finish_field(query, offset);
+            } else if (slot.column_class == postgres_drivers::ColumnClass::GEOMETRY_MULTILINESTRING) {
+                const size_t offset = postgres_drivers::binary::start_field(query);
+                geometries.append_multilinestring(query, true);
+                postgres_drivers::binary::finish_field(query, offset);
+            } else {
+                postgres_drivers::binary::append_null(query);
+            }
+        }
+    } else {
+        bool column_added = false;
+        for (const ColumnPlan::Slot& slot : table.column_plan().slots()) {
+            column_added = fill_field(relation, slot, tag_values, query, column_added, table, nullptr);
+            if (!column_added) {
+                // special geometry columns for relations
+                if (slot.column_class == postgres_drivers::ColumnClass::GEOMETRY_MULTIPOINT) {
+                    query.append("SRID=4326;");
+                    geometries.append_multipoint(query, false);
+                    PostgresTable::add_separator_to_stringstream(query);
+                } else if (slot.column_class == postgres_drivers::ColumnClass::GEOMETRY_MULTILINESTRING) {
+                    query.append("SRID=4326;");
+                    geometries.append_multilinestring(query, false);
+                    PostgresTable::add_separator_to_stringstream(query);
+                }
             }
         }
+        query.append("\n");
+    }
+    if (table.sorts_rows()) {
+        postgres_drivers::sorted_row::finish(query, frame_offset);
     }
-    query.append("\n");
 }
 
 void PostgresHandler::handle_node(const osmium::Node& node) {
+    DirectRowSink sink;
+    handle_node(node, sink);
+}
+
+void PostgresHandler::handle_node(const osmium::Node& node, RowSink& sink) {
     if (!node.location().valid()) {
         return;
     }
     if (!m_config.m_driver_config.untagged_nodes && node.tags().empty()) {
         return;
     }
-    std::string query;
     bool with_tags = m_nodes_table.has_interesting_tags(node.tags());
     if (with_tags) {
         const osmium::TagList* rel_tags_to_apply = get_relation_tags_to_apply(node.id(), osmium::item_type::node);
-        std::string query = prepare_query(node, m_nodes_table, rel_tags_to_apply);
-        m_nodes_table.send_line(query);
+        prepare_query(node, m_nodes_table, rel_tags_to_apply, sink.buffer(m_nodes_table, node.id()));
+        sink.release(m_nodes_table);
     } else if (m_config.m_driver_config.untagged_nodes) {
-        std::string query = prepare_query(node, *m_untagged_nodes_table, nullptr);
-        m_untagged_nodes_table->send_line(query);
+        prepare_query(node, *m_untagged_nodes_table, nullptr, sink.buffer(*m_untagged_nodes_table, node.id()));
+        sink.release(*m_untagged_nodes_table);
     }
 }
 
 void PostgresHandler::handle_area(const osmium::Area& area) {
+    DirectRowSink sink;
+    handle_area(area, sink);
+}
+
+void PostgresHandler::handle_area(const osmium::Area& area, RowSink& sink) {
     if (!m_areas_table->has_interesting_tags(area.tags())) {
         return;
     }
@@ -345,6 +595,6 @@ void PostgresHandler::handle_area(const osmium::Area& area) {
     } else {
         rel_tags_to_apply = get_relation_tags_to_apply(area.orig_id(), osmium::item_type::relation);
     }
-    std::string query = prepare_query(area, *m_areas_table, rel_tags_to_apply);
-    m_areas_table->send_line(query);
+    prepare_query(area, *m_areas_table, rel_tags_to_apply, sink.buffer(*m_areas_table, 0));
+    sink.release(*m_areas_table);
 }
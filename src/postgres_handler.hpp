@@ -16,10 +16,49 @@
 #include <memory>
 #include "postgres_table.hpp"
 #include "associated_street_relation_manager.hpp"
+#include "relation_geometry_builder.hpp"
 
 #ifndef POSTGRES_HANDLER_HPP_
 #define POSTGRES_HANDLER_HPP_
 
+/**
+ * \brief Destination of the lines built for `COPY`.
+ *
+ * The handlers append the lines to the string returned by buffer() and call release()
+ * afterwards.
+ */
+class RowSink {
+public:
+    virtual ~RowSink() {}
+
+    /**
+     * Get the string to append lines for a table to.
+     *
+     * \param table table the lines belong to
+     * \param shard_key OSM ID of the object, see postgres_drivers::Table::send_line()
+     */
+    virtual std::string& buffer(PostgresTable& table, const osmium::object_id_type shard_key) = 0;
+
+    /**
+     * Finish appending to the string returned by the last call of buffer().
+     */
+    virtual void release(PostgresTable& table) = 0;
+};
+
+/**
+ * \brief Sink appending the lines directly to the COPY buffers of the tables.
+ */
+class DirectRowSink : public RowSink {
+public:
+    std::string& buffer(PostgresTable& table, const osmium::object_id_type shard_key) {
+        return table.get_copy_buffer(shard_key);
+    }
+
+    void release(PostgresTable& table) {
+        table.release_copy_buffer();
+    }
+};
+
 class PostgresHandler : public osmium::handler::Handler {
 
     /**
@@ -27,11 +66,12 @@ class PostgresHandler : public osmium::handler::Handler {
      *
      * \param relation relation to be processed
      * \param type type of interest (node, way or relation)
-     *
-     * \returns string (multiple lines) to be written to the database or an empty string if there was no
+     * \param query string where the lines will be appended to. Nothing is appended if there is no
      * member of the type of interest.
+     * \param binary encode rows in the binary format of COPY
      */
-    static std::string prepare_relation_member_list_query(const osmium::Relation& relation, const osmium::item_type type);
+    static void prepare_relation_member_list_query(const osmium::Relation& relation, const osmium::item_type type,
+            std::string& query, const bool binary);
 
 public:
     /**
@@ -71,13 +111,36 @@ public:
     static std::string prepare_query(const osmium::OSMObject& object, PostgresTable& table,
             const osmium::TagList* rel_tags_to_apply);
 
-    static std::string prepare_node_way_query(const osmium::Way& way);
+    /**
+     * \brief Append the line which will be inserted via `COPY` into the database to a string.
+     *
+     * Use this method together with PostgresTable::get_copy_buffer() to avoid temporary strings.
+     * If the table sorts its rows (see postgres_drivers::Table::sort_rows()), the line is framed
+     * with its key in spatial_sort_key.
+     *
+     * \param object OSM object
+     * \param table table to write to
+     * \param rel_tags_to_apply tags of an associatedStreet relation or nullptr
+     * \param query string to append the line to
+     */
+    static void prepare_query(const osmium::OSMObject& object, PostgresTable& table,
+            const osmium::TagList* rel_tags_to_apply, std::string& query);
+
+    static std::string prepare_node_way_query(const osmium::Way& way, const bool binary = false);
+
+    static void prepare_node_way_query(const osmium::Way& way, std::string& query, const bool binary);
+
+    static std::string prepare_node_relation_query(const osmium::Relation& relation, const bool binary = false);
 
-    static std::string prepare_node_relation_query(const osmium::Relation& relation);
+    static void prepare_node_relation_query(const osmium::Relation& relation, std::string& query, const bool binary);
 
-    static std::string prepare_way_relation_query(const osmium::Relation& relation);
+    static std::string prepare_way_relation_query(const osmium::Relation& relation, const bool binary = false);
 
-    static std::string prepare_relation_relation_query(const osmium::Relation& relation);
+    static void prepare_way_relation_query(const osmium::Relation& relation, std::string& query, const bool binary);
+
+    static std::string prepare_relation_relation_query(const osmium::Relation& relation, const bool binary = false);
+
+    static void prepare_relation_relation_query(const osmium::Relation& relation, std::string& query, const bool binary);
 
     /**
      * \brief Build the line which will be inserted via `COPY` into the database.
@@ -85,14 +148,11 @@ public:
      * \param relation Reference to the relation object
      * \param query Reference to the string where the line should be appended.
      *              It is possible that one string contains multiple lines (e.g. for buffered writing).
-     * \param multipoint_wkb string containing the value of the geom_points column as WKB HEX string
-     * \param multilinestring_wkb string containing the value of the geom_lines column as WKB HEX string
-     * \param config reference to program configuration
+     * \param geometries member geometries for the geom_points and geom_lines columns
      * \param table table to write to
      */
     static void prepare_relation_query(const osmium::Relation& relation, std::string& query,
-            std::stringstream& multipoint_wkb, std::stringstream& multilinestring_wkb,
-            PostgresTable& table);
+            const RelationGeometryBuilder& geometries, PostgresTable& table);
 
     /**
      * \brief Node handler has derived from osmium::handler::Handler.
@@ -180,10 +240,65 @@ protected:
      */
     void handle_node(const osmium::Node& node);
 
+    /**
+     * \brief Build the line of a node and append it to a sink.
+     *
+     * This method may be called by multiple threads concurrently as long as each thread uses
+     * its own sink.
+     */
+    void handle_node(const osmium::Node& node, RowSink& sink);
+
     void handle_area(const osmium::Area& area);
 
-    static bool fill_field(const osmium::OSMObject& object, postgres_drivers::ColumnsConstIterator it,
-            std::string& query, bool column_added, std::vector<const char*>& written_keys, PostgresTable& table,
+    /**
+     * \brief Build the line of an area and append it to a sink.
+     *
+     * This method may be called by multiple threads concurrently as long as each thread uses
+     * its own sink.
+     */
+    void handle_area(const osmium::Area& area, RowSink& sink);
+
+    /**
+     * \brief Look up the values of all tag columns of a table.
+     *
+     * The tags of the object and the relation are traversed only once. Tags of the object take
+     * precedence over the tags of the relation.
+     *
+     * \param object OSM object
+     * \param table table to write to
+     * \param rel_tags_to_apply tags of an associatedStreet relation or nullptr
+     * \param tag_values vector to write the values to, ordered by the tag index of the column
+     * plan of the table. Entries are nullptr if there is no tag for the column.
+     */
+    static void match_tags(const osmium::OSMObject& object, const PostgresTable& table,
+            const osmium::TagList* rel_tags_to_apply, std::vector<const char*>& tag_values);
+
+    /**
+     * \brief Append a field in the text format of COPY.
+     *
+     * \param object OSM object
+     * \param slot column to write
+     * \param tag_values values of the tag columns as returned by match_tags()
+     * \param query string to append the field to
+     * \param column_added true if a separator has to be added before the field
+     * \param table table to write to
+     * \param rel_tags_to_apply tags of an associatedStreet relation or nullptr
+     *
+     * \returns false if nothing has been written because the column is not handled by this method
+     */
+    static bool fill_field(const osmium::OSMObject& object, const ColumnPlan::Slot& slot,
+            const std::vector<const char*>& tag_values, std::string& query, bool column_added,
+            PostgresTable& table, const osmium::TagList* rel_tags_to_apply);
+
+    /**
+     * \brief Append a field in the binary format of COPY.
+     *
+     * This is the counterpart of fill_field() for tables using binary COPY.
+     *
+     * \returns false if nothing has been written because the column is not handled by this method
+     */
+    static bool fill_field_binary(const osmium::OSMObject& object, const ColumnPlan::Slot& slot,
+            const std::vector<const char*>& tag_values, std::string& query, PostgresTable& table,
             const osmium::TagList* rel_tags_to_apply);
 };
 
@@ -5,6 +5,8 @@
  *      Author: michael
  */
 
+#include <algorithm>
+#include <exception>
 #include <string.h>
 #include <sstream>
 #include <boost/iostreams/device/file.hpp>
@@ -15,6 +17,7 @@
 
 #include <array_parser.hpp>
 
+#include "escape_kernels.hpp"
 #include "item_type_conversion.hpp"
 #include "postgres_table.hpp"
 
@@ -23,8 +26,16 @@ void PostgresTable::escape4hstore(const char* source, std::string& destination)
     * taken from osm2pgsql/table.cpp, void table_t::escape4hstore(const char *src, string& dst)
     */
     destination.push_back('"');
-    for (size_t i = 0; i < strlen(source); ++i) {
-        switch (source[i]) {
+    const size_t length = strlen(source);
+    size_t i = 0;
+    while (i < length) {
+        // copy everything up to the next character which has to be escaped at once
+        const size_t next = escape_kernels::find_quoted_special(source, i, length);
+        destination.append(source + i, next - i);
+        if (next == length) {
+            break;
+        }
+        switch (source[next]) {
             case '\\':
                 destination.append("\\\\\\\\");
                 break;
@@ -40,10 +51,8 @@ void PostgresTable::escape4hstore(const char* source, std::string& destination)
             case '\n':
                 destination.append("\\\n");
                 break;
-            default:
-                destination.push_back(source[i]);
-                break;
         }
+        i = next + 1;
     }
     destination.push_back('"');
 }
@@ -52,8 +61,15 @@ void PostgresTable::escape4array(const char* source, std::string& destination) {
     /**
     * based on osm2pgsql/middle-pgsql.cpp, char *escape_tag(char *ptr, const std::string &in, bool escape)
     */
-    for (size_t i = 0; i < strlen(source); ++i) {
-        switch(source[i]) {
+    const size_t length = strlen(source);
+    size_t i = 0;
+    while (i < length) {
+        const size_t next = escape_kernels::find_quoted_special(source, i, length);
+        destination.append(source + i, next - i);
+        if (next == length) {
+            break;
+        }
+        switch(source[next]) {
             case '\\':
                 destination.append("\\\\\\\\");
                 break;
@@ -69,10 +85,8 @@ void PostgresTable::escape4array(const char* source, std::string& destination) {
             case '\t':
                 destination.append("\\\\t");
                 break;
-            default:
-                destination.push_back(source[i]);
-                break;
         }
+        i = next + 1;
     }
 }
 
@@ -84,8 +98,15 @@ void PostgresTable::escape(const char* source, std::string& destination) {
         destination.append("\\N");
         return;
     }
-    for (size_t i = 0; i < strlen(source); ++i) {
-        switch(source[i]) {
+    const size_t length = strlen(source);
+    size_t i = 0;
+    while (i < length) {
+        const size_t next = escape_kernels::find_copy_special(source, i, length);
+        destination.append(source + i, next - i);
+        if (next == length) {
+            break;
+        }
+        switch(source[next]) {
             case '\\':
                 destination.append("\\\\");
                 break;
@@ -107,22 +128,20 @@ void PostgresTable::escape(const char* source, std::string& destination) {
             case 11:
                 destination.append("\\\v");
                 break;
-            default:
-                destination.push_back(source[i]);
-                break;
         }
+        i = next + 1;
     }
 }
 
 PostgresTable::PostgresTable(postgres_drivers::Columns& columns, CerepsoConfig& config) :
         postgres_drivers::Table(columns, config.m_driver_config),
         m_program_config(config),
-        m_wkb_factory(wkbhpp::wkb_type::wkb, wkbhpp::out_type::hex) {}
+        m_column_plan(m_columns) {}
 
 PostgresTable::PostgresTable(const char* table_name, CerepsoConfig& config, postgres_drivers::Columns columns) :
         postgres_drivers::Table(table_name, config.m_driver_config, columns),
         m_program_config(config),
-        m_wkb_factory(wkbhpp::wkb_type::wkb, wkbhpp::out_type::hex) {
+        m_column_plan(m_columns) {
 }
 
 void PostgresTable::init() {
@@ -149,8 +168,25 @@ void PostgresTable::init() {
         query.push_back(')');
         send_query(query.c_str());
     }
-    create_prepared_statements();
+    if (!writes_to_files()) {
+        create_prepared_statements();
+    }
     if (!m_program_config.m_append) {
+        if (m_program_config.m_copy_shards > 1
+                && (m_columns.get_type() == postgres_drivers::TableType::POINT
+                || m_columns.get_type() == postgres_drivers::TableType::UNTAGGED_POINT
+                || m_columns.get_type() == postgres_drivers::TableType::WAYS_LINEAR
+                || m_columns.get_type() == postgres_drivers::TableType::NODE_WAYS)) {
+            open_copy_shards(m_program_config.m_copy_shards);
+        }
+        if (m_program_config.m_spatial_sort && has_geom_index()
+                && (m_columns.get_type() == postgres_drivers::TableType::POINT
+                || m_columns.get_type() == postgres_drivers::TableType::UNTAGGED_POINT
+                || m_columns.get_type() == postgres_drivers::TableType::WAYS_LINEAR
+                || m_columns.get_type() == postgres_drivers::TableType::AREA
+                || m_columns.get_type() == postgres_drivers::TableType::RELATION_OTHER)) {
+            sort_rows(m_program_config.m_sort_dir, m_program_config.m_sort_memory * 1024 * 1024);
+        }
         start_copy();
     }
     m_initialized = true;
@@ -160,8 +196,40 @@ const CerepsoConfig& PostgresTable::config() const {
     return m_program_config;
 }
 
+namespace {
+
+    /**
+     * WKB factory of a thread and the output buffer it is bound to.
+     */
+    struct ThreadWkbFactory {
+        wkbhpp::output_buffer output;
+
+        wkbhpp::full_wkb_factory<> factory;
+
+        /**
+         * \param binary EWKB as binary (binary COPY) instead of WKB as hex string (text format of COPY)
+         */
+        explicit ThreadWkbFactory(const bool binary) :
+            output(),
+            factory(binary ? wkbhpp::wkb_type::ewkb : wkbhpp::wkb_type::wkb,
+                    binary ? wkbhpp::out_type::binary : wkbhpp::out_type::hex, &output) {
+        }
+    };
+
+    ThreadWkbFactory& thread_wkb_factory(const bool binary) {
+        thread_local ThreadWkbFactory text_factory{false};
+        thread_local ThreadWkbFactory binary_factory{true};
+        return binary ? binary_factory : text_factory;
+    }
+
+} // anonymous namespace
+
 wkbhpp::full_wkb_factory<>& PostgresTable::wkb_factory() {
-    return m_wkb_factory;
+    return thread_wkb_factory(binary_copy()).factory;
+}
+
+wkbhpp::output_buffer& PostgresTable::wkb_output() {
+    return thread_wkb_factory(binary_copy()).output;
 }
 
 bool PostgresTable::has_interesting_tags(const osmium::TagList& tags) {
@@ -174,43 +242,122 @@ bool PostgresTable::has_interesting_tags(const osmium::TagList& tags) {
 }
 
 PostgresTable::~PostgresTable() {
+    if (!m_finalized) {
+        finalize();
+    }
+}
+
+void PostgresTable::end_load() {
+    if (m_loaded || !m_initialized || m_name == "") {
+        return;
+    }
+    m_loaded = true;
+    // open COPY connections are closed by destructor of superclass
+    if (m_copy_mode) {
+        end_copy();
+    }
+    if (m_begin) {
+        commit();
+    }
+}
+
+void PostgresTable::record_loaded(ImportState* state) {
+    if (!state || !m_initialized || m_name == "") {
+        return;
+    }
+    const std::string loaded = (boost::format("loaded:%1%") % m_name).str();
+    if (state->completed(loaded)) {
+        return;
+    }
+    if (m_database_connection) {
+        const std::string query = (boost::format("SELECT EXISTS (SELECT 1 FROM %1%)") % m_name).str();
+        PGresult* result = PQexec(m_database_connection, query.c_str());
+        if (PQresultStatus(result) != PGRES_TUPLES_OK) {
+            const std::string message = PQerrorMessage(m_database_connection);
+            PQclear(result);
+            throw std::runtime_error((boost::format("%1% failed: %2%\n") % query % message).str());
+        }
+        const bool contains_rows = !strcmp(PQgetvalue(result, 0, 0), "t");
+        PQclear(result);
+        if (contains_rows) {
+            state->complete((boost::format("contains rows:%1%") % m_name).str());
+        }
+    }
+    state->complete(loaded);
+    if (sorts_rows()) {
+        state->complete((boost::format("ordered:%1%") % m_name).str());
+    }
+}
+
+void PostgresTable::finalize(ImportState* state) {
+    m_finalized = true;
     if (!m_initialized) {
         return;
     }
     if (m_name != "") {
-        // open COPY connections are closed by destructor of superclass
-        if (m_copy_mode) {
-            end_copy();
-        }
-        if (m_begin) {
-            commit();
+        const auto done = [this, state](const char* step) {
+            return state && state->completed((boost::format("%1%:%2%") % step % m_name).str());
+        };
+        const auto complete = [this, state](const char* step) {
+            if (state) {
+                state->complete((boost::format("%1%:%2%") % step % m_name).str());
+            }
+        };
+        end_load();
+        record_loaded(state);
+        // Indexes of steps which did not complete might exist if the state could not be recorded.
+        const bool replace = state && state->resumed();
+        const bool geom_index = has_geom_index() && !done("geometry index");
+        const bool id_index = m_program_config.m_id_index && !m_program_config.m_append && !done("id index");
+        if (geom_index || id_index) {
+            apply_maintenance_settings();
         }
-        if (m_program_config.m_geom_indexes && !m_program_config.m_append) {
-            if (m_columns.get_type() != postgres_drivers::TableType::UNTAGGED_POINT
-                    || (m_columns.get_type() == postgres_drivers::TableType::UNTAGGED_POINT && m_program_config.m_all_geom_indexes)
-                    || m_columns.get_type() == postgres_drivers::TableType::POINT
-                    || m_columns.get_type() == postgres_drivers::TableType::WAYS_LINEAR
-                    || m_columns.get_type() == postgres_drivers::TableType::AREA) {
-                if (m_program_config.m_order_by_geohash) {
-                    order_by_geohash();
-                }
-                create_geom_index();
+        if (geom_index) {
+            // Sorted tables arrive ordered already.
+            if (m_program_config.m_order_by_geohash && !sorts_rows() && !done("ordered")) {
+                order_by_geohash();
+                complete("ordered");
             }
+            create_geom_index(replace);
+            complete("geometry index");
         }
-        if (m_program_config.m_id_index && !m_program_config.m_append) {
-            create_id_index();
+        if (id_index) {
+            create_id_index(replace);
+            complete("id index");
         }
     }
 }
 
+void PostgresTable::attach() {
+    m_initialized = true;
+}
+
+bool PostgresTable::has_geom_index() const {
+    return m_program_config.m_geom_indexes && !m_program_config.m_append
+            && (m_columns.get_type() != postgres_drivers::TableType::UNTAGGED_POINT
+                || m_program_config.m_all_geom_indexes);
+}
+
+void PostgresTable::apply_maintenance_settings() {
+    if (!m_program_config.m_maintenance_work_mem.empty()) {
+        send_query((boost::format("SET maintenance_work_mem = '%1%'") % m_program_config.m_maintenance_work_mem).str().c_str());
+    }
+    if (m_program_config.m_max_parallel_maintenance_workers >= 0) {
+        send_query((boost::format("SET max_parallel_maintenance_workers = %1%") % m_program_config.m_max_parallel_maintenance_workers).str().c_str());
+    }
+}
+
 void PostgresTable::order_by_geohash() {
-    if (!m_database_connection) {
+    if (!m_database_connection && !writes_to_files()) {
         return;
     }
     for (postgres_drivers::ColumnsIterator it = m_columns.begin(); it != m_columns.end(); it++) {
         if (static_cast<char>(it->type()) >= static_cast<char>(postgres_drivers::ColumnType::GEOMETRY)) {
            time_t ts = time(NULL);
-           std::cerr << " and ordering it by ST_Geohash …";
+           std::cerr << (boost::format("Ordering table %1% by ST_GeoHash …\n") % m_name).str();
+           // The table is replaced in a transaction. Either the original or the ordered table
+           // survives if the import is interrupted.
+           send_query("BEGIN");
            std::stringstream query;
            //TODO add ST_Transform to EPSG:4326 once pgimporter supports other coordinate systems.
            query << "CREATE TABLE " << m_name << "_tmp" <<  " AS SELECT * from " << m_name << " ORDER BY ST_GeoHash";
@@ -222,31 +369,39 @@ void PostgresTable::order_by_geohash() {
            query.str("");
            query << "ALTER TABLE " << m_name << "_tmp RENAME TO " << m_name;
            send_query(query.str().c_str());
-           std::cerr << " took " << static_cast<int>(time(NULL) - ts) << " seconds." << std::endl;
+           send_query("COMMIT");
+           std::cerr << (boost::format("Ordering table %1% by ST_GeoHash took %2% seconds.\n") % m_name
+                   % static_cast<int>(time(NULL) - ts)).str();
            break;
        }
     }
 }
 
-void PostgresTable::create_geom_index() {
-    if (!m_database_connection) {
+void PostgresTable::create_geom_index(const bool replace) {
+    if (!m_database_connection && !writes_to_files()) {
         return;
     }
     // pick out geometry column
     for (postgres_drivers::ColumnsIterator it = m_columns.begin(); it != m_columns.end(); it++) {
         if (static_cast<char>(it->type()) >= static_cast<char>(postgres_drivers::ColumnType::GEOMETRY)) {
             time_t ts = time(NULL);
-            std::cerr << "Creating geometry index on table " << m_name << ", field " << it->name() << " …";
+            std::cerr << (boost::format("Creating geometry index on table %1%, field %2% …\n") % m_name % it->name()).str();
             std::stringstream query;
+            if (replace) {
+                query << "DROP INDEX IF EXISTS " << m_name << "_index_" << it->name();
+                send_query(query.str().c_str());
+                query.str("");
+            }
             query << "CREATE INDEX " << m_name << "_index_" << it->name() << " ON " << m_name << " USING GIST (" << it->name() << ")";
             send_query(query.str().c_str());
-            std::cerr << " took " << static_cast<int>(time(NULL) - ts) << " seconds." << std::endl;
+            std::cerr << (boost::format("Creating geometry index on table %1%, field %2% took %3% seconds.\n") % m_name
+                    % it->name() % static_cast<int>(time(NULL) - ts)).str();
         }
     }
 }
 
-void PostgresTable::create_id_index() {
-    if (!m_database_connection) {
+void PostgresTable::create_id_index(const bool replace) {
+    if (!m_database_connection && !writes_to_files()) {
         return;
     }
     // pick out geometry column
@@ -257,70 +412,113 @@ void PostgresTable::create_id_index() {
                 || it->column_class() == postgres_drivers::ColumnClass::WAY_ID
                 || it->column_class() == postgres_drivers::ColumnClass::RELATION_ID) {
             time_t ts = time(NULL);
-            std::cerr << "Creating ID index on table " << m_name << ", column " << it->name() << " …";
+            std::cerr << (boost::format("Creating ID index on table %1%, column %2% …\n") % m_name % it->name()).str();
             std::stringstream query;
+            if (replace) {
+                query << "DROP INDEX IF EXISTS " << m_name << "_pkey_" << index_count;
+                send_query(query.str().c_str());
+                query.str("");
+            }
             query << "CREATE INDEX " << m_name << "_pkey_" << index_count << " ON " << m_name << " USING BTREE (\"" << it->name() << "\");";
             send_query(query.str().c_str());
-            std::cerr << " took " << static_cast<int>(time(NULL) - ts) << " seconds." << std::endl;
+            std::cerr << (boost::format("Creating ID index on table %1%, column %2% took %3% seconds.\n") % m_name
+                    % it->name() % static_cast<int>(time(NULL) - ts)).str();
             ++index_count;
         }
     }
 }
 
-void PostgresTable::delete_from_list(std::vector<osmium::object_id_type>& list) {
+namespace {
+
+    /// session-local table receiving the IDs of PostgresTable::delete_from_list
+    constexpr const char* deleted_ids_table = "cerepso_deleted_ids";
+
+    /// session-local table receiving the rows queued for PostgresTable::apply_geometry_updates
+    constexpr const char* updated_geometries_table = "cerepso_updated_geometries";
+
+    /// amount of data passed to libpq at once during COPY into a temporary table
+    constexpr size_t temporary_copy_chunk_size = 64 * 1024;
+
+} // anonymous namespace
+
+void PostgresTable::copy_to_temporary_table(const char* temporary_table, const char* definition, const std::string& data) {
+    assert(m_database_connection);
     assert(!m_copy_mode);
-    for (osmium::object_id_type id : list) {
-        PGresult *result = PQexec(m_database_connection, (boost::format("DELETE FROM %1% WHERE osm_id = %2%") % m_name % id).str().c_str());
-        if (PQresultStatus(result) != PGRES_COMMAND_OK) {
-            PQclear(result);
-            throw std::runtime_error((boost::format("%1% failed: %2%\n") % (boost::format("DELETE FROM %1% WHERE osm_id = %2%") % m_name % id).str().c_str() % PQerrorMessage(m_database_connection)).str());
+    send_query((boost::format("CREATE TEMPORARY TABLE IF NOT EXISTS %1% (%2%)") % temporary_table % definition).str().c_str());
+    send_query((boost::format("TRUNCATE %1%") % temporary_table).str().c_str());
+    const std::string copy_query = (boost::format("COPY %1% FROM STDIN") % temporary_table).str();
+    check_and_free_result(PQexec(m_database_connection, copy_query.c_str()), PGRES_COPY_IN, copy_query);
+    for (size_t offset = 0; offset < data.size(); offset += temporary_copy_chunk_size) {
+        const size_t length = std::min(temporary_copy_chunk_size, data.size() - offset);
+        if (PQputCopyData(m_database_connection, data.data() + offset, length) != 1) {
+            throw std::runtime_error((boost::format("COPY into %1% failed: %2%\n") % temporary_table
+                    % PQerrorMessage(m_database_connection)).str());
         }
+    }
+    if (PQputCopyEnd(m_database_connection, nullptr) != 1) {
+        throw std::runtime_error((boost::format("COPY into %1% failed: %2%\n") % temporary_table
+                % PQerrorMessage(m_database_connection)).str());
+    }
+    check_and_free_result(PQgetResult(m_database_connection), PGRES_COMMAND_OK, copy_query);
+    // Consume the terminating null result of the COPY command.
+    while (PGresult* result = PQgetResult(m_database_connection)) {
         PQclear(result);
     }
 }
 
-bool PostgresTable::delete_object(const osmium::object_id_type id) {
-    assert(!m_copy_mode);
-    char const *paramValues[1];
-    char buffer[64];
-    sprintf(buffer, "%ld", id);
-    paramValues[0] = buffer;
-    PGresult *result = PQexecPrepared(m_database_connection, "delete_statement", 1, paramValues, nullptr, nullptr, 0);
-    if (PQresultStatus(result) != PGRES_COMMAND_OK) {
-        PQclear(result);
-        throw std::runtime_error((boost::format("Deleting object %1% from %2% failed: %3%\n") % id % m_name % PQresultErrorMessage(result)).str());
+void PostgresTable::delete_from_list(const std::vector<osmium::object_id_type>& list, const char* column /*= "osm_id"*/) {
+    if (list.empty()) {
+        return;
     }
-    bool rows_affected = (std::strtol(PQcmdTuples(result), nullptr, 10) > 0);
-    PQclear(result);
-    return rows_affected;
+    std::string data;
+    for (const osmium::object_id_type id : list) {
+        data.append(std::to_string(id));
+        data.push_back('\n');
+    }
+    copy_to_temporary_table(deleted_ids_table, "id bigint", data);
+    send_query((boost::format("DELETE FROM %1% USING %2% WHERE %1%.\"%3%\" = %2%.id") % m_name % deleted_ids_table
+            % column).str().c_str());
 }
 
-void PostgresTable::delete_way_node_list(const osmium::object_id_type id) {
-    assert(!m_copy_mode);
-    char const *paramValues[1];
-    static char buffer[64];
-    sprintf(buffer, "%ld", id);
-    paramValues[0] = buffer;
-    PGresult *result = PQexecPrepared(m_database_connection, "delete_way_node_list", 1, paramValues, nullptr, nullptr, 0);
-    if (PQresultStatus(result) != PGRES_COMMAND_OK) {
-        PQclear(result);
-        throw std::runtime_error((boost::format("Deleting object %1% from %2% failed: %3%\n") % id % m_name % PQresultErrorMessage(result)).str());
-    }
-    PQclear(result);
+void PostgresTable::queue_geometry_update(const osmium::object_id_type id, const char* geometry) {
+    m_geometry_updates.append(std::to_string(id));
+    m_geometry_updates.push_back('\t');
+    m_geometry_updates.append(geometry);
+    m_geometry_updates.push_back('\n');
+    ++m_geometry_update_count;
 }
 
-void PostgresTable::delete_relation_members(const osmium::object_id_type id) {
-    assert(!m_copy_mode);
-    char const *paramValues[1];
-    char buffer[64];
-    sprintf(buffer, "%ld", id);
-    paramValues[0] = buffer;
-    PGresult *result = PQexecPrepared(m_database_connection, "delete_relation_members", 1, paramValues, nullptr, nullptr, 0);
-    if (PQresultStatus(result) != PGRES_COMMAND_OK) {
-        PQclear(result);
-        throw std::runtime_error((boost::format("Deleting object %1% from %2% failed: %3%\n") % id % m_name % PQresultErrorMessage(result)).str());
-    }
-    PQclear(result);
+void PostgresTable::queue_relation_member_geometry_update(const osmium::object_id_type id, const char* points,
+        const char* lines) {
+    m_geometry_updates.append(std::to_string(id));
+    m_geometry_updates.push_back('\t');
+    m_geometry_updates.append(points);
+    m_geometry_updates.push_back('\t');
+    m_geometry_updates.append(lines);
+    m_geometry_updates.push_back('\n');
+    ++m_geometry_update_count;
+}
+
+size_t PostgresTable::apply_geometry_updates() {
+    if (m_geometry_updates.empty()) {
+        return 0;
+    }
+    time_t ts = time(NULL);
+    if (m_columns.get_type() == postgres_drivers::TableType::RELATION_OTHER) {
+        copy_to_temporary_table(updated_geometries_table, "id bigint, geom_points text, geom_lines text", m_geometry_updates);
+        send_query((boost::format("UPDATE %1% SET geom_points = %2%.geom_points::geometry, geom_lines = %2%.geom_lines::geometry"
+                " FROM %2% WHERE %1%.osm_id = %2%.id") % m_name % updated_geometries_table).str().c_str());
+    } else {
+        copy_to_temporary_table(updated_geometries_table, "id bigint, geom text", m_geometry_updates);
+        send_query((boost::format("UPDATE %1% SET geom = %2%.geom::geometry FROM %2% WHERE %1%.osm_id = %2%.id")
+                % m_name % updated_geometries_table).str().c_str());
+    }
+    const size_t count = m_geometry_update_count;
+    std::cerr << (boost::format("Updated %1% geometries of %2% in %3% seconds.\n") % count % m_name
+            % static_cast<int>(time(NULL) - ts)).str();
+    m_geometry_updates.clear();
+    m_geometry_update_count = 0;
+    return count;
 }
 
 int PostgresTable::count_osm_id(const int64_t id) {
@@ -456,6 +654,175 @@ std::vector<osmium::object_id_type> PostgresTable::get_relation_ids_by_member(co
     return ids;
 }
 
+namespace {
+
+    /// maximum number of IDs sent in one array by PostgresTable::get_ids_by_array
+    constexpr size_t lookup_batch_size = 10000;
+
+} // anonymous namespace
+
+void PostgresTable::get_ids_by_array(const char* statement, const std::vector<osmium::object_id_type>& ids,
+        std::vector<osmium::object_id_type>& result) {
+    assert(m_database_connection);
+    assert(!m_copy_mode);
+    std::string array;
+    for (size_t begin = 0; begin < ids.size(); begin += lookup_batch_size) {
+        const size_t end = std::min(ids.size(), begin + lookup_batch_size);
+        array = "{";
+        for (size_t i = begin; i != end; ++i) {
+            if (i != begin) {
+                array.push_back(',');
+            }
+            array.append(std::to_string(ids[i]));
+        }
+        array.push_back('}');
+        char const *paramValues[1] = {array.c_str()};
+        PGresult *pg_result = PQexecPrepared(m_database_connection, statement, 1, paramValues, nullptr, nullptr, 0);
+        if (PQresultStatus(pg_result) != PGRES_TUPLES_OK) {
+            const std::string message = PQresultErrorMessage(pg_result);
+            PQclear(pg_result);
+            throw std::runtime_error((boost::format("Lookup of %1% IDs in %2% failed: %3%\n") % (end - begin) % m_name
+                    % message).str());
+        }
+        const int tuple_count = PQntuples(pg_result);
+        result.reserve(result.size() + tuple_count);
+        for (int i = 0; i < tuple_count; ++i) {
+            result.push_back(strtoll(PQgetvalue(pg_result, i, 0), nullptr, 10));
+        }
+        PQclear(pg_result);
+    }
+}
+
+namespace {
+
+    /// maximum number of queries sent by PostgresTable::exec_prepared_for_each before their results are read
+    constexpr size_t pipeline_depth = 256;
+
+} // anonymous namespace
+
+void PostgresTable::exec_prepared_for_each(const char* statement, const std::vector<osmium::object_id_type>& ids,
+        const std::function<void(const size_t, const PGresult*)>& handle_result) {
+    assert(m_database_connection);
+    assert(!m_copy_mode);
+    char buffer[64];
+    char const *paramValues[1] = {buffer};
+#ifdef LIBPQ_HAS_PIPELINING
+    if (PQenterPipelineMode(m_database_connection) != 1) {
+        throw std::runtime_error((boost::format("Entering pipeline mode on %1% failed: %2%\n") % m_name
+                % PQerrorMessage(m_database_connection)).str());
+    }
+    // After a failure, no more queries are sent but the results of all queries sent before are
+    // read to leave pipeline mode cleanly. Exceptions of handle_result are rethrown afterwards.
+    std::string error;
+    std::exception_ptr handler_exception;
+    for (size_t begin = 0; begin < ids.size() && error.empty() && !handler_exception; begin += pipeline_depth) {
+        const size_t end = std::min(ids.size(), begin + pipeline_depth);
+        size_t sent = begin;
+        for (; sent != end; ++sent) {
+            sprintf(buffer, "%ld", ids[sent]);
+            if (PQsendQueryPrepared(m_database_connection, statement, 1, paramValues, nullptr, nullptr, 0) != 1) {
+                error = (boost::format("Sending failed: %1%") % PQerrorMessage(m_database_connection)).str();
+                break;
+            }
+        }
+        if (PQpipelineSync(m_database_connection) != 1) {
+            // The results cannot be read without a sync point.
+            if (error.empty()) {
+                error = (boost::format("Sending failed: %1%") % PQerrorMessage(m_database_connection)).str();
+            }
+            break;
+        }
+        for (size_t i = begin; i != sent; ++i) {
+            PGresult* result = PQgetResult(m_database_connection);
+            if (PQresultStatus(result) == PGRES_TUPLES_OK) {
+                if (error.empty() && !handler_exception) {
+                    try {
+                        handle_result(i, result);
+                    } catch (...) {
+                        handler_exception = std::current_exception();
+                    }
+                }
+            } else if (error.empty()) {
+                error = result ? PQresultErrorMessage(result) : PQerrorMessage(m_database_connection);
+            }
+            PQclear(result);
+            // The result of every query in a pipeline is terminated by a null pointer.
+            while ((result = PQgetResult(m_database_connection))) {
+                PQclear(result);
+            }
+        }
+        // result of PQpipelineSync()
+        PQclear(PQgetResult(m_database_connection));
+    }
+    if (PQexitPipelineMode(m_database_connection) != 1 && error.empty()) {
+        error = PQerrorMessage(m_database_connection);
+    }
+    if (handler_exception) {
+        std::rethrow_exception(handler_exception);
+    }
+    if (!error.empty()) {
+        throw std::runtime_error((boost::format("%1% on %2% failed: %3%\n") % statement % m_name % error).str());
+    }
+#else
+    for (size_t i = 0; i != ids.size(); ++i) {
+        sprintf(buffer, "%ld", ids[i]);
+        PGresult* result = PQexecPrepared(m_database_connection, statement, 1, paramValues, nullptr, nullptr, 0);
+        if (PQresultStatus(result) != PGRES_TUPLES_OK) {
+            const std::string message = PQresultErrorMessage(result);
+            PQclear(result);
+            throw std::runtime_error((boost::format("%1% on %2% failed: %3%\n") % statement % m_name % message).str());
+        }
+        handle_result(i, result);
+        PQclear(result);
+    }
+#endif
+}
+
+std::vector<bool> PostgresTable::contains_osm_ids(const std::vector<osmium::object_id_type>& ids) {
+    std::vector<bool> found(ids.size(), false);
+    exec_prepared_for_each("count_osm_id", ids, [&found](const size_t index, const PGresult* result) {
+        found[index] = PQntuples(result) > 0;
+    });
+    return found;
+}
+
+std::vector<std::vector<MemberNode>> PostgresTable::get_way_nodes(const std::vector<osmium::object_id_type>& way_ids) {
+    std::vector<std::vector<MemberNode>> ways(way_ids.size());
+    exec_prepared_for_each("get_nodes", way_ids, [&ways](const size_t index, const PGresult* result) {
+        std::vector<MemberNode>& nodes = ways[index];
+        const int tuple_count = PQntuples(result);
+        nodes.reserve(tuple_count);
+        for (int i = 0; i < tuple_count; ++i) {
+            nodes.emplace_back(strtoll(PQgetvalue(result, i, 0), nullptr, 10), strtol(PQgetvalue(result, i, 1), nullptr, 10));
+        }
+        std::sort(nodes.begin(), nodes.end());
+    });
+    return ways;
+}
+
+void PostgresTable::get_members_by_id_and_type(std::vector<std::vector<postgres_drivers::MemberIdTypePos>>& members,
+        const std::vector<osmium::object_id_type>& ids, const osmium::item_type type) {
+    assert(members.size() == ids.size());
+    exec_prepared_for_each("get_members_by_relation_id", ids, [&members, type](const size_t index, const PGresult* result) {
+        const int tuple_count = PQntuples(result);
+        members[index].reserve(members[index].size() + tuple_count);
+        for (int i = 0; i < tuple_count; ++i) {
+            members[index].emplace_back(strtoll(PQgetvalue(result, i, 0), nullptr, 10), type,
+                    strtoll(PQgetvalue(result, i, 1), nullptr, 10));
+        }
+    });
+}
+
+void PostgresTable::get_way_ids(const std::vector<osmium::object_id_type>& node_ids,
+        std::vector<osmium::object_id_type>& way_ids) {
+    get_ids_by_array("get_way_ids_by_nodes", node_ids, way_ids);
+}
+
+void PostgresTable::get_relation_ids_by_members(const std::vector<osmium::object_id_type>& ids,
+        std::vector<osmium::object_id_type>& relation_ids) {
+    get_ids_by_array("get_relation_ids_by_members", ids, relation_ids);
+}
+
 std::vector<MemberNode> PostgresTable::get_way_nodes(const osmium::object_id_type way_id) {
     assert(m_database_connection);
     std::vector<MemberNode> nodes;
@@ -9,6 +9,7 @@
 #define POSTGRES_TABLE_HPP_
 
 #include <boost/format.hpp>
+#include <functional>
 #include <sstream>
 #include <libpq-fe.h>
 #include <osmium/osm/node_ref.hpp>
@@ -18,7 +19,9 @@
 #include <postgres_drivers/table.hpp>
 
 #include "cerepsoconfig.hpp"
+#include "column_plan.hpp"
 #include "geos_compatibility_definitions.hpp"
+#include "import_state.hpp"
 
 /**
  * ID of a member node of a way and its position in the WayNodeList
@@ -48,19 +51,47 @@ private:
     /// \brief reference to program configuration
     CerepsoConfig& m_program_config;
 
-    wkbhpp::full_wkb_factory<> m_wkb_factory;
+    /// columns of this table compiled for fast building of lines for COPY
+    ColumnPlan m_column_plan;
 
     bool m_initialized = false;
 
+    /// end_load() has been called already
+    bool m_loaded = false;
+
+    /// finalize() has been called already
+    bool m_finalized = false;
+
+    /// rows queued by queue_geometry_update() or queue_relation_member_geometry_update()
+    std::string m_geometry_updates;
+
+    /// number of rows in #m_geometry_updates
+    size_t m_geometry_update_count = 0;
+
+    /**
+     * \brief Does this table get a geometry index after the import?
+     */
+    bool has_geom_index() const;
+
+    /**
+     * \brief Set maintenance_work_mem and max_parallel_maintenance_workers for this session
+     * if they are configured.
+     */
+    void apply_maintenance_settings();
+
     /**
      * \brief Create index on geometry column.
+     *
+     * \param replace drop existing indexes of the same name before (left by an earlier run)
      */
-    void create_geom_index();
+    void create_geom_index(const bool replace);
 
     /**
      * \brief Create index on `osm_id` column.
+     *
+     * \param replace drop existing indexes of the same name before (left by an earlier run)
      */
-    void create_id_index();
+    void create_id_index(const bool replace);
 
     /**
      * \brief Order content by `ST_GeoHash(ST_ENVELOPE(geometry_column), 10) COLLATE`
@@ -78,6 +109,52 @@ private:
      */
     int get_geometry_column_id();
 
+    /**
+     * \brief Fill a temporary table of this session with data in the text format of `COPY`.
+     *
+     * The table is created if it does not exist and emptied otherwise.
+     *
+     * \param temporary_table name of the temporary table
+     * \param definition column definitions of the temporary table
+     * \param data rows to copy into the table
+     *
+     * \throws std::runtime_error
+     */
+    void copy_to_temporary_table(const char* temporary_table, const char* definition, const std::string& data);
+
+    /**
+     * \brief Execute a prepared statement with an array of IDs as its only parameter and
+     * append the IDs returned by it.
+     *
+     * The IDs are sent in batches to keep the size of the array literal reasonable.
+     *
+     * \param statement name of the prepared statement
+     * \param ids IDs to look up
+     * \param result vector to append the first column of all returned rows to
+     *
+     * \throws std::runtime_error if query execution fails
+     */
+    void get_ids_by_array(const char* statement, const std::vector<osmium::object_id_type>& ids,
+            std::vector<osmium::object_id_type>& result);
+
+    /**
+     * \brief Execute a prepared statement with an ID as its only parameter once for each of the
+     * given IDs.
+     *
+     * If libpq supports pipeline mode (libpq 14 or newer), the queries are sent in pipelines
+     * without waiting for the result of each query. Otherwise they are executed one after another.
+     *
+     * \param statement name of the prepared statement
+     * \param ids IDs to execute the statement for
+     * \param handle_result function called with the index of the ID and the result of its query,
+     * in the order of the IDs. The result is freed afterwards. If it throws, no more queries are
+     * sent and the exception is rethrown after pipeline mode has been left.
+     *
+     * \throws std::runtime_error if query execution fails
+     */
+    void exec_prepared_for_each(const char* statement, const std::vector<osmium::object_id_type>& ids,
+            const std::function<void(const size_t, const PGresult*)>& handle_result);
+
 public:
     PostgresTable() = delete;
 
@@ -91,17 +168,86 @@ public:
      */
     PostgresTable(postgres_drivers::Columns& columns, CerepsoConfig& config);
 
+    /**
+     * Calls finalize() unless this has been done already.
+     */
     ~PostgresTable();
 
+    /**
+     * \brief End loading data into this table.
+     *
+     * End COPY (this sends the sorted rows if the rows are sorted before COPY) and commit. The
+     * table can end loading concurrently to other tables because every table uses its own
+     * database connection.
+     *
+     * \throws std::runtime_error
+     */
+    void end_load();
+
+    /**
+     * \brief Record that loading data into this table has completed.
+     *
+     * Call end_load() before. Call this for all tables before any table is finalized. Otherwise a
+     * crash while a large table is being indexed leaves the other tables without a record of
+     * their completed COPY and a resumed import would have to start again.
+     *
+     * \param state The phase `loaded:TABLE` is recorded unless it is recorded already. If the
+     * table contains rows, `contains rows:TABLE` is recorded before. ImportState::resume() uses it
+     * to detect that the unlogged table has been emptied by the crash recovery of the database.
+     * Nothing is done if state is nullptr.
+     *
+     * \throws std::runtime_error
+     */
+    void record_loaded(ImportState* state);
+
+    /**
+     * \brief Finish the import into this table.
+     *
+     * Call end_load() and record_loaded() if this has not been done yet, then order the table by
+     * geohash and create the indexes as configured. The table can be finalized concurrently to other tables because
+     * every table uses its own database connection. Afterwards the table must not be used any more.
+     *
+     * \param state If set, every step is recorded as a phase of the import
+     * (`loaded:TABLE`, `ordered:TABLE`, `geometry index:TABLE`, `id index:TABLE`) and steps
+     * completed by an earlier run are skipped.
+     *
+     * \throws std::runtime_error
+     */
+    void finalize(ImportState* state = nullptr);
+
     /**
      * Initialize table (create it in the database).
      */
     void init();
 
+    /**
+     * Use the table loaded by an earlier run of a resumed import. It is neither created nor
+     * filled but finalized.
+     */
+    void attach();
+
     const CerepsoConfig& config() const;
 
+    /**
+     * \brief WKB factory writing geometries in the format expected by this table.
+     *
+     * The factory keeps intermediate state while building a geometry. Therefore every thread
+     * gets its own factory.
+     */
     wkbhpp::full_wkb_factory<>& wkb_factory();
 
+    /**
+     * \brief Output buffer of the WKB factory of the calling thread.
+     *
+     * Use it together with wkbhpp::output_scope to let the factory append geometries to
+     * a string (e.g. the COPY buffer) instead of returning them.
+     */
+    wkbhpp::output_buffer& wkb_output();
+
+    const ColumnPlan& column_plan() const noexcept {
+        return m_column_plan;
+    }
+
     bool has_interesting_tags(const osmium::TagList& tags);
 
     /**
@@ -149,48 +295,15 @@ public:
     /**
      * \brief delete (try it) all objects with the given OSM object IDs
      *
-     * This method will execute a `DELETE` command for each entry in this list.
+     * The IDs are sent via `COPY` into the temporary table `cerepso_deleted_ids` of the session
+     * and deleted using a single `DELETE … USING` command.
      *
      * \param list list of OSM object IDs to be deleted
+     * \param column column containing the IDs, e.g. `way_id` for the node list of ways
      *
      * \throws std::runtime_error
      */
-    void delete_from_list(std::vector<osmium::object_id_type>& list);
-
-    /**
-     * \brief delete object with given ID
-     *
-     * This method executes the prepared statement `delete_statement`.
-     *
-     * \param id ID of the object
-     *
-     * \return true if number of affected lines is greater than zero
-     *
-     * \throws std::runtime_error
-     */
-    bool delete_object(const osmium::object_id_type id);
-
-    /**
-     * \brief delete member node list of a way
-     *
-     * This method executes the prepared statement `delete_way_node_list`.
-     *
-     * \param id way ID
-     *
-     * \throws std::runtime_error
-     */
-    void delete_way_node_list(const osmium::object_id_type id);
-
-    /**
-     * \brief delete list of member nodes/ways/relations of a relation
-     *
-     * This method executes the prepared statement `delete_relation_members`.
-     *
-     * \param id way ID
-     *
-     * \throws std::runtime_error
-     */
-    void delete_relation_members(const osmium::object_id_type id);
+    void delete_from_list(const std::vector<osmium::object_id_type>& list, const char* column = "osm_id");
 
     /**
      * \brief Count how often a given OSM ID is present in the table.
@@ -203,6 +316,17 @@ public:
      */
     int count_osm_id(const int64_t id);
 
+    /**
+     * \brief Check presence of multiple OSM IDs in the table.
+     *
+     * The queries are pipelined if libpq supports it.
+     *
+     * \param ids OSM IDs (should be negative for areas derived from relations if searching the areas table)
+     * \throws std::runtime_error If SQL query execution fails.
+     * \returns vector with an entry for each ID, true if the ID is present
+     */
+    std::vector<bool> contains_osm_ids(const std::vector<osmium::object_id_type>& ids);
+
     /**
      * \brief get the longitude and latitude of a node
      *
@@ -240,6 +364,31 @@ public:
      */
     std::vector<osmium::object_id_type> get_relation_ids_by_member(const osmium::object_id_type id);
 
+    /**
+     * \brief Get ways using any of the given nodes.
+     *
+     * This method needs one query for thousands of nodes.
+     *
+     * \param node_ids OSM node IDs
+     * \param way_ids vector to append the IDs of the ways to, a way using nodes of different
+     * batches may be appended more than once
+     * \throws std::runtime_error if query execution fails
+     */
+    void get_way_ids(const std::vector<osmium::object_id_type>& node_ids, std::vector<osmium::object_id_type>& way_ids);
+
+    /**
+     * \brief Get relations using any of the given nodes or ways.
+     *
+     * This method needs one query for thousands of members.
+     *
+     * \param ids OSM node/way/relation IDs
+     * \param relation_ids vector to append the IDs of the relations to, a relation may be
+     * appended more than once
+     * \throws std::runtime_error if query execution fails
+     */
+    void get_relation_ids_by_members(const std::vector<osmium::object_id_type>& ids,
+            std::vector<osmium::object_id_type>& relation_ids);
+
     /**
      * \brief Get member nodes of a way.
      *
@@ -250,6 +399,17 @@ public:
     //TODO check if MemberNode is really necessary or a vector of osmium::object_id_type is sufficient
     std::vector<MemberNode> get_way_nodes(const osmium::object_id_type way_id);
 
+    /**
+     * \brief Get member nodes of multiple ways.
+     *
+     * The queries are pipelined if libpq supports it.
+     *
+     * \param way_ids OSM way IDs
+     * \throws std::runtime_error if query execution fails
+     * \returns vector with the node IDs of each way sorted by position (empty vector if none was found)
+     */
+    std::vector<std::vector<MemberNode>> get_way_nodes(const std::vector<osmium::object_id_type>& way_ids);
+
     /**
      * \brief Get members of a relation by relation ID and type.
      *
@@ -260,6 +420,19 @@ public:
     void get_members_by_id_and_type(std::vector<postgres_drivers::MemberIdTypePos>& members,
             const osmium::object_id_type id, const osmium::item_type type);
 
+    /**
+     * \brief Get members of multiple relations by relation ID and type.
+     *
+     * The queries are pipelined if libpq supports it.
+     *
+     * \param members vector with an entry for each relation, the members are appended to it
+     * \param ids relation IDs
+     * \param type OSM object type
+     * \throws std::runtime_error if query execution fails
+     */
+    void get_members_by_id_and_type(std::vector<std::vector<postgres_drivers::MemberIdTypePos>>& members,
+            const std::vector<osmium::object_id_type>& ids, const osmium::item_type type);
+
     /**
      * \brief Update geometry of an entry.
      *
@@ -278,6 +451,40 @@ public:
      * \throws std::runtime_error if query execution fails
      */
     void update_relation_member_geometry(const osmium::object_id_type id, const char* points, const char* lines);
+
+    /**
+     * \brief Queue an update of the geometry of an entry.
+     *
+     * The update is sent to the database by apply_geometry_updates(). Don't queue
+     * an object twice before calling it.
+     *
+     * \param id OSM object ID (column osm_id)
+     * \param geometry WKB string
+     */
+    void queue_geometry_update(const osmium::object_id_type id, const char* geometry);
+
+    /**
+     * \brief Queue an update of the geometry collection of point and line members of a relation.
+     *
+     * The update is sent to the database by apply_geometry_updates(). Don't queue
+     * a relation twice before calling it.
+     *
+     * \param id OSM object ID (column osm_id)
+     * \param points MultiPoint WKB string
+     * \param lines MultiLineString WKB string
+     */
+    void queue_relation_member_geometry_update(const osmium::object_id_type id, const char* points, const char* lines);
+
+    /**
+     * \brief Send all queued geometry updates to the database.
+     *
+     * The geometries are sent via `COPY` into the temporary table `cerepso_updated_geometries`
+     * of the session and written by a single `UPDATE … FROM` command.
+     *
+     * \returns number of updates sent
+     * \throws std::runtime_error if query execution fails
+     */
+    size_t apply_geometry_updates();
 };
 
 
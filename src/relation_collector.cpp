@@ -11,13 +11,7 @@
 RelationCollector::RelationCollector(CerepsoConfig& config,  postgres_drivers::Columns& node_columns) :
     m_config(config),
     m_output_buffer(initial_output_buffer_size, osmium::memory::Buffer::auto_grow::yes),
-    m_database_table("relations", config, node_columns),
-#ifdef GEOS_36
-    m_geos_geom_factory(geos::geom::GeometryFactory::create().release(), GEOSGeometryFactoryDeleter())
-#else
-    m_geos_geom_factory(new geos::geom::GeometryFactory{})
-#endif
-    {
+    m_database_table("relations", config, node_columns) {
     m_database_table.init();
 }
 
@@ -40,8 +34,7 @@ void RelationCollector::process_relation(const osmium::Relation& relation) {
 }
 
 void RelationCollector::build_relation_query(const osmium::Relation& relation, std::string& query) {
-    std::vector<geos::geom::Geometry*>* points = new std::vector<geos::geom::Geometry*>();
-    std::vector<geos::geom::Geometry*>* linestrings = new std::vector<geos::geom::Geometry*>();
+    m_geometry_builder.clear();
     for (const auto& member : relation.members()) {
         // get the offset and check the availability, needs libosmium >= 2.10.2
         if (member.ref() == 0) {
@@ -50,13 +43,11 @@ void RelationCollector::build_relation_query(const osmium::Relation& relation, s
         }
         if ((member.type() == osmium::item_type::way)) {
             const osmium::Way* way = this->get_member_way(member.ref());
-            std::unique_ptr<geos::geom::LineString> linestring = m_geos_factory.create_linestring(*way);
-            linestrings->push_back(linestring.release());
+            add_way_member(way->id(), way->nodes().begin(), way->nodes().end());
         }
         else if ((member.type() == osmium::item_type::node)) {
             const osmium::Node* node = this->get_member_node(member.ref());
-            std::unique_ptr<geos::geom::Point> point = m_geos_factory.create_point(*node);
-            points->push_back(point.release());
+            m_geometry_builder.add_point(node->location());
         }
         else if ((member.type() == osmium::item_type::relation)) {
 //                osmium::Relation& relation =this->get_member_relation(available_and_offset.second);
@@ -64,23 +55,72 @@ void RelationCollector::build_relation_query(const osmium::Relation& relation, s
             // TODO support one level of nested relations
         }
     }
-    // create GeometryCollection
-    geos::geom::MultiPoint* multipoints = m_geos_geom_factory->createMultiPoint(points);
-    geos::geom::MultiLineString* multilinestrings = m_geos_geom_factory->createMultiLineString(linestrings);
-    // add multipoint to query
-    // convert to WKB
-    // We need a stringstream because writeHEX() needs a stringstream
-    std::stringstream multipoint_stream;
-    m_geos_wkb_writer.writeHEX(*multipoints, multipoint_stream);
-    // add multilinestring to query
-    // convert to WKB
-    std::stringstream multilinestring_stream;
-    m_geos_wkb_writer.writeHEX(*multilinestrings, multilinestring_stream);
-    PostgresHandler::prepare_relation_query(relation, query, multipoint_stream, multilinestring_stream, m_database_table);
-    delete multipoints;
-    delete multilinestrings;
+    PostgresHandler::prepare_relation_query(relation, query, m_geometry_builder, m_database_table);
+}
+
+void RelationCollector::process_relation(const osmium::Relation& relation, const index_type& location_index,
+        const WayNodeStore& ways) {
+    std::string query;
+    try {
+        build_relation_query(relation, query, location_index, ways);
+        m_database_table.send_line(query);
+    } catch (osmium::geometry_error& e) {
+        std::cerr << e.what() << "\n";
+    }
+}
+
+void RelationCollector::build_relation_query(const osmium::Relation& relation, std::string& query,
+        const index_type& location_index, const WayNodeStore& ways) {
+    m_geometry_builder.clear();
+    for (const auto& member : relation.members()) {
+        if (member.type() == osmium::item_type::way) {
+            WayNodeStore::Range locations = ways.get(member.ref());
+            if (locations.empty()) {
+                // way is not available in the input OSM file
+                continue;
+            }
+            add_way_member(member.ref(), locations.begin(), locations.end());
+        } else if (member.type() == osmium::item_type::node) {
+            const osmium::Location location = location_index.get_noexcept(static_cast<osmium::unsigned_object_id_type>(member.ref()));
+            if (!location.valid()) {
+                // node is not available in the input OSM file
+                continue;
+            }
+            m_geometry_builder.add_point(location);
+        }
+        // Nested relations do not contribute to the geometry, see build_relation_query() above.
+    }
+    PostgresHandler::prepare_relation_query(relation, query, m_geometry_builder, m_database_table);
 }
 
 void RelationCollector::complete_relation(const osmium::Relation& relation) {
     process_relation(relation);
 }
+
+void SinglePassRelationHandler::check_order(const char* type, const osmium::object_id_type id) const {
+    if (m_relations_started) {
+        throw std::runtime_error{(boost::format("%1% %2% follows a relation. The input file has to be ordered by "
+                "type (nodes, ways, relations) if --single-pass is used.\n") % type % id).str()};
+    }
+}
+
+void SinglePassRelationHandler::node(const osmium::Node& node) {
+    check_order("Node", node.id());
+}
+
+void SinglePassRelationHandler::way(const osmium::Way& way) {
+    check_order("Way", way.id());
+    m_ways.add(way);
+}
+
+void SinglePassRelationHandler::relation(const osmium::Relation& relation) {
+    if (!m_relations_started) {
+        m_relations_started = true;
+        m_ways.prepare_for_lookup();
+        if (m_ways.empty()) {
+            // The location handler sorts the index when it reads the first way.
+            m_location_index.sort();
+        }
+    }
+    m_collector.process_relation(relation, m_location_index, m_ways);
+}
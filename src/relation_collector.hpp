@@ -8,8 +8,7 @@
 #ifndef RELATION_COLLECTOR_HPP_
 #define RELATION_COLLECTOR_HPP_
 
-#include <geos/io/WKBWriter.h>
-#include <osmium_geos_factory/geos_factory.hpp>
+#include <osmium/geom/factory.hpp>
 #include <osmium/memory/buffer.hpp>
 #include <osmium/osm/item_type.hpp>
 #include <osmium/osm/relation.hpp>
@@ -18,9 +17,11 @@
 #include <osmium/relations/relations_manager.hpp>
 #include <osmium/area/assembler.hpp>
 #include <osmium/relations/detail/member_meta.hpp>
-#include "geos_compatibility_definitions.hpp"
+#include "definitions.hpp"
 #include "import_handler.hpp"
 #include "postgres_table.hpp"
+#include "relation_geometry_builder.hpp"
+#include "way_node_store.hpp"
 
 /**
  * \brief The RelationCollector collects all relations.
@@ -41,9 +42,8 @@ private:
 
     /// \brief database connection for the relations table
     PostgresTable m_database_table;
-    osmium_geos_factory::GEOSFactory<> m_geos_factory;
-    geos_factory_type m_geos_geom_factory;
-    geos::io::WKBWriter m_geos_wkb_writer;
+    /// builder of the geometry columns, reused for all relations
+    RelationGeometryBuilder m_geometry_builder;
     static constexpr size_t initial_output_buffer_size = 1024 * 1024;
     static constexpr size_t max_buffer_size_for_flush = 100 * 1024;
 
@@ -80,6 +80,27 @@ private:
      */
     void build_relation_query(const osmium::Relation& relation, std::string& query);
 
+    /**
+     * \brief Build the query string of a relation using the location index and a way node store
+     * instead of the members collected by this relation manager.
+     *
+     * \throws osmium::geometry_error
+     */
+    void build_relation_query(const osmium::Relation& relation, std::string& query,
+            const index_type& location_index, const WayNodeStore& ways);
+
+    /**
+     * \brief Add the linestring of a member way to the geometry builder.
+     *
+     * \throws osmium::geometry_error if the way has less than two distinct locations
+     */
+    template <typename TIter>
+    void add_way_member(const osmium::object_id_type way_id, TIter begin, TIter end) {
+        if (m_geometry_builder.add_unique_linestring(begin, end) < 2) {
+            throw osmium::geometry_error{"need at least two points for linestring", "way", way_id};
+        }
+    }
+
 public:
 
     RelationCollector() = delete;
@@ -112,6 +133,13 @@ public:
      */
     void complete_relation(const osmium::Relation& relation);
 
+    /**
+     * \brief Table the relations are written to.
+     */
+    PostgresTable& table() noexcept {
+        return m_database_table;
+    }
+
     /**
      * \brief Process incomplete relations (some members missing).
      *
@@ -125,8 +153,58 @@ public:
      * \todo change to new RelationManager
      */
     void handle_incomplete_relations();
+
+    /**
+     * \brief Insert a relation into the database without collecting its members first.
+     *
+     * This is used by the single-pass import. The relation has to be read after all nodes and
+     * ways. Members which are neither in the location index nor in the way node store are
+     * skipped.
+     *
+     * \param relation relation to insert
+     * \param location_index locations of all nodes
+     * \param ways node locations of all ways, WayNodeStore::prepare_for_lookup() has to be called
+     * before
+     */
+    void process_relation(const osmium::Relation& relation, const index_type& location_index,
+            const WayNodeStore& ways);
 };
 
 
 
+/**
+ * \brief Handler inserting relations during the single-pass import.
+ *
+ * It stores the node locations of all ways. Relations are inserted as soon as they are read
+ * using the location index and the stored ways. Therefore the input file has to be ordered by
+ * type (nodes, ways, relations). The location handler has to be applied before this handler.
+ */
+class SinglePassRelationHandler : public osmium::handler::Handler {
+    RelationCollector& m_collector;
+
+    index_type& m_location_index;
+
+    WayNodeStore m_ways;
+
+    /// set to true if the first relation has been read
+    bool m_relations_started = false;
+
+    /**
+     * \throws std::runtime_error if a relation has been read already
+     */
+    void check_order(const char* type, const osmium::object_id_type id) const;
+
+public:
+    SinglePassRelationHandler(RelationCollector& collector, index_type& location_index) :
+        m_collector(collector),
+        m_location_index(location_index) {
+    }
+
+    void node(const osmium::Node& node);
+
+    void way(const osmium::Way& way);
+
+    void relation(const osmium::Relation& relation);
+};
+
 #endif /* RELATION_COLLECTOR_HPP_ */
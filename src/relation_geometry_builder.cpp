@@ -0,0 +1,116 @@
+/*
+ * relation_geometry_builder.cpp
+ *
+ *  Created on:  2026-10-17
+ *      Author: Michael Reichert <michael.reichert@geofabrik.de>
+ */
+
+#include <cstring>
+#include <wkbhpp/wkbwriter.hpp>
+#include "relation_geometry_builder.hpp"
+
+namespace {
+
+    constexpr uint32_t wkb_point = 1;
+    constexpr uint32_t wkb_linestring = 2;
+    constexpr uint32_t wkb_multipoint = 4;
+    constexpr uint32_t wkb_multilinestring = 5;
+    constexpr uint32_t wkb_srid_flag = 0x20000000;
+    constexpr int32_t srid = 4326;
+
+    void append_byte_order(std::string& out) {
+#if __BYTE_ORDER == __LITTLE_ENDIAN
+        out.push_back(1);
+#else
+        out.push_back(0);
+#endif
+    }
+
+    void append_location(std::string& out, const osmium::Location& location) {
+        wkbhpp::str_push(out, location.lon());
+        wkbhpp::str_push(out, location.lat());
+    }
+
+} // anonymous namespace
+
+void RelationGeometryBuilder::clear() {
+    m_points.clear();
+    m_linestrings.clear();
+    m_point_count = 0;
+    m_linestring_count = 0;
+    m_envelope = osmium::Box{};
+}
+
+void RelationGeometryBuilder::add_point(const osmium::Location& location) {
+    append_byte_order(m_points);
+    wkbhpp::str_push(m_points, wkb_point);
+    append_location(m_points, location);
+    m_envelope.extend(location);
+    ++m_point_count;
+}
+
+void RelationGeometryBuilder::linestring_start() {
+    m_linestring_offset = m_linestrings.size();
+    m_linestring_points = 0;
+    m_last_location = osmium::Location{};
+    m_linestring_envelope = osmium::Box{};
+    append_byte_order(m_linestrings);
+    wkbhpp::str_push(m_linestrings, wkb_linestring);
+    // number of points, set by linestring_finish()
+    wkbhpp::str_push(m_linestrings, static_cast<uint32_t>(0));
+}
+
+void RelationGeometryBuilder::linestring_add_location(const osmium::Location& location, const bool unique) {
+    if (unique && m_linestring_points > 0 && location == m_last_location) {
+        return;
+    }
+    append_location(m_linestrings, location);
+    m_linestring_envelope.extend(location);
+    m_last_location = location;
+    ++m_linestring_points;
+}
+
+uint32_t RelationGeometryBuilder::linestring_finish() {
+    if (m_linestring_points < 2) {
+        const uint32_t points = m_linestring_points;
+        linestring_discard();
+        return points;
+    }
+    std::memcpy(&m_linestrings[m_linestring_offset + 1 + sizeof(uint32_t)], &m_linestring_points, sizeof(uint32_t));
+    m_envelope.extend(m_linestring_envelope);
+    ++m_linestring_count;
+    return m_linestring_points;
+}
+
+void RelationGeometryBuilder::linestring_discard() {
+    m_linestrings.resize(m_linestring_offset);
+    m_linestring_points = 0;
+}
+
+void RelationGeometryBuilder::append_collection(std::string& out, const uint32_t type, const uint32_t count,
+        const std::string& members, const bool binary) const {
+    std::string header;
+    append_byte_order(header);
+    if (binary) {
+        wkbhpp::str_push(header, type | wkb_srid_flag);
+        wkbhpp::str_push(header, srid);
+    } else {
+        wkbhpp::str_push(header, type);
+    }
+    wkbhpp::str_push(header, count);
+    if (binary) {
+        out.append(header);
+        out.append(members);
+    } else {
+        wkbhpp::append_hex(out, header.data(), header.size());
+        wkbhpp::append_hex(out, members.data(), members.size());
+    }
+}
+
+void RelationGeometryBuilder::append_multipoint(std::string& out, const bool binary) const {
+    append_collection(out, wkb_multipoint, m_point_count, m_points, binary);
+}
+
+void RelationGeometryBuilder::append_multilinestring(std::string& out, const bool binary) const {
+    append_collection(out, wkb_multilinestring, m_linestring_count, m_linestrings, binary);
+}
@@ -0,0 +1,137 @@
+/*
+ * relation_geometry_builder.hpp
+ *
+ *  Created on:  2026-10-17
+ *      Author: Michael Reichert <michael.reichert@geofabrik.de>
+ */
+
+#ifndef SRC_RELATION_GEOMETRY_BUILDER_HPP_
+#define SRC_RELATION_GEOMETRY_BUILDER_HPP_
+
+#include <cstdint>
+#include <string>
+
+#include <osmium/osm/box.hpp>
+#include <osmium/osm/location.hpp>
+
+/**
+ * \brief Builder for the geometry columns of the relations table.
+ *
+ * The geom_points column contains a MultiPoint of all member nodes and the geom_lines column
+ * a MultiLineString of all member ways. The builder writes the WKB of the members directly
+ * while the members are added. No geometry objects are allocated, the buffers are reused for
+ * the next relation after clear() has been called.
+ *
+ * The output is identical to GEOS' WKBWriter (machine byte order, 2D): hex encoded WKB or EWKB
+ * with SRID 4326 for the binary format of COPY.
+ */
+class RelationGeometryBuilder {
+
+    /// points of the MultiPoint, without the header of the MultiPoint
+    std::string m_points;
+
+    /// linestrings of the MultiLineString, without the header of the MultiLineString
+    std::string m_linestrings;
+
+    uint32_t m_point_count = 0;
+
+    uint32_t m_linestring_count = 0;
+
+    /// offset of the linestring which is being built in m_linestrings
+    size_t m_linestring_offset = 0;
+
+    uint32_t m_linestring_points = 0;
+
+    /// last location added to the linestring which is being built
+    osmium::Location m_last_location;
+
+    /// bounding box of all points and finished linestrings
+    osmium::Box m_envelope;
+
+    /// bounding box of the linestring which is being built
+    osmium::Box m_linestring_envelope;
+
+    void append_collection(std::string& out, const uint32_t type, const uint32_t count,
+            const std::string& members, const bool binary) const;
+
+public:
+    /**
+     * Remove all members.
+     */
+    void clear();
+
+    void add_point(const osmium::Location& location);
+
+    void linestring_start();
+
+    /**
+     * Add a location to the linestring which is being built.
+     *
+     * \param location location to add
+     * \param unique skip the location if it is equal to the last one
+     */
+    void linestring_add_location(const osmium::Location& location, const bool unique = false);
+
+    /**
+     * Finish the linestring. Linestrings with less than two points are removed again.
+     *
+     * \returns number of points of the linestring
+     */
+    uint32_t linestring_finish();
+
+    /**
+     * Remove the linestring which is being built.
+     */
+    void linestring_discard();
+
+    /**
+     * Add a linestring skipping duplicated consecutive locations.
+     *
+     * \param begin iterator to the first element, the elements have to provide a
+     * location() method (e.g. osmium::NodeRef)
+     * \param end end iterator
+     *
+     * \returns number of points of the linestring, it has not been added if it is less than 2
+     */
+    template <typename TIter>
+    uint32_t add_unique_linestring(TIter begin, TIter end) {
+        linestring_start();
+        for (; begin != end; ++begin) {
+            linestring_add_location(begin->location(), true);
+        }
+        return linestring_finish();
+    }
+
+    uint32_t point_count() const noexcept {
+        return m_point_count;
+    }
+
+    uint32_t linestring_count() const noexcept {
+        return m_linestring_count;
+    }
+
+    /**
+     * Bounding box of all points and linestrings added, invalid if there are none.
+     */
+    const osmium::Box& envelope() const noexcept {
+        return m_envelope;
+    }
+
+    /**
+     * Append the MultiPoint of all points added.
+     *
+     * \param out string to append to
+     * \param binary append EWKB (with SRID) instead of WKB as hex string
+     */
+    void append_multipoint(std::string& out, const bool binary) const;
+
+    /**
+     * Append the MultiLineString of all linestrings added.
+     *
+     * \param out string to append to
+     * \param binary append EWKB (with SRID) instead of WKB as hex string
+     */
+    void append_multilinestring(std::string& out, const bool binary) const;
+};
+
+#endif /* SRC_RELATION_GEOMETRY_BUILDER_HPP_ */
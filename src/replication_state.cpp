@@ -0,0 +1,126 @@
+/*
+ * replication_state.cpp
+ *
+ *  Created on:  2026-10-17
+ *      Author: Michael Reichert <michael.reichert@geofabrik.de>
+ */
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#include <boost/format.hpp>
+
+#include "replication_state.hpp"
+
+namespace {
+
+    /// name of the table in the target database
+    constexpr const char* table_name = "cerepso_replication_state";
+
+    /// key of the sequence number in state.txt
+    constexpr const char* sequence_key = "sequenceNumber=";
+
+} // anonymous namespace
+
+ReplicationState::ReplicationState(const std::string& directory, const std::string& database_name) :
+    m_directory(directory),
+    m_connection(nullptr) {
+    const std::string connection_params = "dbname=" + database_name;
+    m_connection = PQconnectdb(connection_params.c_str());
+    if (PQstatus(m_connection) != CONNECTION_OK) {
+        const std::string message = PQerrorMessage(m_connection);
+        PQfinish(m_connection);
+        m_connection = nullptr;
+        throw std::runtime_error((boost::format("Cannot establish connection to database: %1%\n") % message).str());
+    }
+    execute((boost::format("CREATE TABLE IF NOT EXISTS %1% (id boolean PRIMARY KEY DEFAULT true CHECK (id), "
+            "sequence_number bigint NOT NULL, in_progress bigint, applied timestamp with time zone DEFAULT now())")
+            % table_name).str().c_str());
+}
+
+ReplicationState::~ReplicationState() {
+    if (m_connection) {
+        PQfinish(m_connection);
+    }
+}
+
+void ReplicationState::execute(const char* query) {
+    PGresult* result = PQexec(m_connection, query);
+    if (PQresultStatus(result) != PGRES_COMMAND_OK) {
+        const std::string message = PQerrorMessage(m_connection);
+        PQclear(result);
+        throw std::runtime_error((boost::format("%1% failed: %2%\n") % query % message).str());
+    }
+    PQclear(result);
+}
+
+/*static*/ int64_t ReplicationState::parse_state_file(std::istream& in) {
+    const size_t key_length = strlen(sequence_key);
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.compare(0, key_length, sequence_key) != 0) {
+            continue;
+        }
+        const char* value = line.c_str() + key_length;
+        char* end;
+        errno = 0;
+        const long long sequence_number = strtoll(value, &end, 10);
+        if (end == value || (*end != '\0' && *end != '\r') || errno || sequence_number < 0) {
+            throw std::runtime_error((boost::format("Invalid sequence number in state file: %1%\n") % line).str());
+        }
+        return sequence_number;
+    }
+    throw std::runtime_error("State file contains no sequence number.\n");
+}
+
+/*static*/ std::string ReplicationState::diff_file(const std::string& directory, const int64_t sequence_number) {
+    return (boost::format("%s/%03d/%03d/%03d.osc.gz") % directory % (sequence_number / 1000000)
+            % (sequence_number / 1000 % 1000) % (sequence_number % 1000)).str();
+}
+
+int64_t ReplicationState::latest_available() const {
+    const std::string filename = m_directory + "/state.txt";
+    std::ifstream file{filename};
+    if (!file) {
+        throw std::runtime_error((boost::format("Cannot open %1%: %2%\n") % filename % strerror(errno)).str());
+    }
+    return parse_state_file(file);
+}
+
+int64_t ReplicationState::query_sequence_number(const char* column) {
+    const std::string query = (boost::format("SELECT %1% FROM %2%") % column % table_name).str();
+    PGresult* result = PQexec(m_connection, query.c_str());
+    if (PQresultStatus(result) != PGRES_TUPLES_OK) {
+        const std::string message = PQerrorMessage(m_connection);
+        PQclear(result);
+        throw std::runtime_error((boost::format("%1% failed: %2%\n") % query % message).str());
+    }
+    int64_t sequence_number = -1;
+    if (PQntuples(result) > 0 && !PQgetisnull(result, 0, 0)) {
+        sequence_number = strtoll(PQgetvalue(result, 0, 0), nullptr, 10);
+    }
+    PQclear(result);
+    return sequence_number;
+}
+
+int64_t ReplicationState::last_applied() {
+    return query_sequence_number("sequence_number");
+}
+
+int64_t ReplicationState::in_progress() {
+    return query_sequence_number("in_progress");
+}
+
+void ReplicationState::start(const int64_t sequence_number) {
+    // If nothing has been recorded yet, the preceding diff counts as applied.
+    execute((boost::format("INSERT INTO %1% (sequence_number, in_progress) VALUES (%2%, %3%) ON CONFLICT (id) DO UPDATE "
+            "SET in_progress = EXCLUDED.in_progress") % table_name % (sequence_number - 1) % sequence_number).str().c_str());
+}
+
+/*static*/ std::string ReplicationState::record_query(const int64_t sequence_number) {
+    return (boost::format("UPDATE %1% SET sequence_number = %2%, in_progress = NULL, applied = now()")
+            % table_name % sequence_number).str();
+}
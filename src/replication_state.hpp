@@ -0,0 +1,120 @@
+/*
+ * replication_state.hpp
+ *
+ *  Created on:  2026-10-17
+ *      Author: Michael Reichert <michael.reichert@geofabrik.de>
+ */
+
+#ifndef SRC_REPLICATION_STATE_HPP_
+#define SRC_REPLICATION_STATE_HPP_
+
+#include <cstdint>
+#include <istream>
+#include <string>
+
+#include <libpq-fe.h>
+
+/**
+ * \brief Replication directory followed by `--follow` and the last diff applied to the database.
+ *
+ * The directory has the layout of the replication directories of planet.openstreetmap.org:
+ * `state.txt` contains the sequence number of the newest diff, the diff with the sequence
+ * number 1234567 is `001/234/567.osc.gz`.
+ *
+ * The sequence number of the last applied diff is kept in the table `cerepso_replication_state`
+ * of the target database. The table also records the diff being applied. If that diff has not
+ * been recorded as applied, it may have been applied partially because the tables are committed
+ * one after another.
+ */
+class ReplicationState {
+
+    std::string m_directory;
+
+    PGconn* m_connection;
+
+    /**
+     * \throws std::runtime_error
+     */
+    void execute(const char* query);
+
+    /**
+     * Read a column of the table, -1 if the table is empty or the value is NULL.
+     *
+     * \throws std::runtime_error
+     */
+    int64_t query_sequence_number(const char* column);
+
+public:
+    ReplicationState() = delete;
+
+    ReplicationState(const ReplicationState&) = delete;
+
+    ReplicationState& operator=(const ReplicationState&) = delete;
+
+    /**
+     * \param directory replication directory
+     * \param database_name name of the database to keep the sequence number in
+     *
+     * \throws std::runtime_error if the connection to the database fails
+     */
+    ReplicationState(const std::string& directory, const std::string& database_name);
+
+    ~ReplicationState();
+
+    /**
+     * Read the sequence number from the content of a `state.txt` file.
+     *
+     * \throws std::runtime_error if there is no valid sequence number
+     */
+    static int64_t parse_state_file(std::istream& in);
+
+    /**
+     * Path of the diff with the given sequence number.
+     */
+    static std::string diff_file(const std::string& directory, const int64_t sequence_number);
+
+    /**
+     * Path of the diff with the given sequence number in the followed directory.
+     */
+    std::string diff_file(const int64_t sequence_number) const {
+        return diff_file(m_directory, sequence_number);
+    }
+
+    /**
+     * Sequence number of the newest diff available in the directory.
+     *
+     * \throws std::runtime_error if `state.txt` cannot be read
+     */
+    int64_t latest_available() const;
+
+    /**
+     * Sequence number of the last diff applied to the database, -1 if none has been recorded.
+     *
+     * \throws std::runtime_error
+     */
+    int64_t last_applied();
+
+    /**
+     * Sequence number of the diff whose application was started but has not been recorded as
+     * applied, -1 if there is none.
+     *
+     * \throws std::runtime_error
+     */
+    int64_t in_progress();
+
+    /**
+     * Record that the application of a diff starts. This is committed immediately.
+     *
+     * \throws std::runtime_error
+     */
+    void start(const int64_t sequence_number);
+
+    /**
+     * Query recording that a diff has been applied. Run it in the transaction of the diff which
+     * is committed last to make sure that the diff is only recorded if all tables are committed.
+     * start() has to be called before.
+     */
+    static std::string record_query(const int64_t sequence_number);
+};
+
+#endif /* SRC_REPLICATION_STATE_HPP_ */
@@ -0,0 +1,98 @@
+/*
+ * spatial_sort_key.hpp
+ *
+ *  Created on:  2026-10-17
+ *      Author: Michael Reichert <michael.reichert@geofabrik.de>
+ */
+
+#ifndef SRC_SPATIAL_SORT_KEY_HPP_
+#define SRC_SPATIAL_SORT_KEY_HPP_
+
+#include <cstdint>
+#include <limits>
+#include <utility>
+
+#include <osmium/osm/area.hpp>
+#include <osmium/osm/box.hpp>
+#include <osmium/osm/location.hpp>
+#include <osmium/osm/node.hpp>
+#include <osmium/osm/way.hpp>
+
+/**
+ * \brief Keys to sort rows by the location of their geometry.
+ *
+ * The key is the position on a Hilbert curve which covers the whole range of the fixed point
+ * coordinates of osmium::Location (32 bit per axis). Geometries close to each other usually
+ * get close keys, i.e. rows sorted by the key are clustered like rows ordered by ST_GeoHash.
+ *
+ * Invalid locations get the largest key and are sorted last like NULL values by ORDER BY.
+ */
+namespace spatial_sort_key {
+
+    constexpr uint64_t invalid_key = std::numeric_limits<uint64_t>::max();
+
+    /**
+     * Position of a point on a Hilbert curve of order 32.
+     *
+     * \param x x coordinate
+     * \param y y coordinate
+     */
+    inline uint64_t hilbert_index(uint32_t x, uint32_t y) noexcept {
+        uint64_t index = 0;
+        for (uint32_t s = 1u << 31; s > 0; s >>= 1) {
+            const uint32_t rx = (x & s) > 0;
+            const uint32_t ry = (y & s) > 0;
+            index += static_cast<uint64_t>(s) * s * ((3 * rx) ^ ry);
+            // rotate the quadrant
+            if (ry == 0) {
+                if (rx == 1) {
+                    x = ~x;
+                    y = ~y;
+                }
+                std::swap(x, y);
+            }
+        }
+        return index;
+    }
+
+    inline uint64_t from_location(const osmium::Location& location) noexcept {
+        if (!location.valid()) {
+            return invalid_key;
+        }
+        // shift the coordinates into the range of uint32_t
+        const uint32_t x = static_cast<uint32_t>(static_cast<int64_t>(location.x()) + (int64_t{1} << 31));
+        const uint32_t y = static_cast<uint32_t>(static_cast<int64_t>(location.y()) + (int64_t{1} << 31));
+        return hilbert_index(x, y);
+    }
+
+    /**
+     * Key of the center of a bounding box.
+     */
+    inline uint64_t from_box(const osmium::Box& box) noexcept {
+        if (!box.valid()) {
+            return invalid_key;
+        }
+        const int64_t x = (static_cast<int64_t>(box.bottom_left().x()) + box.top_right().x()) / 2;
+        const int64_t y = (static_cast<int64_t>(box.bottom_left().y()) + box.top_right().y()) / 2;
+        return from_location(osmium::Location{static_cast<int32_t>(x), static_cast<int32_t>(y)});
+    }
+
+    /**
+     * Key of a node, a way or an area. Ways and areas are sorted by the center of their
+     * bounding box. Other objects get the largest key.
+     */
+    inline uint64_t from_object(const osmium::OSMObject& object) noexcept {
+        switch (object.type()) {
+        case osmium::item_type::node:
+            return from_location(static_cast<const osmium::Node&>(object).location());
+        case osmium::item_type::way:
+            return from_box(static_cast<const osmium::Way&>(object).envelope());
+        case osmium::item_type::area:
+            return from_box(static_cast<const osmium::Area&>(object).envelope());
+        default:
+            return invalid_key;
+        }
+    }
+}
+
+#endif /* SRC_SPATIAL_SORT_KEY_HPP_ */
@@ -37,6 +37,12 @@ public:
      */
     virtual osmium::Location get_node_location(const osmium::object_id_type id) const = 0;
 
+    /**
+     * Can get_node_location be called by multiple threads at the same time once all nodes have
+     * been stored?
+     */
+    virtual bool concurrent_lookups() const noexcept = 0;
+
     /**
      * Retrieve locations of all nodes in the way from storage and add
      * them to the way object.
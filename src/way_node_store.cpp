@@ -0,0 +1,52 @@
+/*
+ * way_node_store.cpp
+ *
+ *  Created on:  2026-10-17
+ *      Author: Michael Reichert <michael.reichert@geofabrik.de>
+ */
+
+#include <algorithm>
+#include "way_node_store.hpp"
+
+WayNodeStore::WayNodeStore(const size_t block_size) :
+    m_entries(),
+    m_blocks(),
+    m_block_size(block_size) {
+}
+
+void WayNodeStore::add(const osmium::Way& way) {
+    if (!m_entries.empty() && m_entries.back().id > way.id()) {
+        m_sorted = false;
+    }
+    const size_t count = way.nodes().size();
+    if (m_blocks.empty() || m_blocks.back().capacity() - m_blocks.back().size() < count) {
+        m_blocks.emplace_back();
+        m_blocks.back().reserve(std::max(m_block_size, count));
+    }
+    std::vector<StoredLocation>& block = m_blocks.back();
+    const StoredLocation* first = block.data() + block.size();
+    for (const osmium::NodeRef& node_ref : way.nodes()) {
+        block.push_back(StoredLocation{node_ref.location()});
+    }
+    m_entries.push_back(Entry{way.id(), first, count});
+}
+
+void WayNodeStore::prepare_for_lookup() {
+    if (!m_sorted) {
+        // stable sort to return the first version of a way if it has been added multiple times
+        std::stable_sort(m_entries.begin(), m_entries.end(), [](const Entry& a, const Entry& b) {
+            return a.id < b.id;
+        });
+        m_sorted = true;
+    }
+}
+
+WayNodeStore::Range WayNodeStore::get(const osmium::object_id_type id) const {
+    auto it = std::lower_bound(m_entries.begin(), m_entries.end(), id, [](const Entry& entry, const osmium::object_id_type value) {
+        return entry.id < value;
+    });
+    if (it == m_entries.end() || it->id != id) {
+        return Range{nullptr, nullptr};
+    }
+    return Range{it->first, it->first + it->count};
+}
@@ -0,0 +1,119 @@
+/*
+ * way_node_store.hpp
+ *
+ *  Created on:  2026-10-17
+ *      Author: Michael Reichert <michael.reichert@geofabrik.de>
+ */
+
+#ifndef SRC_WAY_NODE_STORE_HPP_
+#define SRC_WAY_NODE_STORE_HPP_
+
+#include <deque>
+#include <vector>
+
+#include <osmium/osm/location.hpp>
+#include <osmium/osm/types.hpp>
+#include <osmium/osm/way.hpp>
+
+/**
+ * \brief In-memory store of the node locations of all ways.
+ *
+ * The single-pass import uses it to build the geometries of relations after all nodes and ways
+ * have been read. Only the locations are stored because the node IDs are not needed for the
+ * geometries. The store needs 8 bytes per way node and 24 bytes per way. The locations are
+ * kept in blocks of fixed size and the index in a deque, nothing is copied if the store grows.
+ */
+class WayNodeStore {
+public:
+    /**
+     * Location of a way node. The location() accessor allows the use of the fill_linestring
+     * methods of Osmium's geometry factories.
+     */
+    struct StoredLocation {
+        osmium::Location m_location;
+
+        const osmium::Location& location() const noexcept {
+            return m_location;
+        }
+    };
+
+    /**
+     * Locations of the nodes of a way. begin and end are nullptr if the way is not in the store.
+     */
+    struct Range {
+        const StoredLocation* m_begin;
+        const StoredLocation* m_end;
+
+        const StoredLocation* begin() const noexcept {
+            return m_begin;
+        }
+
+        const StoredLocation* end() const noexcept {
+            return m_end;
+        }
+
+        bool empty() const noexcept {
+            return m_begin == m_end;
+        }
+    };
+
+private:
+    struct Entry {
+        osmium::object_id_type id;
+        /// first location of the way in one of the blocks
+        const StoredLocation* first;
+        size_t count;
+    };
+
+    std::deque<Entry> m_entries;
+
+    /**
+     * Blocks of locations. Their capacity is reserved when they are created, therefore
+     * pointers into them stay valid. The locations of a way are never split between blocks.
+     */
+    std::vector<std::vector<StoredLocation>> m_blocks;
+
+    /// number of locations of a block, ways with more nodes get a block of their own
+    size_t m_block_size;
+
+    /// true if the ways have been added ordered by their ID
+    bool m_sorted = true;
+
+public:
+    /**
+     * \param block_size number of locations per block
+     */
+    explicit WayNodeStore(const size_t block_size = 1024 * 1024);
+
+    /**
+     * Add the locations of the nodes of a way. The locations have to be set already.
+     */
+    void add(const osmium::Way& way);
+
+    /**
+     * Sort the index of the store if the ways have not been added in the order of their IDs.
+     * Call this method after the last call of add() and before calling get(). Sorting needs
+     * temporary memory of up to 24 bytes per way.
+     */
+    void prepare_for_lookup();
+
+    /**
+     * Get the locations of the nodes of a way.
+     *
+     * \returns empty range if the way is not in the store
+     */
+    Range get(const osmium::object_id_type id) const;
+
+    /**
+     * Number of ways in the store.
+     */
+    size_t size() const noexcept {
+        return m_entries.size();
+    }
+
+    bool empty() const noexcept {
+        return m_entries.empty();
+    }
+};
+
+#endif /* SRC_WAY_NODE_STORE_HPP_ */
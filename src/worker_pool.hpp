@@ -0,0 +1,163 @@
+/*
+ * worker_pool.hpp
+ *
+ *  Created on:  2026-10-17
+ *      Author: Michael Reichert <michael.reichert@geofabrik.de>
+ */
+
+#ifndef SRC_WORKER_POOL_HPP_
+#define SRC_WORKER_POOL_HPP_
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * \brief Pool of worker threads whose results are consumed in the order the tasks were submitted.
+ *
+ * The thread submitting the tasks consumes the results. Only the tasks run concurrently, the
+ * consumer always runs on the submitting thread. The number of tasks which have been submitted
+ * but whose result has not been consumed yet is limited. If the limit is reached, submit()
+ * waits for the oldest task and consumes its result before the new task is queued. This keeps
+ * the memory usage bounded if the consumer is slower than the workers.
+ *
+ * Exceptions thrown by a task are rethrown on the submitting thread when its result is consumed.
+ *
+ * \tparam TResult result type of the tasks, has to be movable
+ */
+template <typename TResult>
+class OrderedWorkerPool {
+
+    using task_type = std::packaged_task<TResult()>;
+
+    std::vector<std::thread> m_threads;
+
+    /// tasks waiting for a worker
+    std::deque<task_type> m_tasks;
+
+    /// results of the submitted tasks in the order of submission
+    std::deque<std::future<TResult>> m_pending;
+
+    /// maximum size of m_pending
+    size_t m_max_pending;
+
+    std::mutex m_mutex;
+
+    /// signalled if a task was added or the workers should stop
+    std::condition_variable m_task_available;
+
+    bool m_done = false;
+
+    void run() {
+        while (true) {
+            task_type task;
+            {
+                std::unique_lock<std::mutex> lock{m_mutex};
+                m_task_available.wait(lock, [this] { return m_done || !m_tasks.empty(); });
+                if (m_done) {
+                    return;
+                }
+                task = std::move(m_tasks.front());
+                m_tasks.pop_front();
+            }
+            task();
+        }
+    }
+
+    template <typename TConsumer>
+    void consume_oldest(TConsumer& consumer) {
+        std::future<TResult> future = std::move(m_pending.front());
+        m_pending.pop_front();
+        TResult result = future.get();
+        consumer(result);
+    }
+
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock{m_mutex};
+            m_done = true;
+            // Tasks which have not been started yet are dropped. This only happens if the
+            // submitting thread leaves because of an exception.
+            m_tasks.clear();
+        }
+        m_task_available.notify_all();
+        for (std::thread& thread : m_threads) {
+            if (thread.joinable()) {
+                thread.join();
+            }
+        }
+    }
+
+public:
+    OrderedWorkerPool() = delete;
+
+    OrderedWorkerPool(const OrderedWorkerPool&) = delete;
+
+    OrderedWorkerPool& operator=(const OrderedWorkerPool&) = delete;
+
+    /**
+     * Start the worker threads.
+     *
+     * \param threads number of worker threads, at least 1
+     * \param max_pending maximum number of submitted tasks whose result has not been consumed yet
+     */
+    OrderedWorkerPool(const size_t threads, const size_t max_pending) :
+        m_max_pending(max_pending > 0 ? max_pending : 1) {
+        for (size_t i = 0; i < threads || i == 0; ++i) {
+            m_threads.emplace_back(&OrderedWorkerPool::run, this);
+        }
+    }
+
+    ~OrderedWorkerPool() {
+        stop();
+    }
+
+    /**
+     * Queue a task. Results of older tasks are consumed if too many results are pending.
+     *
+     * \param task function to be executed by a worker
+     * \param consumer function taking `TResult&`, called on this thread
+     *
+     * \throws any exception thrown by an older task or by the consumer
+     */
+    template <typename TConsumer>
+    void submit(std::function<TResult()> task, TConsumer&& consumer) {
+        while (m_pending.size() >= m_max_pending) {
+            consume_oldest(consumer);
+        }
+        task_type packaged_task{std::move(task)};
+        m_pending.push_back(packaged_task.get_future());
+        {
+            std::lock_guard<std::mutex> lock{m_mutex};
+            m_tasks.push_back(std::move(packaged_task));
+        }
+        m_task_available.notify_one();
+    }
+
+    /**
+     * Wait for all submitted tasks and consume their results.
+     *
+     * \param consumer function taking `TResult&`, called on this thread
+     *
+     * \throws any exception thrown by a task or by the consumer
+     */
+    template <typename TConsumer>
+    void drain(TConsumer&& consumer) {
+        while (!m_pending.empty()) {
+            consume_oldest(consumer);
+        }
+    }
+
+    /**
+     * Number of submitted tasks whose result has not been consumed yet.
+     */
+    size_t pending() const noexcept {
+        return m_pending.size();
+    }
+};
+
+#endif /* SRC_WORKER_POOL_HPP_ */
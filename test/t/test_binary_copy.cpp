@@ -0,0 +1,66 @@
+/*
+ * test_binary_copy.cpp
+ *
+ *  Created on:  2026-10-17
+ *      Author: Michael Reichert <michael.reichert@geofabrik.de>
+ */
+
+#include "catch.hpp"
+#include <postgres_drivers/binary_copy.hpp>
+
+using namespace postgres_drivers;
+
+TEST_CASE("encoding of fields for binary COPY") {
+
+    std::string out;
+
+    SECTION("header and trailer") {
+        binary::append_header(out);
+        REQUIRE(out == std::string("PGCOPY\n\377\r\n\0\0\0\0\0\0\0\0\0", 19));
+        out.clear();
+        binary::append_trailer(out);
+        REQUIRE(out == "\xff\xff");
+    }
+
+    SECTION("integers are written in network byte order") {
+        binary::append_int64_field(out, 258);
+        REQUIRE(out == std::string("\0\0\0\x08\0\0\0\0\0\0\x01\x02", 12));
+    }
+
+    SECTION("NULL") {
+        binary::append_text_field(out, nullptr);
+        REQUIRE(out == "\xff\xff\xff\xff");
+    }
+
+    SECTION("text field") {
+        binary::append_text_field(out, "ab\tc");
+        REQUIRE(out == std::string("\0\0\0\x04" "ab\tc", 8));
+    }
+
+    SECTION("integer tag value for int column") {
+        binary::append_typed_text_field(out, ColumnType::INT, "-2");
+        REQUIRE(out == std::string("\0\0\0\x04\xff\xff\xff\xfe", 8));
+    }
+
+    SECTION("invalid integer tag value becomes NULL") {
+        binary::append_typed_text_field(out, ColumnType::SMALLINT, "3 m");
+        REQUIRE(out == "\xff\xff\xff\xff");
+    }
+
+    SECTION("hstore") {
+        size_t offset = binary::start_hstore(out);
+        binary::append_hstore_pair(out, "k", "v");
+        binary::finish_hstore(out, offset, 1);
+        REQUIRE(out == std::string("\0\0\0\x0e\0\0\0\x01\0\0\0\x01k\0\0\0\x01v", 18));
+    }
+
+    SECTION("empty array") {
+        size_t offset = binary::start_array(out, binary::oid_int8);
+        binary::finish_array(out, offset, 0);
+        REQUIRE(out == std::string("\0\0\0\x14\0\0\0\x01\0\0\0\0\0\0\0\x14\0\0\0\0\0\0\0\x01", 24));
+    }
+
+    SECTION("empty geometry") {
+        REQUIRE(binary::empty_ewkb(4, 4326) == std::string("\x01\x04\0\0\x20\xe6\x10\0\0\0\0\0\0", 13));
+    }
+}
@@ -0,0 +1,66 @@
+/*
+ * test_change_merger.cpp
+ *
+ *  Created on:  2026-10-17
+ *      Author: Michael Reichert <michael.reichert@geofabrik.de>
+ */
+
+#include <vector>
+
+#include "catch.hpp"
+#include "object_builder_utilities.hpp"
+#include <change_merger.hpp>
+
+namespace {
+
+    constexpr size_t buffer_size = 10 * 1000;
+
+    void add_node(osmium::memory::Buffer& buffer, const osmium::object_id_type id,
+            const osmium::object_version_type version, const double lon, const bool deleted = false) {
+        tagmap tags;
+        osmium::Node& node = test_utils::create_new_node(buffer, id, lon, 50.0, tags);
+        node.set_version(version);
+        node.set_visible(!deleted);
+        buffer.commit();
+    }
+
+}
+
+TEST_CASE("only the newest version of each object is kept") {
+    std::vector<osmium::memory::Buffer> buffers;
+    buffers.emplace_back(buffer_size);
+    buffers.emplace_back(buffer_size);
+    add_node(buffers[0], 2, 1, 9.0);
+    add_node(buffers[0], 1, 3, 9.0);
+    add_node(buffers[1], 2, 2, 9.1);
+    add_node(buffers[1], 1, 4, 9.0, true);
+    add_node(buffers[1], 5, 1, 9.2);
+
+    osmium::memory::Buffer merged = merge_changes(buffers);
+    std::vector<const osmium::Node*> nodes;
+    for (auto it = merged.cbegin<osmium::Node>(); it != merged.cend<osmium::Node>(); ++it) {
+        nodes.push_back(&*it);
+    }
+    REQUIRE(nodes.size() == 3);
+    REQUIRE(nodes.at(0)->id() == 1);
+    REQUIRE(nodes.at(0)->version() == 4);
+    REQUIRE(nodes.at(0)->deleted());
+    REQUIRE(nodes.at(1)->id() == 2);
+    REQUIRE(nodes.at(1)->version() == 2);
+    REQUIRE(nodes.at(1)->location().lon() == Approx(9.1));
+    REQUIRE(nodes.at(2)->id() == 5);
+}
+
+TEST_CASE("later change set wins for equal versions") {
+    std::vector<osmium::memory::Buffer> buffers;
+    buffers.emplace_back(buffer_size);
+    buffers.emplace_back(buffer_size);
+    add_node(buffers[0], 1, 2, 9.0);
+    add_node(buffers[1], 1, 2, 9.5);
+
+    osmium::memory::Buffer merged = merge_changes(buffers);
+    auto it = merged.cbegin<osmium::Node>();
+    REQUIRE(it != merged.cend<osmium::Node>());
+    REQUIRE(it->location().lon() == Approx(9.5));
+    REQUIRE(++it == merged.cend<osmium::Node>());
+}
@@ -0,0 +1,62 @@
+/*
+ * test_column_plan.cpp
+ *
+ *  Created on:  2026-10-17
+ *      Author: Michael Reichert <michael.reichert@geofabrik.de>
+ */
+
+#include "catch.hpp"
+#include <column_plan.hpp>
+
+using namespace postgres_drivers;
+
+TEST_CASE("column plan maps tag keys to columns") {
+    Columns columns{ColumnsVector{
+        Column("osm_id", ColumnType::BIGINT, ColumnClass::OSM_ID),
+        Column("name", ColumnType::TEXT, ColumnClass::TAG),
+        Column("highway", ColumnType::TEXT, ColumnClass::TAG),
+        Column("layer", ColumnType::SMALLINT, ColumnClass::TAG),
+        Column("tags", ColumnType::HSTORE, ColumnClass::TAGS_OTHER)
+    }};
+    ColumnPlan plan{columns};
+
+    SECTION("one slot per column") {
+        REQUIRE(plan.slots().size() == 5);
+        REQUIRE(plan.tag_column_count() == 3);
+        REQUIRE(plan.slots()[0].tag_index == -1);
+        REQUIRE(plan.slots()[3].type == ColumnType::SMALLINT);
+        REQUIRE(plan.slots()[4].column_class == ColumnClass::TAGS_OTHER);
+    }
+
+    SECTION("keys are found") {
+        REQUIRE(plan.find_tag_column("name") == plan.slots()[1].tag_index);
+        REQUIRE(plan.find_tag_column("highway") == plan.slots()[2].tag_index);
+        REQUIRE(plan.find_tag_column("layer") == plan.slots()[3].tag_index);
+    }
+
+    SECTION("other keys and names of non-tag columns are not found") {
+        REQUIRE(plan.find_tag_column("amenity") == -1);
+        REQUIRE(plan.find_tag_column("name:de") == -1);
+        REQUIRE(plan.find_tag_column("") == -1);
+        REQUIRE(plan.find_tag_column("osm_id") == -1);
+        REQUIRE(plan.find_tag_column("tags") == -1);
+    }
+}
+
+TEST_CASE("column plan with many tag columns") {
+    ColumnsVector vector;
+    for (int i = 0; i < 100; ++i) {
+        vector.emplace_back("key" + std::to_string(i), ColumnType::TEXT, ColumnClass::TAG);
+    }
+    // duplicate key
+    vector.emplace_back("key7", ColumnType::TEXT, ColumnClass::TAG);
+    Columns columns{std::move(vector)};
+    ColumnPlan plan{columns};
+
+    REQUIRE(plan.tag_column_count() == 100);
+    for (int i = 0; i < 100; ++i) {
+        REQUIRE(plan.find_tag_column(("key" + std::to_string(i)).c_str()) == i);
+    }
+    REQUIRE(plan.slots()[100].tag_index == 7);
+    REQUIRE(plan.find_tag_column("key100") == -1);
+}
@@ -0,0 +1,27 @@
+/*
+ * test_copy_writer.cpp
+ *
+ *  Created on:  2026-10-17
+ *      Author: Michael Reichert <michael.reichert@geofabrik.de>
+ */
+
+#include "catch.hpp"
+#include <postgres_drivers/copy_writer.hpp>
+
+TEST_CASE("writer thread of COPY") {
+
+    SECTION("finishing without data") {
+        postgres_drivers::CopyWriter writer {nullptr, "test", 2};
+        REQUIRE_NOTHROW(writer.finish());
+        REQUIRE(writer.stalls() == 0);
+    }
+
+    SECTION("errors of the writer thread are reported to the producer") {
+        // PQputCopyData fails because there is no connection.
+        postgres_drivers::CopyWriter writer {nullptr, "test", 2};
+        std::string chunk {"1\tfoo\n"};
+        writer.push(chunk);
+        REQUIRE(chunk.empty());
+        REQUIRE_THROWS_AS(writer.finish(), std::runtime_error);
+    }
+}
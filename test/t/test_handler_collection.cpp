@@ -0,0 +1,66 @@
+/*
+ * test_handler_collection.cpp
+ *
+ *  Created on:  2026-10-17
+ *      Author: Michael Reichert <michael.reichert@geofabrik.de>
+ */
+
+#include "catch.hpp"
+#include "object_builder_utilities.hpp"
+#include <handler_collection.hpp>
+
+namespace {
+
+    struct CountingHandler : public osmium::handler::Handler {
+        int nodes = 0;
+        int ways = 0;
+
+        void node(const osmium::Node&) {
+            ++nodes;
+        }
+
+        void way(const osmium::Way&) {
+            ++ways;
+        }
+    };
+
+    /// handler which does not derive from osmium::handler::Handler and modifies ways
+    struct ModifyingWayHandler {
+        int ways = 0;
+
+        void way(osmium::Way&) {
+            ++ways;
+        }
+    };
+
+}
+
+TEST_CASE("handler collection calls the callbacks of all enabled handlers") {
+    static constexpr int buffer_size = 10 * 1000;
+    osmium::memory::Buffer buffer(buffer_size);
+    tagmap tags;
+    osmium::Node& node = test_utils::create_new_node(buffer, 1, 9.0, 50.0, tags);
+    buffer.commit();
+    const osmium::NodeRef nd_ref1 (1, osmium::Location(9.0, 50.1));
+    const osmium::NodeRef nd_ref2 (2, osmium::Location(9.1, 50.0));
+    std::vector<const osmium::NodeRef*> node_refs {&nd_ref1, &nd_ref2};
+    osmium::Way& way = test_utils::create_way(buffer, 1, node_refs, tags);
+    buffer.commit();
+
+    CountingHandler counting1;
+    CountingHandler counting2;
+    ModifyingWayHandler modifying;
+    CountingHandler* disabled = nullptr;
+    auto handlers = make_handler_collection(&counting1, disabled, &modifying, &counting2);
+    handlers.node(node);
+    handlers.way(way);
+    const osmium::Way& const_way = way;
+    handlers.way(const_way);
+
+    REQUIRE(counting1.nodes == 1);
+    REQUIRE(counting1.ways == 2);
+    REQUIRE(counting2.nodes == 1);
+    REQUIRE(counting2.ways == 2);
+    // const ways are not passed to handlers which need a mutable way
+    REQUIRE(modifying.ways == 1);
+}
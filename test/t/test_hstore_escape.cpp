@@ -42,4 +42,31 @@ TEST_CASE( "escape4hstore(), escape()") {
         PostgresTable::escape("this_\\begin\\", destination_str);
         REQUIRE(destination_str.compare("this_\\\\begin\\\\") == 0);
     }
+
+    // The following strings are longer than the blocks checked at once by the vectorized search.
+
+    SECTION("escaping long string with quotation mark for hstore columns") {
+        const std::string head(40, 'a');
+        const std::string tail(20, 'b');
+        PostgresTable::escape4hstore((head + "\"" + tail).c_str(), destination_str);
+        REQUIRE(destination_str == "\"" + head + "\\\\\"" + tail + "\"");
+    }
+
+    SECTION("escaping long string with special characters at block borders for non-hstore columns") {
+        const std::string part(15, 'x');
+        PostgresTable::escape((part + "\t" + part + "\n" + part + part + "\\").c_str(), destination_str);
+        REQUIRE(destination_str == part + "\\\t" + part + "\\\n" + part + part + "\\\\");
+    }
+
+    SECTION("escaping long string without special characters for arrays") {
+        const std::string value(100, 'z');
+        PostgresTable::escape4array(value.c_str(), destination_str);
+        REQUIRE(destination_str == value);
+    }
+
+    SECTION("escaping long string with newline for arrays") {
+        const std::string part(33, 'y');
+        PostgresTable::escape4array((part + "\n" + part).c_str(), destination_str);
+        REQUIRE(destination_str == part + "\\\\n" + part);
+    }
 }
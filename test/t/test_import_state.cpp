@@ -0,0 +1,62 @@
+/*
+ * test_import_state.cpp
+ *
+ *  Created on:  2026-10-17
+ *      Author: Michael Reichert <michael.reichert@geofabrik.de>
+ */
+
+#include "catch.hpp"
+#include <cstdlib>
+#include <fstream>
+#include <unistd.h>
+#include <import_state.hpp>
+
+TEST_CASE("state of an import kept in a file") {
+    char dir_template[] = "/tmp/cerepso_test_XXXXXX";
+    REQUIRE(mkdtemp(dir_template));
+    const std::string filename = std::string{dir_template} + "/import.state";
+
+    {
+        ImportState state {filename, ""};
+        state.start("planet.osm.pbf");
+        REQUIRE_FALSE(state.resumed());
+        REQUIRE_FALSE(state.completed("loaded:planet_osm_point"));
+        state.complete("loaded:planet_osm_point");
+        state.complete("loaded:planet_osm_point");
+        state.complete("geometry index:planet_osm_point");
+        REQUIRE(state.completed("loaded:planet_osm_point"));
+    }
+
+    SECTION("phases are read on resume") {
+        // incomplete last line written by a crashed run
+        std::ofstream{filename, std::ios::app} << "completed id ind";
+        ImportState state {filename, ""};
+        state.resume("planet.osm.pbf");
+        REQUIRE(state.resumed());
+        REQUIRE(state.completed("loaded:planet_osm_point"));
+        REQUIRE(state.completed("geometry index:planet_osm_point"));
+        REQUIRE_FALSE(state.completed("id index:planet_osm_point"));
+        REQUIRE_FALSE(state.completed("loaded:planet_osm_line"));
+    }
+
+    SECTION("state of another input file") {
+        ImportState state {filename, ""};
+        REQUIRE_THROWS_AS(state.resume("germany.osm.pbf"), std::runtime_error);
+    }
+
+    SECTION("starting again removes all phases") {
+        ImportState state {filename, ""};
+        state.start("planet.osm.pbf");
+        ImportState resumed {filename, ""};
+        resumed.resume("planet.osm.pbf");
+        REQUIRE_FALSE(resumed.completed("loaded:planet_osm_point"));
+    }
+
+    unlink(filename.c_str());
+    rmdir(dir_template);
+}
+
+TEST_CASE("resuming without state file fails") {
+    ImportState state {"/nonexistent-directory/import.state", ""};
+    REQUIRE_THROWS_AS(state.resume("planet.osm.pbf"), std::runtime_error);
+}
@@ -0,0 +1,61 @@
+/*
+ * test_lru_cache.cpp
+ *
+ *  Created on:  2026-10-17
+ *      Author: Michael Reichert <michael.reichert@geofabrik.de>
+ */
+
+#include <string>
+
+#include "catch.hpp"
+#include <lru_cache.hpp>
+
+TEST_CASE("get returns cached values and counts hits and misses") {
+    LRUCache<int, std::string> cache{2};
+    REQUIRE(cache.get(1) == nullptr);
+    cache.put(1, "one");
+    const std::string* value = cache.get(1);
+    REQUIRE(value != nullptr);
+    REQUIRE(*value == "one");
+    REQUIRE(cache.hits() == 1);
+    REQUIRE(cache.misses() == 1);
+}
+
+TEST_CASE("least recently used entry is evicted") {
+    LRUCache<int, std::string> cache{2};
+    cache.put(1, "one");
+    cache.put(2, "two");
+    // 1 becomes the most recently used entry
+    REQUIRE(cache.get(1) != nullptr);
+    cache.put(3, "three");
+    REQUIRE(cache.size() == 2);
+    REQUIRE(cache.get(2) == nullptr);
+    REQUIRE(*cache.get(1) == "one");
+    REQUIRE(*cache.get(3) == "three");
+}
+
+TEST_CASE("put replaces existing entries") {
+    LRUCache<int, std::string> cache{2};
+    cache.put(1, "one");
+    cache.put(1, "uno");
+    REQUIRE(cache.size() == 1);
+    REQUIRE(*cache.get(1) == "uno");
+}
+
+TEST_CASE("erased entries are not returned") {
+    LRUCache<int, std::string> cache{2};
+    cache.put(1, "one");
+    cache.put(2, "two");
+    cache.erase(1);
+    cache.erase(5);
+    REQUIRE(cache.size() == 1);
+    REQUIRE(cache.get(1) == nullptr);
+    REQUIRE(*cache.get(2) == "two");
+}
+
+TEST_CASE("cache with capacity 0 stores nothing") {
+    LRUCache<int, std::string> cache{0};
+    cache.put(1, "one");
+    REQUIRE(cache.size() == 0);
+    REQUIRE(cache.get(1) == nullptr);
+}
@@ -0,0 +1,114 @@
+/*
+ * test_output_dir.cpp
+ *
+ *  Created on:  2026-10-17
+ *      Author: Michael Reichert <michael.reichert@geofabrik.de>
+ */
+
+#include "catch.hpp"
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <unistd.h>
+#include <zlib.h>
+#include <postgres_drivers/table.hpp>
+
+using namespace postgres_drivers;
+
+namespace {
+
+    std::string read_file(const std::string& path) {
+        std::ifstream file{path};
+        std::stringstream content;
+        content << file.rdbuf();
+        return content.str();
+    }
+
+    std::string read_gzip_file(const std::string& path) {
+        gzFile file = gzopen(path.c_str(), "rb");
+        REQUIRE(file);
+        std::string content;
+        char buffer[4096];
+        int length;
+        while ((length = gzread(file, buffer, sizeof(buffer))) > 0) {
+            content.append(buffer, length);
+        }
+        gzclose(file);
+        return content;
+    }
+
+    void write_table(Config& config) {
+        Columns columns{ColumnsVector{
+            Column("osm_id", ColumnType::BIGINT, ColumnClass::OSM_ID),
+            Column("name", ColumnType::TEXT, ColumnClass::TAG)
+        }};
+        Table table{"test_table", config, columns};
+        table.send_query("CREATE TABLE test_table (osm_id bigint, name text)");
+        table.start_copy();
+        table.send_line("1\tfoo\n");
+        table.send_line("2\tbar\n");
+        table.end_copy();
+        table.send_query("CREATE INDEX test_table_pkey ON test_table USING BTREE (osm_id);");
+    }
+
+} // anonymous namespace
+
+TEST_CASE("tables write into files instead of the database") {
+    char dir_template[] = "/tmp/cerepso_test_XXXXXX";
+    REQUIRE(mkdtemp(dir_template));
+    const std::string dir = dir_template;
+
+    Config config;
+    config.output_dir = dir;
+
+    SECTION("uncompressed") {
+        write_table(config);
+        REQUIRE(read_file(dir + "/manifest.sql") == "\\ir test_table.sql\n");
+        REQUIRE(read_file(dir + "/test_table.copy") == "1\tfoo\n2\tbar\n");
+        REQUIRE(read_file(dir + "/test_table.sql") == "CREATE TABLE test_table (osm_id bigint, name text);\n"
+                "\\copy test_table (\"osm_id\",\"name\") FROM 'test_table.copy'\n"
+                "CREATE INDEX test_table_pkey ON test_table USING BTREE (osm_id);\n");
+        unlink((dir + "/test_table.copy").c_str());
+    }
+
+    SECTION("compressed") {
+        config.compress_output = true;
+        write_table(config);
+        REQUIRE(read_gzip_file(dir + "/test_table.copy.gz") == "1\tfoo\n2\tbar\n");
+        REQUIRE(read_file(dir + "/test_table.sql").find("FROM PROGRAM 'gzip -dc test_table.copy.gz'\n") != std::string::npos);
+        unlink((dir + "/test_table.copy.gz").c_str());
+    }
+
+    SECTION("sorted rows") {
+        Columns columns{ColumnsVector{
+            Column("osm_id", ColumnType::BIGINT, ColumnClass::OSM_ID)
+        }};
+        {
+            Table table{"test_table", config, columns};
+            // tiny memory limit to spill every row into a temporary file
+            table.sort_rows(dir, 1);
+            table.start_copy();
+            for (const uint64_t key : {3, 1, 2}) {
+                std::string line;
+                const size_t offset = sorted_row::start(line, key);
+                line.append(std::to_string(key * 10) + "\n");
+                sorted_row::finish(line, offset);
+                table.send_line(line);
+            }
+            table.end_copy();
+        }
+        REQUIRE(read_file(dir + "/test_table.copy") == "10\n20\n30\n");
+        unlink((dir + "/test_table.copy").c_str());
+    }
+
+    SECTION("synchronous writes") {
+        config.copy_queue_size = 0;
+        write_table(config);
+        REQUIRE(read_file(dir + "/test_table.copy") == "1\tfoo\n2\tbar\n");
+        unlink((dir + "/test_table.copy").c_str());
+    }
+
+    unlink((dir + "/manifest.sql").c_str());
+    unlink((dir + "/test_table.sql").c_str());
+    rmdir(dir.c_str());
+}
@@ -0,0 +1,73 @@
+/*
+ * test_parallel_multipolygon_manager.cpp
+ *
+ *  Created on:  2026-10-17
+ *      Author: Michael Reichert <michael.reichert@geofabrik.de>
+ */
+
+#include "catch.hpp"
+#include "object_builder_utilities.hpp"
+#include <osmium/visitor.hpp>
+#include <parallel_multipolygon_manager.hpp>
+
+namespace {
+
+    size_t count_areas(const osmium::memory::Buffer& buffer) {
+        size_t count = 0;
+        for (const auto& item : buffer) {
+            if (item.type() == osmium::item_type::area) {
+                ++count;
+            }
+        }
+        return count;
+    }
+
+} // anonymous namespace
+
+TEST_CASE("parallel multipolygon manager assembles areas from ways and relations") {
+    static constexpr int buffer_size = 10 * 1000;
+    osmium::memory::Buffer relations_buffer(buffer_size);
+    osmium::memory::Buffer ways_buffer(buffer_size);
+    const osmium::NodeRef nd_ref1 (1, osmium::Location(9.0, 50.0));
+    const osmium::NodeRef nd_ref2 (2, osmium::Location(9.1, 50.0));
+    const osmium::NodeRef nd_ref3 (3, osmium::Location(9.1, 50.1));
+    const osmium::NodeRef nd_ref4 (4, osmium::Location(9.0, 50.1));
+    std::vector<const osmium::NodeRef*> node_refs {&nd_ref1, &nd_ref2, &nd_ref3, &nd_ref4, &nd_ref1};
+
+    // closed way with area tags
+    tagmap way_tags {{"building", "yes"}};
+    osmium::Way& way1 = test_utils::create_way(ways_buffer, 10, node_refs, way_tags);
+    way1.set_id(10);
+    ways_buffer.commit();
+    // closed way without tags, outer ring of the multipolygon
+    tagmap no_tags;
+    osmium::Way& way2 = test_utils::create_way(ways_buffer, 20, node_refs, no_tags);
+    way2.set_id(20);
+    ways_buffer.commit();
+
+    tagmap relation_tags {{"type", "multipolygon"}, {"landuse", "forest"}};
+    std::vector<osmium::object_id_type> member_ids {20};
+    std::vector<osmium::item_type> member_types {osmium::item_type::way};
+    std::vector<std::string> member_roles {"outer"};
+    osmium::Relation& relation = test_utils::create_relation(relations_buffer, 1, relation_tags, member_ids,
+            member_types, member_roles);
+    relation.set_id(1);
+    relations_buffer.commit();
+
+    size_t areas = 0;
+    size_t results = 0;
+    ParallelMultipolygonManager<size_t> manager{osmium::area::Assembler::config_type{}, 2, count_areas,
+        [&](size_t& count) {
+            areas += count;
+            ++results;
+        }};
+    osmium::apply(relations_buffer, manager);
+    manager.prepare_for_lookup();
+    osmium::apply(ways_buffer, manager.handler());
+    manager.finish();
+
+    REQUIRE(results == 1);
+    REQUIRE(areas == 2);
+    REQUIRE(manager.stats().from_ways == 1);
+    REQUIRE(manager.stats().from_relations == 1);
+}
@@ -0,0 +1,103 @@
+/*
+ * test_relation_geometry_builder.cpp
+ *
+ *  Created on:  2026-10-17
+ *      Author: Michael Reichert <michael.reichert@geofabrik.de>
+ */
+
+#include "catch.hpp"
+#include <vector>
+#include <wkbhpp/wkbwriter.hpp>
+#include <relation_geometry_builder.hpp>
+
+namespace {
+
+    struct TestNodeRef {
+        osmium::Location m_location;
+
+        const osmium::Location& location() const noexcept {
+            return m_location;
+        }
+    };
+
+} // anonymous namespace
+
+TEST_CASE("Relation geometry builder") {
+    RelationGeometryBuilder builder;
+    std::string out = "prefix";
+
+    SECTION("empty collections") {
+        builder.append_multipoint(out, false);
+        REQUIRE(out == "prefix010400000000000000");
+        out.clear();
+        builder.append_multilinestring(out, false);
+        REQUIRE(out == "010500000000000000");
+    }
+
+    SECTION("multipoint") {
+        builder.add_point(osmium::Location{1.0, 2.0});
+        builder.add_point(osmium::Location{8.5, 49.25});
+        REQUIRE(builder.point_count() == 2);
+        builder.append_multipoint(out, false);
+        REQUIRE(out == "prefix010400000002000000"
+                "0101000000000000000000F03F0000000000000040"
+                "010100000000000000000021400000000000A04840");
+    }
+
+    SECTION("multilinestring") {
+        builder.linestring_start();
+        builder.linestring_add_location(osmium::Location{1.0, 2.0});
+        builder.linestring_add_location(osmium::Location{8.5, 49.25});
+        REQUIRE(builder.linestring_finish() == 2);
+        REQUIRE(builder.linestring_count() == 1);
+        builder.append_multilinestring(out, false);
+        REQUIRE(out == "prefix010500000001000000"
+                "010200000002000000000000000000F03F0000000000000040"
+                "00000000000021400000000000A04840");
+    }
+
+    SECTION("linestrings with less than two points are removed") {
+        builder.linestring_start();
+        builder.linestring_add_location(osmium::Location{1.0, 2.0});
+        REQUIRE(builder.linestring_finish() == 1);
+        builder.linestring_start();
+        builder.linestring_add_location(osmium::Location{1.0, 2.0});
+        builder.linestring_add_location(osmium::Location{8.5, 49.25});
+        builder.linestring_discard();
+        REQUIRE(builder.linestring_count() == 0);
+        builder.append_multilinestring(out, false);
+        REQUIRE(out == "prefix010500000000000000");
+    }
+
+    SECTION("duplicated locations") {
+        std::vector<TestNodeRef> nodes {{osmium::Location{1.0, 2.0}}, {osmium::Location{1.0, 2.0}},
+            {osmium::Location{8.5, 49.25}}};
+        REQUIRE(builder.add_unique_linestring(nodes.begin(), nodes.end()) == 2);
+        nodes.pop_back();
+        REQUIRE(builder.add_unique_linestring(nodes.begin(), nodes.end()) == 1);
+        REQUIRE(builder.linestring_count() == 1);
+    }
+
+    SECTION("EWKB with SRID") {
+        builder.add_point(osmium::Location{1.0, 2.0});
+        out.clear();
+        builder.append_multipoint(out, true);
+        REQUIRE(wkbhpp::convert_to_hex(out) == "0104000020E610000001000000"
+                "0101000000000000000000F03F0000000000000040");
+    }
+
+    SECTION("clear") {
+        builder.add_point(osmium::Location{1.0, 2.0});
+        builder.linestring_start();
+        builder.linestring_add_location(osmium::Location{1.0, 2.0});
+        builder.linestring_add_location(osmium::Location{8.5, 49.25});
+        builder.linestring_finish();
+        builder.clear();
+        REQUIRE(builder.point_count() == 0);
+        REQUIRE(builder.linestring_count() == 0);
+        out.clear();
+        builder.append_multipoint(out, false);
+        builder.append_multilinestring(out, false);
+        REQUIRE(out == "010400000000000000010500000000000000");
+    }
+}
@@ -0,0 +1,39 @@
+/*
+ * test_replication_state.cpp
+ *
+ *  Created on:  2026-10-17
+ *      Author: Michael Reichert <michael.reichert@geofabrik.de>
+ */
+
+#include <sstream>
+#include <stdexcept>
+
+#include "catch.hpp"
+#include <replication_state.hpp>
+
+TEST_CASE("sequence number is read from state.txt") {
+    std::istringstream in {"#Sat Oct 17 10:00:02 UTC 2026\nsequenceNumber=6123456\ntimestamp=2026-10-17T10\\:00\\:00Z\n"};
+    REQUIRE(ReplicationState::parse_state_file(in) == 6123456);
+}
+
+TEST_CASE("state.txt with Windows line endings") {
+    std::istringstream in {"sequenceNumber=42\r\ntimestamp=2026-10-17T10\\:00\\:00Z\r\n"};
+    REQUIRE(ReplicationState::parse_state_file(in) == 42);
+}
+
+TEST_CASE("state.txt without valid sequence number") {
+    std::istringstream missing {"timestamp=2026-10-17T10\\:00\\:00Z\n"};
+    REQUIRE_THROWS_AS(ReplicationState::parse_state_file(missing), std::runtime_error);
+    std::istringstream invalid {"sequenceNumber=12a\n"};
+    REQUIRE_THROWS_AS(ReplicationState::parse_state_file(invalid), std::runtime_error);
+}
+
+TEST_CASE("path of a diff") {
+    REQUIRE(ReplicationState::diff_file("replication", 6123456) == "replication/006/123/456.osc.gz");
+    REQUIRE(ReplicationState::diff_file("/srv/minute", 7) == "/srv/minute/000/000/007.osc.gz");
+}
+
+TEST_CASE("query recording an applied diff") {
+    REQUIRE(ReplicationState::record_query(42) ==
+            "UPDATE cerepso_replication_state SET sequence_number = 42, in_progress = NULL, applied = now()");
+}
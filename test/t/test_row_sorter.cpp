@@ -0,0 +1,121 @@
+/*
+ * test_row_sorter.cpp
+ *
+ *  Created on:  2026-10-17
+ *      Author: Michael Reichert <michael.reichert@geofabrik.de>
+ */
+
+#include "catch.hpp"
+#include <postgres_drivers/row_sorter.hpp>
+#include <spatial_sort_key.hpp>
+
+namespace {
+
+    void add_row(postgres_drivers::RowSorter& sorter, const uint64_t key, const std::string& row) {
+        std::string& buffer = sorter.buffer();
+        const size_t offset = postgres_drivers::sorted_row::start(buffer, key);
+        buffer.append(row);
+        postgres_drivers::sorted_row::finish(buffer, offset);
+        sorter.possibly_spill();
+    }
+
+    std::vector<std::string> merge(postgres_drivers::RowSorter& sorter) {
+        std::vector<std::string> rows;
+        sorter.merge([&rows](const char* row, const size_t length) {
+            rows.emplace_back(row, length);
+        });
+        return rows;
+    }
+
+} // anonymous namespace
+
+TEST_CASE("external sort of rows") {
+
+    SECTION("rows fitting into memory") {
+        postgres_drivers::RowSorter sorter {"/tmp", 1024 * 1024};
+        add_row(sorter, 3, "c\n");
+        add_row(sorter, 1, "a\n");
+        add_row(sorter, 2, "b\n");
+        add_row(sorter, 1, "a2\n");
+        REQUIRE(sorter.run_count() == 0);
+        REQUIRE(merge(sorter) == (std::vector<std::string>{"a\n", "a2\n", "b\n", "c\n"}));
+        REQUIRE(merge(sorter).empty());
+    }
+
+    SECTION("rows spilled to temporary files") {
+        // Every row is written into its own run.
+        postgres_drivers::RowSorter sorter {"/tmp", 1};
+        add_row(sorter, 5, "e\n");
+        add_row(sorter, 1, "a\n");
+        add_row(sorter, 5, "e2\n");
+        add_row(sorter, 3, std::string{"c\0binary", 8});
+        add_row(sorter, 0, "");
+        REQUIRE(sorter.run_count() == 5);
+        REQUIRE(merge(sorter) == (std::vector<std::string>{"", "a\n", std::string{"c\0binary", 8}, "e\n", "e2\n"}));
+        REQUIRE(sorter.run_count() == 0);
+    }
+
+    SECTION("more runs than can be merged at once") {
+        postgres_drivers::RowSorter sorter {"/tmp", 40};
+        const uint64_t count = 2000;
+        for (uint64_t i = 0; i < count; ++i) {
+            // keys in a scrambled order, every key twice
+            const uint64_t key = (i * 7919) % (count / 2);
+            add_row(sorter, key, std::to_string(key) + "/" + std::to_string(i) + "\n");
+        }
+        REQUIRE(sorter.run_count() > 64);
+        std::vector<std::string> rows = merge(sorter);
+        REQUIRE(rows.size() == count);
+        uint64_t last_key = 0;
+        uint64_t last_index = 0;
+        bool first = true;
+        for (const std::string& row : rows) {
+            const uint64_t key = std::stoull(row.substr(0, row.find('/')));
+            const uint64_t index = std::stoull(row.substr(row.find('/') + 1));
+            if (!first) {
+                REQUIRE(key >= last_key);
+                if (key == last_key) {
+                    // rows with equal keys keep their order
+                    REQUIRE(index > last_index);
+                }
+            }
+            first = false;
+            last_key = key;
+            last_index = index;
+        }
+    }
+
+    SECTION("temporary directory does not exist") {
+        postgres_drivers::RowSorter sorter {"/nonexistent-directory", 1};
+        REQUIRE_THROWS_AS(add_row(sorter, 1, "a\n"), std::runtime_error);
+    }
+}
+
+TEST_CASE("Hilbert curve") {
+    // The lowest 16x16 cells are the first 256 positions of the curve and consecutive
+    // positions are neighbours.
+    std::vector<std::pair<uint32_t, uint32_t>> cells(256);
+    std::vector<bool> seen(256, false);
+    for (uint32_t x = 0; x < 16; ++x) {
+        for (uint32_t y = 0; y < 16; ++y) {
+            const uint64_t index = spatial_sort_key::hilbert_index(x, y);
+            REQUIRE(index < 256);
+            REQUIRE_FALSE(seen[index]);
+            seen[index] = true;
+            cells[index] = std::make_pair(x, y);
+        }
+    }
+    REQUIRE(spatial_sort_key::hilbert_index(0, 0) == 0);
+    for (size_t i = 1; i < cells.size(); ++i) {
+        const int dx = static_cast<int>(cells[i].first) - static_cast<int>(cells[i - 1].first);
+        const int dy = static_cast<int>(cells[i].second) - static_cast<int>(cells[i - 1].second);
+        REQUIRE(std::abs(dx) + std::abs(dy) == 1);
+    }
+
+    REQUIRE(spatial_sort_key::from_location(osmium::Location{}) == spatial_sort_key::invalid_key);
+    const uint64_t key1 = spatial_sort_key::from_location(osmium::Location{9.0, 50.0});
+    const uint64_t key2 = spatial_sort_key::from_location(osmium::Location{9.0000001, 50.0});
+    const uint64_t key3 = spatial_sort_key::from_location(osmium::Location{-120.0, -30.0});
+    REQUIRE(key1 != spatial_sort_key::invalid_key);
+    REQUIRE((key1 > key2 ? key1 - key2 : key2 - key1) < (key1 > key3 ? key1 - key3 : key3 - key1));
+}
@@ -0,0 +1,92 @@
+/*
+ * test_way_node_store.cpp
+ *
+ *  Created on:  2026-10-17
+ *      Author: Michael Reichert <michael.reichert@geofabrik.de>
+ */
+
+#include "catch.hpp"
+#include "object_builder_utilities.hpp"
+#include <way_node_store.hpp>
+
+TEST_CASE("way node store returns the locations of the way nodes") {
+    static constexpr int buffer_size = 10 * 1000;
+    osmium::memory::Buffer buffer(buffer_size);
+    const osmium::NodeRef nd_ref1 (1, osmium::Location(9.0, 50.1));
+    const osmium::NodeRef nd_ref2 (2, osmium::Location(9.1, 50.0));
+    const osmium::NodeRef nd_ref3 (3, osmium::Location(9.2, 49.8));
+    std::vector<const osmium::NodeRef*> node_refs1 {&nd_ref1, &nd_ref2};
+    std::vector<const osmium::NodeRef*> node_refs2 {&nd_ref2, &nd_ref3, &nd_ref1};
+    tagmap tags;
+    // The ways are added in reverse order of their IDs to check the sorting.
+    osmium::Way& way2 = test_utils::create_way(buffer, 20, node_refs2, tags);
+    way2.set_id(20);
+    buffer.commit();
+    osmium::Way& way1 = test_utils::create_way(buffer, 10, node_refs1, tags);
+    way1.set_id(10);
+    buffer.commit();
+
+    WayNodeStore store;
+    store.add(way2);
+    store.add(way1);
+    store.prepare_for_lookup();
+    REQUIRE(store.size() == 2);
+
+    SECTION("existing ways") {
+        WayNodeStore::Range range1 = store.get(10);
+        REQUIRE(range1.end() - range1.begin() == 2);
+        REQUIRE(range1.begin()->location() == nd_ref1.location());
+        REQUIRE((range1.begin() + 1)->location() == nd_ref2.location());
+        WayNodeStore::Range range2 = store.get(20);
+        REQUIRE(range2.end() - range2.begin() == 3);
+        REQUIRE((range2.begin() + 2)->location() == nd_ref1.location());
+    }
+
+    SECTION("missing way") {
+        REQUIRE(store.get(15).empty());
+        REQUIRE(store.get(30).empty());
+    }
+}
+
+TEST_CASE("way node store does not split the locations of a way between blocks") {
+    static constexpr int buffer_size = 10 * 1000;
+    osmium::memory::Buffer buffer(buffer_size);
+    const osmium::NodeRef nd_ref1 (1, osmium::Location(9.0, 50.1));
+    const osmium::NodeRef nd_ref2 (2, osmium::Location(9.1, 50.0));
+    const osmium::NodeRef nd_ref3 (3, osmium::Location(9.2, 49.8));
+    const osmium::NodeRef nd_ref4 (4, osmium::Location(9.3, 49.7));
+    std::vector<const osmium::NodeRef*> node_refs1 {&nd_ref1, &nd_ref2};
+    std::vector<const osmium::NodeRef*> node_refs2 {&nd_ref2, &nd_ref3};
+    std::vector<const osmium::NodeRef*> node_refs3 {&nd_ref1, &nd_ref2, &nd_ref3, &nd_ref4};
+    tagmap tags;
+    osmium::Way& way1 = test_utils::create_way(buffer, 10, node_refs1, tags);
+    way1.set_id(10);
+    buffer.commit();
+    osmium::Way& way2 = test_utils::create_way(buffer, 20, node_refs2, tags);
+    way2.set_id(20);
+    buffer.commit();
+    osmium::Way& way3 = test_utils::create_way(buffer, 30, node_refs3, tags);
+    way3.set_id(30);
+    buffer.commit();
+
+    // The second way does not fit into the rest of the first block, the third way is longer
+    // than a block.
+    WayNodeStore store(3);
+    store.add(way1);
+    store.add(way2);
+    store.add(way3);
+    store.prepare_for_lookup();
+    REQUIRE(store.size() == 3);
+
+    WayNodeStore::Range range1 = store.get(10);
+    REQUIRE(range1.end() - range1.begin() == 2);
+    REQUIRE((range1.begin() + 1)->location() == nd_ref2.location());
+    WayNodeStore::Range range2 = store.get(20);
+    REQUIRE(range2.end() - range2.begin() == 2);
+    REQUIRE(range2.begin()->location() == nd_ref2.location());
+    REQUIRE((range2.begin() + 1)->location() == nd_ref3.location());
+    WayNodeStore::Range range3 = store.get(30);
+    REQUIRE(range3.end() - range3.begin() == 4);
+    REQUIRE(range3.begin()->location() == nd_ref1.location());
+    REQUIRE((range3.begin() + 3)->location() == nd_ref4.location());
+}
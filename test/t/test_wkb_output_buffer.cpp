@@ -0,0 +1,81 @@
+/*
+ * test_wkb_output_buffer.cpp
+ *
+ *  Created on:  2026-10-17
+ *      Author: Michael Reichert <michael.reichert@geofabrik.de>
+ */
+
+#include "catch.hpp"
+#include <wkbhpp/wkbwriter.hpp>
+
+TEST_CASE("WKB writer appends to output buffer") {
+    wkbhpp::WKBWriter writer{4326, wkbhpp::wkb_type::wkb, wkbhpp::out_type::hex};
+    wkbhpp::output_buffer output;
+    wkbhpp::WKBWriter buffered_writer{4326, wkbhpp::wkb_type::wkb, wkbhpp::out_type::hex, &output};
+
+    std::string buffer = "prefix";
+
+    SECTION("hex encoding") {
+        REQUIRE(wkbhpp::convert_to_hex(std::string("\x00\x1f\xa0\xff", 4)) == "001FA0FF");
+    }
+
+    SECTION("point") {
+        {
+            wkbhpp::output_scope scope{output, buffer};
+            REQUIRE(buffered_writer.make_point(1.5, -2.0).empty());
+        }
+        REQUIRE(buffer == "prefix0101000000000000000000F83F00000000000000C0");
+        REQUIRE(buffer == "prefix" + writer.make_point(1.5, -2.0));
+    }
+
+    SECTION("linestring") {
+        {
+            wkbhpp::output_scope scope{output, buffer};
+            buffered_writer.linestring_start();
+            buffered_writer.linestring_add_location(1.0, 2.0);
+            buffered_writer.linestring_add_location(3.0, 4.0);
+            REQUIRE(buffered_writer.linestring_finish(2).empty());
+        }
+        writer.linestring_start();
+        writer.linestring_add_location(1.0, 2.0);
+        writer.linestring_add_location(3.0, 4.0);
+        REQUIRE(buffer == "prefix" + writer.linestring_finish(2));
+    }
+
+    SECTION("unfinished geometry does not touch the buffer") {
+        {
+            wkbhpp::output_scope scope{output, buffer};
+            buffered_writer.linestring_start();
+            buffered_writer.linestring_add_location(1.0, 2.0);
+        }
+        REQUIRE(buffer == "prefix");
+    }
+
+    SECTION("geometries are returned after the scope ended") {
+        {
+            wkbhpp::output_scope scope{output, buffer};
+        }
+        REQUIRE(buffered_writer.make_point(1.5, -2.0) == writer.make_point(1.5, -2.0));
+        REQUIRE(buffer == "prefix");
+    }
+}
+
+TEST_CASE("binary WKB writer appends to output buffer") {
+    wkbhpp::output_buffer output;
+    wkbhpp::WKBWriter writer{4326, wkbhpp::wkb_type::ewkb, wkbhpp::out_type::binary, &output};
+    std::string buffer;
+    {
+        wkbhpp::output_scope scope{output, buffer};
+        writer.polygon_start();
+        writer.polygon_outer_ring_start();
+        writer.polygon_add_location(0.0, 0.0);
+        writer.polygon_add_location(1.0, 0.0);
+        writer.polygon_add_location(0.0, 1.0);
+        writer.polygon_add_location(0.0, 0.0);
+        writer.polygon_outer_ring_finish();
+        writer.polygon_finish();
+    }
+    // byte order, type, SRID, number of rings, number of points, 4 points
+    REQUIRE(buffer.size() == 1 + 4 + 4 + 4 + 4 + 4 * 16);
+    REQUIRE(buffer.substr(0, 9) == std::string("\x01\x03\0\0\x20\xe6\x10\0\0", 9));
+}
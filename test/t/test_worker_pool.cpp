@@ -0,0 +1,53 @@
+/*
+ * test_worker_pool.cpp
+ *
+ *  Created on:  2026-10-17
+ *      Author: Michael Reichert <michael.reichert@geofabrik.de>
+ */
+
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "catch.hpp"
+#include <worker_pool.hpp>
+
+TEST_CASE("results are consumed in the order of submission") {
+    std::vector<int> results;
+    auto consumer = [&results](int& result) {
+        results.push_back(result);
+    };
+    {
+        OrderedWorkerPool<int> pool{4, 3};
+        for (int i = 0; i < 100; ++i) {
+            pool.submit([i]() {
+                if (i % 7 == 0) {
+                    // Let some tasks finish later than their successors.
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                }
+                return i;
+            }, consumer);
+            REQUIRE(pool.pending() <= 3);
+        }
+        pool.drain(consumer);
+        REQUIRE(pool.pending() == 0);
+    }
+    REQUIRE(results.size() == 100);
+    for (int i = 0; i < 100; ++i) {
+        REQUIRE(results.at(i) == i);
+    }
+}
+
+TEST_CASE("exceptions of a task are rethrown when its result is consumed") {
+    OrderedWorkerPool<int> pool{2, 4};
+    int consumed = 0;
+    auto consumer = [&consumed](int&) {
+        ++consumed;
+    };
+    pool.submit([]() { return 1; }, consumer);
+    pool.submit([]() -> int { throw std::runtime_error{"task failed"}; }, consumer);
+    pool.submit([]() { return 3; }, consumer);
+    REQUIRE_THROWS_AS(pool.drain(consumer), std::runtime_error);
+    REQUIRE(consumed == 1);
+}